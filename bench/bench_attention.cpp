@@ -0,0 +1,107 @@
+#include <numeric>
+#include <random>
+#include <vector>
+
+#include "bench_common.hpp"
+#include "core/attention.hpp"
+
+// ============================================================================
+// Attention Microbenchmarks - Standard vs Paged, across lengths and block sizes
+// ============================================================================
+
+struct AttentionShape
+{
+    const char *name;
+    int         n_heads;
+    int         n_kv_heads;
+    int         head_dim;
+};
+
+static const AttentionShape SHAPES[] = {
+    {"15M", 6, 6, 48},
+    {"GQA", 32, 8, 128},
+};
+
+static const int SEQ_LENS[]    = {64, 256, 1024, 4096};
+static const int BLOCK_SIZES[] = {16, 32};
+
+// One decode step reads every cached K and V row once
+static void flops_bytes(const AttentionShape &s, int num_tokens, double &flops, double &bytes)
+{
+    double kv_dim = static_cast<double>(s.n_kv_heads) * s.head_dim;
+    flops         = 4.0 * s.n_heads * num_tokens * s.head_dim; // QK^T + AV
+    bytes         = (2.0 * num_tokens * kv_dim + 2.0 * s.n_heads * s.head_dim) * 4.0;
+}
+
+int main()
+{
+    Bench::Roofline roof = Bench::measure_roofline();
+    Bench::print_header();
+
+    for (const auto &s : SHAPES) {
+        int  kv_dim  = s.n_kv_heads * s.head_dim;
+        int  max_len = SEQ_LENS[std::size(SEQ_LENS) - 1];
+        auto q       = Bench::random_vector(static_cast<size_t>(s.n_heads) * s.head_dim);
+        auto k       = Bench::random_vector(static_cast<size_t>(max_len) * kv_dim, 1.0f, 1);
+        auto v       = Bench::random_vector(static_cast<size_t>(max_len) * kv_dim, 1.0f, 2);
+
+        std::vector<float> out(static_cast<size_t>(s.n_heads) * s.head_dim);
+        std::vector<float> att(static_cast<size_t>(s.n_heads) * max_len);
+
+        for (int num_tokens : SEQ_LENS) {
+            double flops, bytes;
+            flops_bytes(s, num_tokens, flops, bytes);
+
+            double t = Bench::time_per_call([&] {
+                Attention::standard_attention(out.data(),
+                                              q.data(),
+                                              k.data(),
+                                              v.data(),
+                                              att.data(),
+                                              num_tokens - 1,
+                                              s.head_dim,
+                                              s.n_heads,
+                                              s.n_kv_heads,
+                                              max_len);
+                Bench::do_not_optimize(out.data());
+            });
+            Bench::report("standard " + std::string(s.name),
+                          Bench::shape_str({{"T", num_tokens}, {"hd", s.head_dim}}),
+                          t,
+                          flops,
+                          bytes,
+                          roof);
+
+            for (int block_size : BLOCK_SIZES) {
+                // Shuffled block table, as after many allocations and frees
+                int              num_blocks = (max_len + block_size - 1) / block_size;
+                std::vector<int> block_table(num_blocks);
+                std::iota(block_table.begin(), block_table.end(), 0);
+                std::shuffle(block_table.begin(), block_table.end(), std::mt19937(7));
+
+                double tp = Bench::time_per_call([&] {
+                    Attention::paged_attention(out.data(),
+                                               q.data(),
+                                               k.data(),
+                                               v.data(),
+                                               block_table.data(),
+                                               att.data(),
+                                               num_tokens,
+                                               block_size,
+                                               s.head_dim,
+                                               s.n_heads,
+                                               s.n_kv_heads);
+                    Bench::do_not_optimize(out.data());
+                });
+                Bench::report("paged " + std::string(s.name),
+                              Bench::shape_str({{"T", num_tokens}, {"hd", s.head_dim}, {"bs", block_size}}),
+                              tp,
+                              flops,
+                              bytes,
+                              roof);
+            }
+        }
+    }
+
+    return 0;
+}
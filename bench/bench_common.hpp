@@ -0,0 +1,185 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <string>
+#include <unistd.h>
+#include <vector>
+
+// ============================================================================
+// Microbenchmark Helpers - Timing, roofline measurement and reporting
+// ============================================================================
+
+namespace Bench {
+
+using Clock = std::chrono::steady_clock;
+
+// Keeps the optimizer from discarding benchmarked work
+inline void do_not_optimize(const void *p)
+{
+    asm volatile("" : : "g"(p) : "memory");
+}
+
+inline std::vector<float> random_vector(size_t n, float scale = 1.0f, unsigned seed = 42)
+{
+    std::mt19937                          rng(seed);
+    std::uniform_real_distribution<float> dist(-scale, scale);
+    std::vector<float>                    v(n);
+    for (auto &x : v) {
+        x = dist(rng);
+    }
+    return v;
+}
+
+// Median seconds per call of fn, after a warmup, repeating for at least min_time_s
+template <typename Fn> double time_per_call(Fn &&fn, double min_time_s = 0.2, int min_reps = 5)
+{
+    fn(); // warmup
+
+    std::vector<double> samples;
+    auto                begin = Clock::now();
+    while (static_cast<int>(samples.size()) < min_reps
+           || std::chrono::duration<double>(Clock::now() - begin).count() < min_time_s) {
+        auto start = Clock::now();
+        fn();
+        samples.push_back(std::chrono::duration<double>(Clock::now() - start).count());
+    }
+
+    std::nth_element(samples.begin(), samples.begin() + samples.size() / 2, samples.end());
+    return samples[samples.size() / 2];
+}
+
+// ============================================================================
+// Roofline - Measured peak memory bandwidth and FMA throughput of this machine
+// ============================================================================
+
+struct Roofline
+{
+    double bandwidth_gbs       = 0.0; // STREAM-triad style from DRAM, single thread
+    double cache_bandwidth_gbs = 0.0; // Same kernel on an L2-resident working set
+    size_t cache_bytes         = 0;   // Working sets up to this size use cache bandwidth
+    double peak_gflops         = 0.0; // Independent FMA chains, single thread
+
+    double bandwidth_for(double working_set_bytes) const
+    {
+        return working_set_bytes <= static_cast<double>(cache_bytes) ? cache_bandwidth_gbs : bandwidth_gbs;
+    }
+
+    // Attainable GFLOP/s at a given arithmetic intensity (FLOP/byte)
+    double attainable_gflops(double intensity, double working_set_bytes) const
+    {
+        return std::min(peak_gflops, intensity * bandwidth_for(working_set_bytes));
+    }
+};
+
+inline double measure_bandwidth_gbs(size_t n)
+{
+    std::vector<float> a(n), b(n, 1.0f), c(n, 2.0f);
+    const float        s = 3.0f;
+
+    double t = time_per_call([&] {
+        for (size_t i = 0; i < n; i++) {
+            a[i] = b[i] + s * c[i];
+        }
+        do_not_optimize(a.data());
+    });
+    return 3.0 * n * sizeof(float) / t / 1e9;
+}
+
+inline size_t l2_cache_bytes()
+{
+#ifdef _SC_LEVEL2_CACHE_SIZE
+    long size = sysconf(_SC_LEVEL2_CACHE_SIZE);
+    if (size > 0) {
+        return static_cast<size_t>(size);
+    }
+#endif
+    return 1024 * 1024;
+}
+
+inline double measure_peak_gflops()
+{
+    // Enough independent accumulators to cover FMA latency across all ports
+    constexpr int ACC   = 64;
+    constexpr int ITERS = 1 << 20;
+    alignas(64) float acc[ACC];
+    for (int j = 0; j < ACC; j++) {
+        acc[j] = static_cast<float>(j) * 1e-3f;
+    }
+    float a = 0.999999f, b = 1e-7f;
+    do_not_optimize(&a);
+    do_not_optimize(&b);
+
+    double t = time_per_call([&] {
+        for (int i = 0; i < ITERS; i++) {
+            for (int j = 0; j < ACC; j++) {
+                acc[j] = acc[j] * a + b;
+            }
+        }
+        do_not_optimize(acc);
+    });
+    return 2.0 * ACC * ITERS / t / 1e9;
+}
+
+inline Roofline measure_roofline()
+{
+    Roofline roof;
+    roof.cache_bytes         = l2_cache_bytes();
+    roof.bandwidth_gbs       = measure_bandwidth_gbs(16 * 1024 * 1024); // 3 x 64 MB, well past LLC
+    roof.cache_bandwidth_gbs = measure_bandwidth_gbs(roof.cache_bytes / 2 / (3 * sizeof(float)));
+    roof.peak_gflops         = measure_peak_gflops();
+    std::cout << std::fixed << std::setprecision(2) << "Roofline: " << roof.bandwidth_gbs << " GB/s DRAM, "
+              << roof.cache_bandwidth_gbs << " GB/s L2 (<= " << roof.cache_bytes / 1024 << " KB), "
+              << roof.peak_gflops << " GFLOP/s FMA (single thread)\n";
+    return roof;
+}
+
+// ============================================================================
+// Reporting
+// ============================================================================
+
+inline void print_header()
+{
+    std::cout << "\n"
+              << std::left << std::setw(30) << "kernel" << std::setw(30) << "shape" << std::right << std::setw(12)
+              << "time us" << std::setw(11) << "GFLOP/s" << std::setw(10) << "GB/s" << std::setw(9) << "% roof"
+              << "\n";
+    std::cout << std::string(102, '-') << "\n";
+}
+
+// One result row. flops/bytes are per call; bytes counts compulsory traffic
+// (each input read once, each output written once).
+inline void report(const std::string &kernel,
+                   const std::string &shape,
+                   double             seconds,
+                   double             flops,
+                   double             bytes,
+                   const Roofline    &roof)
+{
+    double gflops = flops / seconds / 1e9;
+    double gbs    = bytes / seconds / 1e9;
+
+    // Percent of the roofline bound at this kernel's arithmetic intensity;
+    // pure data-movement kernels are judged against bandwidth alone
+    double percent = flops > 0 ? 100.0 * gflops / roof.attainable_gflops(flops / bytes, bytes)
+                               : 100.0 * gbs / roof.bandwidth_for(bytes);
+
+    std::cout << std::left << std::setw(30) << kernel << std::setw(30) << shape << std::right << std::fixed
+              << std::setprecision(2) << std::setw(12) << seconds * 1e6 << std::setw(11) << gflops << std::setw(10)
+              << gbs << std::setprecision(1) << std::setw(9) << percent << "\n";
+}
+
+inline std::string shape_str(std::initializer_list<std::pair<const char *, int>> dims)
+{
+    std::string s;
+    for (const auto &[name, value] : dims) {
+        s += (s.empty() ? "" : " ") + std::string(name) + "=" + std::to_string(value);
+    }
+    return s;
+}
+
+} // namespace Bench
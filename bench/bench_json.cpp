@@ -0,0 +1,125 @@
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "bench_common.hpp"
+#include "utils/argparser.hpp"
+#include "utils/json_parser.hpp"
+#include "utils/json_scanner.hpp"
+
+// ============================================================================
+// JSON Ingestion Microbenchmark - DOM parser vs on-demand request scanner
+//
+// Each row parses a batch of JSONL request lines into Requests. GB/s is input
+// bytes per second; per-request cost is time / requests. "scan fields" skips
+// building the Request (no prompt copy) to show the parser-only cost.
+// ============================================================================
+
+#define ARGS_LIST num_requests
+
+class JsonBenchArgs : public ArgConfig<JsonBenchArgs>
+{
+public:
+    Arg<int> num_requests{"--num-requests", "Request lines per batch", 1000};
+
+    decltype(std::tie(ARGS_LIST)) args_tuple = std::tie(ARGS_LIST);
+};
+
+#undef ARGS_LIST
+
+static std::vector<std::string> make_lines(int count, int prompt_chars, bool escaped)
+{
+    const std::string words = "Once upon a time, there was a little girl named Lily. She loved to play outside. ";
+
+    std::vector<std::string> lines;
+    for (int i = 0; i < count; i++) {
+        std::string prompt;
+        while (static_cast<int>(prompt.size()) < prompt_chars) {
+            prompt += escaped ? "\\\"Hi,\\\" she said.\\n" : words;
+        }
+        prompt.resize(prompt_chars);
+        if (escaped) {
+            while (prompt.back() == '\\') {
+                prompt.pop_back();
+            }
+        }
+        lines.push_back("{\"id\": \"req-" + std::to_string(i) + "\", \"prompt\": \"" + prompt
+                        + "\", \"temperature\": 0.7, \"top_p\": 0.95, \"max_tokens\": 128, "
+                          "\"metadata\": {\"user\": \"u" + std::to_string(i % 17) + "\", \"stream\": false}}");
+    }
+    return lines;
+}
+
+static bool same_request(const Request &a, const Request &b)
+{
+    return a.prompt == b.prompt && a.sampling_params.temperature == b.sampling_params.temperature
+        && a.sampling_params.top_p == b.sampling_params.top_p
+        && a.sampling_params.max_tokens == b.sampling_params.max_tokens;
+}
+
+int main(int argc, char **argv)
+{
+    JsonBenchArgs args;
+    ArgParser     parser("nano-vllm JSON ingestion microbenchmark");
+    if (!args.parse(parser, argc, argv)) {
+        return 1;
+    }
+
+    Bench::Roofline roof = Bench::measure_roofline();
+    Bench::print_header();
+
+    bool ok = true;
+    for (bool escaped : {false, true}) {
+        for (int prompt_chars : {64, 1024, 16384}) {
+            std::vector<std::string> lines = make_lines(args.num_requests, prompt_chars, escaped);
+
+            double bytes = 0.0;
+            for (const auto &line : lines) {
+                bytes += static_cast<double>(line.size());
+            }
+            std::string shape = Bench::shape_str({{"reqs", args.num_requests}, {"prompt", prompt_chars}})
+                              + (escaped ? " esc" : "");
+
+            json::JsonParser     dom;
+            json::RequestScanner scanner;
+
+            // Both must agree before timing means anything
+            for (size_t i = 0; i < lines.size(); i++) {
+                Request expected = json::request_from_object(dom.parse(lines[i]), static_cast<int>(i));
+                Request actual   = scanner.scan_request(lines[i], static_cast<int>(i));
+                if (!same_request(expected, actual)) {
+                    std::cerr << "MISMATCH on line " << i << " (" << shape << ")\n";
+                    ok = false;
+                    break;
+                }
+            }
+
+            double t_dom = Bench::time_per_call([&] {
+                for (size_t i = 0; i < lines.size(); i++) {
+                    Request r = json::request_from_object(dom.parse(lines[i]), static_cast<int>(i));
+                    Bench::do_not_optimize(r.prompt.data());
+                }
+            });
+            double t_scan = Bench::time_per_call([&] {
+                for (size_t i = 0; i < lines.size(); i++) {
+                    Request r = scanner.scan_request(lines[i], static_cast<int>(i));
+                    Bench::do_not_optimize(r.prompt.data());
+                }
+            });
+            double t_fields = Bench::time_per_call([&] {
+                for (const auto &line : lines) {
+                    json::RequestFields f = scanner.scan(line);
+                    Bench::do_not_optimize(f.prompt.data());
+                }
+            });
+
+            Bench::report("json dom parse", shape, t_dom, 0.0, bytes, roof);
+            Bench::report("json scan request", shape, t_scan, 0.0, bytes, roof);
+            Bench::report("json scan fields", shape, t_fields, 0.0, bytes, roof);
+            std::cout << std::fixed << std::setprecision(1) << "  ns/request: dom " << t_dom * 1e9 / lines.size()
+                      << ", scan " << t_scan * 1e9 / lines.size() << " (" << t_dom / t_scan << "x)\n";
+        }
+    }
+
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,76 @@
+#include <vector>
+
+#include "batch_ops.hpp"
+#include "bench_common.hpp"
+#include "ops/linear.hpp"
+
+// ============================================================================
+// Linear Microbenchmarks - Ops::matmul (GEMV) and BatchOps::batch_matmul (GEMM)
+// ============================================================================
+
+struct MatmulShape
+{
+    const char *name;
+    int         in_dim;
+    int         out_dim;
+};
+
+// stories15M projections plus a 7B-sized square layer
+static const MatmulShape SHAPES[] = {
+    {"qkv/wo 15M", 288, 288},
+    {"ffn up 15M", 288, 768},
+    {"ffn down 15M", 768, 288},
+    {"classifier 15M", 288, 32000},
+    {"proj 7B", 4096, 4096},
+};
+
+int main()
+{
+    Bench::Roofline roof = Bench::measure_roofline();
+    Bench::print_header();
+
+    for (const auto &shape : SHAPES) {
+        auto               weight = Bench::random_vector(static_cast<size_t>(shape.in_dim) * shape.out_dim);
+        auto               in     = Bench::random_vector(shape.in_dim);
+        std::vector<float> out(shape.out_dim);
+
+        double t = Bench::time_per_call([&] {
+            Ops::matmul(out.data(), in.data(), weight.data(), shape.in_dim, shape.out_dim);
+            Bench::do_not_optimize(out.data());
+        });
+
+        double flops = 2.0 * shape.in_dim * shape.out_dim;
+        double bytes = (static_cast<double>(shape.in_dim) * shape.out_dim + shape.in_dim + shape.out_dim) * 4.0;
+        Bench::report("matmul " + std::string(shape.name),
+                      Bench::shape_str({{"in", shape.in_dim}, {"out", shape.out_dim}}),
+                      t,
+                      flops,
+                      bytes,
+                      roof);
+    }
+
+    for (const auto &shape : SHAPES) {
+        for (int batch : {4, 16, 64}) {
+            auto weight = Bench::random_vector(static_cast<size_t>(shape.in_dim) * shape.out_dim);
+            auto in     = Bench::random_vector(static_cast<size_t>(batch) * shape.in_dim);
+            std::vector<float> out(static_cast<size_t>(batch) * shape.out_dim);
+
+            double t = Bench::time_per_call([&] {
+                BatchOps::batch_matmul(out.data(), in.data(), weight.data(), batch, shape.in_dim, shape.out_dim);
+                Bench::do_not_optimize(out.data());
+            });
+
+            double flops = 2.0 * batch * shape.in_dim * shape.out_dim;
+            double bytes =
+                (static_cast<double>(shape.in_dim) * shape.out_dim + batch * (shape.in_dim + shape.out_dim)) * 4.0;
+            Bench::report("batch_matmul " + std::string(shape.name),
+                          Bench::shape_str({{"b", batch}, {"in", shape.in_dim}, {"out", shape.out_dim}}),
+                          t,
+                          flops,
+                          bytes,
+                          roof);
+        }
+    }
+
+    return 0;
+}
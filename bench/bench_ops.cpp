@@ -0,0 +1,84 @@
+#include <cmath>
+#include <vector>
+
+#include "bench_common.hpp"
+#include "ops/activation.hpp"
+#include "ops/normalization.hpp"
+#include "ops/positional.hpp"
+
+// ============================================================================
+// Elementwise/Reduction Microbenchmarks - rms_norm, softmax, swiglu, rope
+//
+// FLOP counts treat expf/sinf/cosf/powf as one op each, so GFLOP/s here is
+// a relative measure across runs rather than a hardware FMA rate.
+// ============================================================================
+
+int main()
+{
+    Bench::Roofline roof = Bench::measure_roofline();
+    Bench::print_header();
+
+    for (int dim : {288, 4096}) {
+        auto               in     = Bench::random_vector(dim);
+        auto               weight = Bench::random_vector(dim);
+        std::vector<float> out(dim);
+
+        double t = Bench::time_per_call([&] {
+            Ops::rms_norm(out.data(), in.data(), weight.data(), dim);
+            Bench::do_not_optimize(out.data());
+        });
+        Bench::report("rms_norm", Bench::shape_str({{"dim", dim}}), t, 4.0 * dim, 3.0 * dim * 4.0, roof);
+    }
+
+    for (int size : {1024, 32000, 128256}) {
+        auto               logits = Bench::random_vector(size, 10.0f);
+        std::vector<float> work(size);
+
+        double t = Bench::time_per_call([&] {
+            std::copy(logits.begin(), logits.end(), work.begin());
+            Ops::softmax(work.data(), size);
+            Bench::do_not_optimize(work.data());
+        });
+        Bench::report("softmax", Bench::shape_str({{"n", size}}), t, 4.0 * size, 2.0 * size * 4.0, roof);
+    }
+
+    for (int hidden_dim : {768, 11008}) {
+        auto               gate = Bench::random_vector(hidden_dim);
+        auto               up   = Bench::random_vector(hidden_dim);
+        std::vector<float> out(hidden_dim);
+
+        double t = Bench::time_per_call([&] {
+            Ops::swiglu(out.data(), gate.data(), up.data(), hidden_dim);
+            Bench::do_not_optimize(out.data());
+        });
+        Bench::report(
+            "swiglu", Bench::shape_str({{"hidden", hidden_dim}}), t, 5.0 * hidden_dim, 3.0 * hidden_dim * 4.0, roof);
+    }
+
+    struct RopeShape
+    {
+        int n_heads, n_kv_heads, head_dim;
+    };
+    for (const RopeShape &s : {RopeShape{6, 6, 48}, RopeShape{32, 8, 128}}) {
+        auto q = Bench::random_vector(static_cast<size_t>(s.n_heads) * s.head_dim);
+        auto k = Bench::random_vector(static_cast<size_t>(s.n_kv_heads) * s.head_dim);
+        int  pos = 0;
+
+        double t = Bench::time_per_call([&] {
+            Ops::apply_rope(q.data(), k.data(), pos++ & 1023, s.head_dim, s.n_heads, s.n_kv_heads, 10000.0f);
+            Bench::do_not_optimize(q.data());
+        });
+
+        double pairs = (s.n_heads + s.n_kv_heads) * s.head_dim / 2.0;
+        double flops = 6.0 * pairs + 5.0 * s.head_dim / 2.0; // rotations + per-frequency trig
+        double bytes = 2.0 * (s.n_heads + s.n_kv_heads) * s.head_dim * 4.0;
+        Bench::report("rope",
+                      Bench::shape_str({{"heads", s.n_heads}, {"kv", s.n_kv_heads}, {"hd", s.head_dim}}),
+                      t,
+                      flops,
+                      bytes,
+                      roof);
+    }
+
+    return 0;
+}
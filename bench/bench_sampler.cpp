@@ -0,0 +1,57 @@
+#include <algorithm>
+#include <vector>
+
+#include "bench_common.hpp"
+#include "core/sampler.hpp"
+
+// ============================================================================
+// Sampler Microbenchmark - greedy, temperature and top-p over a full vocab
+//
+// Sampler::sample modifies logits in place, so every call starts from a
+// fresh copy; the copy is included in the timing and in the byte count.
+// The "+logprobs" modes also report the token's log-probability and the
+// top 5 alternatives (log-sum-exp and selection passes over the logits).
+// ============================================================================
+
+int main()
+{
+    Bench::Roofline roof = Bench::measure_roofline();
+    Bench::print_header();
+
+    struct Mode
+    {
+        const char *name;
+        float       temperature;
+        float       top_p;
+        int         top_logprobs; // -1 = no logprobs
+    };
+
+    for (int vocab_size : {32000, 128256}) {
+        auto               logits = Bench::random_vector(vocab_size, 10.0f);
+        std::vector<float> work(vocab_size);
+
+        for (const Mode &mode : {Mode{"sample greedy", 0.0f, 1.0f, -1},
+                                 Mode{"sample temperature", 0.8f, 1.0f, -1},
+                                 Mode{"sample top-p", 0.8f, 0.9f, -1},
+                                 Mode{"sample greedy +logprobs", 0.0f, 1.0f, 5},
+                                 Mode{"sample temperature +logprobs", 0.8f, 1.0f, 5}}) {
+            Sampler                        sampler(vocab_size, mode.temperature, mode.top_p, 1234);
+            float                          logprob;
+            std::vector<Ops::TokenLogprob> top;
+
+            double t = Bench::time_per_call([&] {
+                std::copy(logits.begin(), logits.end(), work.begin());
+                int token = mode.top_logprobs < 0 ? sampler.sample(work.data())
+                                                  : sampler.sample(work.data(), logprob, top, mode.top_logprobs);
+                Bench::do_not_optimize(&token);
+            });
+
+            // Copy (read + write) plus at least one pass over the logits, and
+            // three more (max, exp-sum, top-k) for logprobs
+            double bytes = (mode.top_logprobs < 0 ? 3.0 : 6.0) * vocab_size * 4.0;
+            Bench::report(mode.name, Bench::shape_str({{"vocab", vocab_size}}), t, 0.0, bytes, roof);
+        }
+    }
+
+    return 0;
+}
@@ -0,0 +1,70 @@
+#include <string>
+
+#include "bench_common.hpp"
+#include "core/tokenizer.hpp"
+#include "utils/argparser.hpp"
+#include "utils/path.hpp"
+
+// ============================================================================
+// Tokenizer Microbenchmark - BPE encode throughput
+//
+// Encoding is branchy string work with no FLOPs; GB/s is input text bytes
+// per second and the roofline column compares that against memory bandwidth.
+// ============================================================================
+
+#define ARGS_LIST path, vocab_size
+
+class TokenizerBenchArgs : public ArgConfig<TokenizerBenchArgs>
+{
+public:
+    Arg<std::string> path{"path", "Path to model directory or tokenizer.bin"};
+    Arg<int>         vocab_size{"--vocab-size", "Tokenizer vocabulary size", 32000};
+
+    decltype(std::tie(ARGS_LIST)) args_tuple = std::tie(ARGS_LIST);
+};
+
+#undef ARGS_LIST
+
+int main(int argc, char **argv)
+{
+    TokenizerBenchArgs args;
+    ArgParser          parser("nano-vllm tokenizer microbenchmark");
+    if (!args.parse(parser, argc, argv)) {
+        return 1;
+    }
+
+    std::string tokenizer_path = args.path;
+    if (fs::is_directory(tokenizer_path)) {
+        tokenizer_path = (fs::path(tokenizer_path) / "tokenizer.bin").string();
+    }
+    Tokenizer tokenizer(tokenizer_path, args.vocab_size);
+
+    Bench::Roofline roof = Bench::measure_roofline();
+    Bench::print_header();
+
+    const std::string sentence = "Once upon a time, there was a little girl named Lily. She loved to play outside "
+                                 "in the park with her friends and her dog. ";
+
+    for (int repeats : {1, 8, 64}) {
+        std::string text;
+        for (int i = 0; i < repeats; i++) {
+            text += sentence;
+        }
+
+        size_t num_tokens = 0;
+        double t          = Bench::time_per_call([&] {
+            auto tokens = tokenizer.encode(text, true, false);
+            num_tokens  = tokens.size();
+            Bench::do_not_optimize(tokens.data());
+        });
+
+        Bench::report("tokenizer encode",
+                      Bench::shape_str({{"chars", static_cast<int>(text.size())}, {"tokens", (int)num_tokens}}),
+                      t,
+                      0.0,
+                      static_cast<double>(text.size()),
+                      roof);
+    }
+
+    return 0;
+}
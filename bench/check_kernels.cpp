@@ -0,0 +1,1001 @@
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <numeric>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "batch_ops.hpp"
+#include "bench_common.hpp"
+#include "core/attention.hpp"
+#include "core/kernel_table.hpp"
+#include "core/model.hpp"
+#include "core/sampler.hpp"
+#include "model_chunked.hpp"
+#include "ops/activation.hpp"
+#include "ops/linear.hpp"
+#include "ops/logprobs.hpp"
+#include "ops/normalization.hpp"
+#include "ops/positional.hpp"
+#include "utils/argparser.hpp"
+#include "utils/path.hpp"
+
+// ============================================================================
+// Kernel Correctness Harness - Optimized paths vs scalar Ops:: references
+//
+// Every check runs randomized shapes through a kernel variant and the scalar
+// implementation it replaces, then compares outputs element by element. An
+// element passes if it is within max_ulp units in the last place of the
+// reference, or within rtol relative to the reference's largest magnitude
+// (reductions reordered by vectorization drift in ULPs near zero).
+//
+// New kernel variants (ISA-specific, quantized, fused) add a Check to
+// kernel_checks() with a tolerance that matches their precision. Exits
+// non-zero if any check fails. With a model path, also compares final logits
+// of every forward variant against the contiguous token-by-token forward.
+// ============================================================================
+
+struct Tolerance
+{
+    int    max_ulp = 4;
+    double rtol    = 1e-5;
+};
+
+struct Comparison
+{
+    int64_t mismatches  = 0;
+    int64_t max_ulp     = 0;
+    double  max_rel_err = 0.0;
+};
+
+// Distance between two floats in representable steps
+inline int64_t ulp_distance(float a, float b)
+{
+    if (std::isnan(a) || std::isnan(b)) {
+        return INT64_MAX;
+    }
+    int32_t ia, ib;
+    std::memcpy(&ia, &a, sizeof(float));
+    std::memcpy(&ib, &b, sizeof(float));
+    // Map sign-magnitude onto a monotonic integer line
+    int64_t la = ia < 0 ? static_cast<int64_t>(INT32_MIN) - ia : ia;
+    int64_t lb = ib < 0 ? static_cast<int64_t>(INT32_MIN) - ib : ib;
+    return std::llabs(la - lb);
+}
+
+inline Comparison compare(const float *ref, const float *out, size_t n, const Tolerance &tol)
+{
+    float scale = 0.0f;
+    for (size_t i = 0; i < n; i++) {
+        scale = std::max(scale, std::fabs(ref[i]));
+    }
+    scale = std::max(scale, 1e-30f);
+
+    Comparison c;
+    for (size_t i = 0; i < n; i++) {
+        int64_t ulp = ulp_distance(ref[i], out[i]);
+        double  rel = std::fabs(static_cast<double>(ref[i]) - out[i]) / scale;
+        c.max_ulp   = std::max(c.max_ulp, ulp);
+        if (!std::isnan(rel)) {
+            c.max_rel_err = std::max(c.max_rel_err, rel);
+        }
+        if (ulp > tol.max_ulp && !(rel <= tol.rtol)) {
+            c.mismatches++;
+        }
+    }
+    return c;
+}
+
+// ============================================================================
+// Check Registry
+// ============================================================================
+
+struct Check
+{
+    std::string                                          name;
+    Tolerance                                            tol;
+    std::function<Comparison(std::mt19937 &, Tolerance)> run; // One randomized trial
+};
+
+static int random_int(std::mt19937 &rng, int lo, int hi)
+{
+    return std::uniform_int_distribution<int>(lo, hi)(rng);
+}
+
+static std::vector<float> random_vector(std::mt19937 &rng, size_t n, float scale = 1.0f)
+{
+    return Bench::random_vector(n, scale, static_cast<unsigned>(rng()));
+}
+
+static void merge(Comparison &total, const Comparison &c)
+{
+    total.mismatches += c.mismatches;
+    total.max_ulp     = std::max(total.max_ulp, c.max_ulp);
+    total.max_rel_err = std::max(total.max_rel_err, c.max_rel_err);
+}
+
+static std::vector<Check> kernel_checks()
+{
+    std::vector<Check> checks;
+
+    checks.push_back({"batch_matmul vs matmul", {4, 1e-5}, [](std::mt19937 &rng, Tolerance tol) {
+                          int  batch   = random_int(rng, 1, 16);
+                          int  in_dim  = random_int(rng, 1, 512);
+                          int  out_dim = random_int(rng, 1, 512);
+                          auto in      = random_vector(rng, static_cast<size_t>(batch) * in_dim);
+                          auto weight  = random_vector(rng, static_cast<size_t>(in_dim) * out_dim);
+
+                          std::vector<float> ref(static_cast<size_t>(batch) * out_dim), out(ref.size());
+                          for (int b = 0; b < batch; b++) {
+                              Ops::matmul(
+                                  ref.data() + b * out_dim, in.data() + b * in_dim, weight.data(), in_dim, out_dim);
+                          }
+                          BatchOps::batch_matmul(out.data(), in.data(), weight.data(), batch, in_dim, out_dim);
+                          return compare(ref.data(), out.data(), ref.size(), tol);
+                      }});
+
+    checks.push_back({"batch_rms_norm vs rms_norm", {4, 1e-6}, [](std::mt19937 &rng, Tolerance tol) {
+                          int  batch  = random_int(rng, 1, 16);
+                          int  dim    = random_int(rng, 1, 1024);
+                          auto in     = random_vector(rng, static_cast<size_t>(batch) * dim, 4.0f);
+                          auto weight = random_vector(rng, dim);
+
+                          std::vector<float> ref(in.size()), out(in.size());
+                          for (int b = 0; b < batch; b++) {
+                              Ops::rms_norm(ref.data() + b * dim, in.data() + b * dim, weight.data(), dim);
+                          }
+                          BatchOps::batch_rms_norm(out.data(), in.data(), weight.data(), batch, dim);
+                          return compare(ref.data(), out.data(), ref.size(), tol);
+                      }});
+
+    checks.push_back({"matmul_residual vs unfused", {4, 1e-5}, [](std::mt19937 &rng, Tolerance tol) {
+                          int  in_dim   = random_int(rng, 1, 512);
+                          int  out_dim  = random_int(rng, 1, 512);
+                          auto in       = random_vector(rng, in_dim);
+                          auto weight   = random_vector(rng, static_cast<size_t>(in_dim) * out_dim);
+                          auto residual = random_vector(rng, out_dim);
+
+                          std::vector<float> ref(out_dim), out = residual;
+                          Ops::matmul(ref.data(), in.data(), weight.data(), in_dim, out_dim);
+                          for (int i = 0; i < out_dim; i++) {
+                              ref[i] += residual[i];
+                          }
+                          Ops::matmul_residual(out.data(), in.data(), weight.data(), in_dim, out_dim);
+                          return compare(ref.data(), out.data(), ref.size(), tol);
+                      }});
+
+    checks.push_back({"batch_rms_norm_matmul vs unfused", {4, 1e-5}, [](std::mt19937 &rng, Tolerance tol) {
+                          int  batch   = random_int(rng, 1, 16);
+                          int  in_dim  = random_int(rng, 1, 512);
+                          int  out_dim = random_int(rng, 1, 512);
+                          auto in      = random_vector(rng, static_cast<size_t>(batch) * in_dim, 4.0f);
+                          auto norm    = random_vector(rng, in_dim);
+                          auto weight  = random_vector(rng, static_cast<size_t>(in_dim) * out_dim);
+
+                          std::vector<float> ref(static_cast<size_t>(batch) * out_dim), out(ref.size());
+                          std::vector<float> xb(in_dim);
+                          for (int b = 0; b < batch; b++) {
+                              Ops::rms_norm(xb.data(), in.data() + b * in_dim, norm.data(), in_dim);
+                              Ops::matmul(ref.data() + b * out_dim, xb.data(), weight.data(), in_dim, out_dim);
+                          }
+                          std::vector<float> scale(batch), packed(static_cast<size_t>(BatchOps::ROW_TILE) * in_dim);
+                          BatchOps::batch_rms_scale(scale.data(), in.data(), batch, in_dim);
+                          BatchOps::batch_rms_norm_matmul(out.data(),
+                                                          in.data(),
+                                                          scale.data(),
+                                                          norm.data(),
+                                                          weight.data(),
+                                                          packed.data(),
+                                                          batch,
+                                                          in_dim,
+                                                          out_dim);
+                          return compare(ref.data(), out.data(), ref.size(), tol);
+                      }});
+
+    checks.push_back({"batch_matmul_residual vs unfused", {4, 1e-5}, [](std::mt19937 &rng, Tolerance tol) {
+                          int  batch    = random_int(rng, 1, 16);
+                          int  in_dim   = random_int(rng, 1, 512);
+                          int  out_dim  = random_int(rng, 1, 512);
+                          auto in       = random_vector(rng, static_cast<size_t>(batch) * in_dim);
+                          auto weight   = random_vector(rng, static_cast<size_t>(in_dim) * out_dim);
+                          auto residual = random_vector(rng, static_cast<size_t>(batch) * out_dim);
+
+                          std::vector<float> ref(residual.size()), out = residual;
+                          for (int b = 0; b < batch; b++) {
+                              Ops::matmul(
+                                  ref.data() + b * out_dim, in.data() + b * in_dim, weight.data(), in_dim, out_dim);
+                          }
+                          for (size_t i = 0; i < ref.size(); i++) {
+                              ref[i] += residual[i];
+                          }
+                          BatchOps::batch_matmul_residual(out.data(), in.data(), weight.data(), batch, in_dim, out_dim);
+                          return compare(ref.data(), out.data(), ref.size(), tol);
+                      }});
+
+    checks.push_back({"lora vs merged weights", {64, 1e-5}, [](std::mt19937 &rng, Tolerance tol) {
+                          int   in_dim  = random_int(rng, 1, 512);
+                          int   out_dim = random_int(rng, 1, 512);
+                          int   rank    = random_int(rng, 1, 64);
+                          float scale   = std::uniform_real_distribution<float>(0.1f, 4.0f)(rng);
+                          auto  in      = random_vector(rng, in_dim);
+                          auto  weight  = random_vector(rng, static_cast<size_t>(in_dim) * out_dim);
+                          auto  a       = random_vector(rng, static_cast<size_t>(rank) * in_dim);
+                          auto  b       = random_vector(rng, static_cast<size_t>(out_dim) * rank);
+
+                          // Reference: W + scale * B A as one dense matrix
+                          auto merged = weight;
+                          for (int i = 0; i < out_dim; i++) {
+                              for (int j = 0; j < in_dim; j++) {
+                                  double delta = 0.0;
+                                  for (int r = 0; r < rank; r++) {
+                                      delta += static_cast<double>(b[static_cast<size_t>(i) * rank + r])
+                                             * a[static_cast<size_t>(r) * in_dim + j];
+                                  }
+                                  merged[static_cast<size_t>(i) * in_dim + j] += static_cast<float>(scale * delta);
+                              }
+                          }
+                          std::vector<float> ref(out_dim), out(out_dim), buf(rank);
+                          Ops::matmul(ref.data(), in.data(), merged.data(), in_dim, out_dim);
+                          Ops::matmul(out.data(), in.data(), weight.data(), in_dim, out_dim);
+                          Ops::lora(
+                              out.data(), in.data(), a.data(), b.data(), buf.data(), in_dim, rank, out_dim, scale);
+                          return compare(ref.data(), out.data(), ref.size(), tol);
+                      }});
+
+    checks.push_back({"batch_lora vs lora", {2, 1e-6}, [](std::mt19937 &rng, Tolerance tol) {
+                          int in_dim  = random_int(rng, 1, 256);
+                          int out_dim = random_int(rng, 1, 256);
+                          int batch   = 0;
+
+                          // Segments of random adapters (some base-model rows) over the batch
+                          std::vector<BatchOps::LoraSegment> segments(random_int(rng, 1, 6));
+                          std::vector<std::vector<float>>    factors;
+                          int                                max_rank = 1;
+                          for (auto &seg : segments) {
+                              seg.start = batch;
+                              seg.rows  = random_int(rng, 1, 9);
+                              batch += seg.rows;
+                              if (random_int(rng, 0, 3) == 0) {
+                                  continue;
+                              }
+                              seg.rank  = random_int(rng, 1, 32);
+                              seg.scale = std::uniform_real_distribution<float>(0.1f, 4.0f)(rng);
+                              factors.push_back(random_vector(rng, static_cast<size_t>(seg.rank) * in_dim));
+                              seg.a = factors.back().data();
+                              factors.push_back(random_vector(rng, static_cast<size_t>(out_dim) * seg.rank));
+                              seg.b    = factors.back().data();
+                              max_rank = std::max(max_rank, seg.rank);
+                          }
+                          auto in  = random_vector(rng, static_cast<size_t>(batch) * in_dim);
+                          auto ref = random_vector(rng, static_cast<size_t>(batch) * out_dim);
+                          auto out = ref;
+
+                          std::vector<float> buf(static_cast<size_t>(BatchOps::ROW_TILE) * max_rank);
+                          for (const auto &seg : segments) {
+                              for (int row = seg.start; seg.a && row < seg.start + seg.rows; row++) {
+                                  Ops::lora(ref.data() + static_cast<size_t>(row) * out_dim,
+                                            in.data() + static_cast<size_t>(row) * in_dim,
+                                            seg.a,
+                                            seg.b,
+                                            buf.data(),
+                                            in_dim,
+                                            seg.rank,
+                                            out_dim,
+                                            seg.scale);
+                              }
+                          }
+                          BatchOps::batch_lora(out.data(),
+                                               in.data(),
+                                               segments.data(),
+                                               static_cast<int>(segments.size()),
+                                               buf.data(),
+                                               in_dim,
+                                               out_dim);
+                          return compare(ref.data(), out.data(), ref.size(), tol);
+                      }});
+
+    checks.push_back({"batch_rope vs apply_rope", {2, 1e-6}, [](std::mt19937 &rng, Tolerance tol) {
+                          int  batch      = random_int(rng, 1, 16);
+                          int  head_dim   = 2 * random_int(rng, 1, 64);
+                          int  n_kv_heads = random_int(rng, 1, 8);
+                          int  n_heads    = n_kv_heads * random_int(rng, 1, 4);
+                          int  start_pos  = random_int(rng, 0, 2048);
+                          auto q          = random_vector(rng, static_cast<size_t>(batch) * n_heads * head_dim);
+                          auto k          = random_vector(rng, static_cast<size_t>(batch) * n_kv_heads * head_dim);
+
+                          auto q_ref = q, k_ref = k;
+                          for (int b = 0; b < batch; b++) {
+                              Ops::apply_rope(q_ref.data() + b * n_heads * head_dim,
+                                              k_ref.data() + b * n_kv_heads * head_dim,
+                                              start_pos + b,
+                                              head_dim,
+                                              n_heads,
+                                              n_kv_heads,
+                                              10000.0f);
+                          }
+                          BatchOps::batch_rope(
+                              q.data(), k.data(), start_pos, batch, head_dim, n_heads, n_kv_heads, 10000.0f);
+
+                          Comparison c = compare(q_ref.data(), q.data(), q.size(), tol);
+                          merge(c, compare(k_ref.data(), k.data(), k.size(), tol));
+                          return c;
+                      }});
+
+    checks.push_back({"paged vs standard attention", {8, 1e-5}, [](std::mt19937 &rng, Tolerance tol) {
+                          int head_dim   = 2 * random_int(rng, 4, 64);
+                          int n_kv_heads = random_int(rng, 1, 8);
+                          int n_heads    = n_kv_heads * random_int(rng, 1, 4);
+                          int block_size = 1 << random_int(rng, 0, 6);
+                          int num_tokens = random_int(rng, 1, 1024);
+                          int kv_dim     = n_kv_heads * head_dim;
+                          int num_blocks = (num_tokens + block_size - 1) / block_size;
+
+                          auto q = random_vector(rng, static_cast<size_t>(n_heads) * head_dim);
+                          auto k = random_vector(rng, static_cast<size_t>(num_tokens) * kv_dim);
+                          auto v = random_vector(rng, static_cast<size_t>(num_tokens) * kv_dim);
+
+                          // Scatter the contiguous cache into shuffled physical blocks
+                          std::vector<int> block_table(num_blocks);
+                          std::iota(block_table.begin(), block_table.end(), 0);
+                          std::shuffle(block_table.begin(), block_table.end(), rng);
+                          std::vector<float> paged_k(static_cast<size_t>(num_blocks) * block_size * kv_dim);
+                          std::vector<float> paged_v(paged_k.size());
+                          for (int t = 0; t < num_tokens; t++) {
+                              size_t slot = (static_cast<size_t>(block_table[t / block_size]) * block_size
+                                             + t % block_size)
+                                          * kv_dim;
+                              std::memcpy(&paged_k[slot], &k[static_cast<size_t>(t) * kv_dim], kv_dim * sizeof(float));
+                              std::memcpy(&paged_v[slot], &v[static_cast<size_t>(t) * kv_dim], kv_dim * sizeof(float));
+                          }
+
+                          std::vector<float> ref(static_cast<size_t>(n_heads) * head_dim), out(ref.size());
+                          std::vector<float> att(static_cast<size_t>(n_heads) * num_tokens);
+                          Attention::standard_attention(ref.data(),
+                                                        q.data(),
+                                                        k.data(),
+                                                        v.data(),
+                                                        att.data(),
+                                                        num_tokens - 1,
+                                                        head_dim,
+                                                        n_heads,
+                                                        n_kv_heads,
+                                                        num_tokens);
+                          Attention::paged_attention(out.data(),
+                                                     q.data(),
+                                                     paged_k.data(),
+                                                     paged_v.data(),
+                                                     block_table.data(),
+                                                     att.data(),
+                                                     num_tokens,
+                                                     block_size,
+                                                     head_dim,
+                                                     n_heads,
+                                                     n_kv_heads);
+                          return compare(ref.data(), out.data(), ref.size(), tol);
+                      }});
+
+    checks.push_back({"sliding window vs truncated cache", {8, 1e-5}, [](std::mt19937 &rng, Tolerance tol) {
+                          int head_dim   = 2 * random_int(rng, 4, 64);
+                          int n_kv_heads = random_int(rng, 1, 8);
+                          int n_heads    = n_kv_heads * random_int(rng, 1, 4);
+                          int block_size = 1 << random_int(rng, 0, 6);
+                          int num_tokens = random_int(rng, 1, 512);
+                          int window     = random_int(rng, 1, num_tokens);
+                          int start      = num_tokens - window;
+                          int kv_dim     = n_kv_heads * head_dim;
+                          int num_blocks = (num_tokens + block_size - 1) / block_size;
+
+                          auto q = random_vector(rng, static_cast<size_t>(n_heads) * head_dim);
+                          auto k = random_vector(rng, static_cast<size_t>(num_tokens) * kv_dim);
+                          auto v = random_vector(rng, static_cast<size_t>(num_tokens) * kv_dim);
+
+                          // Reference: full attention over a cache holding only the window
+                          std::vector<float> ref(static_cast<size_t>(n_heads) * head_dim), out(ref.size());
+                          std::vector<float> att(static_cast<size_t>(n_heads) * num_tokens);
+                          Attention::standard_attention(ref.data(),
+                                                        q.data(),
+                                                        k.data() + static_cast<size_t>(start) * kv_dim,
+                                                        v.data() + static_cast<size_t>(start) * kv_dim,
+                                                        att.data(),
+                                                        window - 1,
+                                                        head_dim,
+                                                        n_heads,
+                                                        n_kv_heads,
+                                                        window);
+
+                          // Contiguous ring of window rows
+                          std::vector<float> ring_k(static_cast<size_t>(window) * kv_dim), ring_v(ring_k.size());
+                          for (int t = start; t < num_tokens; t++) {
+                              size_t row = static_cast<size_t>(t % window) * kv_dim;
+                              std::memcpy(&ring_k[row], &k[static_cast<size_t>(t) * kv_dim], kv_dim * sizeof(float));
+                              std::memcpy(&ring_v[row], &v[static_cast<size_t>(t) * kv_dim], kv_dim * sizeof(float));
+                          }
+                          Attention::standard_attention(out.data(),
+                                                        q.data(),
+                                                        ring_k.data(),
+                                                        ring_v.data(),
+                                                        att.data(),
+                                                        num_tokens - 1,
+                                                        head_dim,
+                                                        n_heads,
+                                                        n_kv_heads,
+                                                        num_tokens,
+                                                        window);
+                          Comparison c = compare(ref.data(), out.data(), ref.size(), tol);
+
+                          // Paged, with the blocks before the window recycled (-1)
+                          std::vector<int> block_table(num_blocks);
+                          std::iota(block_table.begin(), block_table.end(), 0);
+                          std::shuffle(block_table.begin(), block_table.end(), rng);
+                          std::vector<float> paged_k(static_cast<size_t>(num_blocks) * block_size * kv_dim);
+                          std::vector<float> paged_v(paged_k.size());
+                          for (int t = start; t < num_tokens; t++) {
+                              size_t slot = (static_cast<size_t>(block_table[t / block_size]) * block_size
+                                             + t % block_size)
+                                          * kv_dim;
+                              std::memcpy(&paged_k[slot], &k[static_cast<size_t>(t) * kv_dim], kv_dim * sizeof(float));
+                              std::memcpy(&paged_v[slot], &v[static_cast<size_t>(t) * kv_dim], kv_dim * sizeof(float));
+                          }
+                          std::fill(block_table.begin(), block_table.begin() + start / block_size, -1);
+                          Attention::paged_attention(out.data(),
+                                                     q.data(),
+                                                     paged_k.data(),
+                                                     paged_v.data(),
+                                                     block_table.data(),
+                                                     att.data(),
+                                                     num_tokens,
+                                                     block_size,
+                                                     head_dim,
+                                                     n_heads,
+                                                     n_kv_heads,
+                                                     window);
+                          merge(c, compare(ref.data(), out.data(), ref.size(), tol));
+                          return c;
+                      }});
+
+    checks.push_back({"attention sinks vs gathered cache", {8, 1e-5}, [](std::mt19937 &rng, Tolerance tol) {
+                          int head_dim   = 2 * random_int(rng, 4, 64);
+                          int n_kv_heads = random_int(rng, 1, 8);
+                          int n_heads    = n_kv_heads * random_int(rng, 1, 4);
+                          int block_size = 1 << random_int(rng, 0, 6);
+                          int num_tokens = random_int(rng, 1, 512);
+                          int window     = random_int(rng, 1, num_tokens);
+                          int sinks      = random_int(rng, 1, 8);
+                          int start      = num_tokens - window;
+                          int n_sinks    = std::min(sinks, start);
+                          int span       = n_sinks + window;
+                          int kv_dim     = n_kv_heads * head_dim;
+                          int num_blocks = (num_tokens + block_size - 1) / block_size;
+
+                          auto q = random_vector(rng, static_cast<size_t>(n_heads) * head_dim);
+                          auto k = random_vector(rng, static_cast<size_t>(num_tokens) * kv_dim);
+                          auto v = random_vector(rng, static_cast<size_t>(num_tokens) * kv_dim);
+
+                          // Reference: full attention over the sinks followed by the window
+                          std::vector<float> gathered_k, gathered_v;
+                          for (int t = 0; t < num_tokens; t++) {
+                              if (t < n_sinks || t >= start) {
+                                  auto row = static_cast<size_t>(t) * kv_dim;
+                                  gathered_k.insert(gathered_k.end(), &k[row], &k[row] + kv_dim);
+                                  gathered_v.insert(gathered_v.end(), &v[row], &v[row] + kv_dim);
+                              }
+                          }
+                          std::vector<float> ref(static_cast<size_t>(n_heads) * head_dim), out(ref.size());
+                          std::vector<float> att(static_cast<size_t>(n_heads) * span);
+                          Attention::standard_attention(ref.data(),
+                                                        q.data(),
+                                                        gathered_k.data(),
+                                                        gathered_v.data(),
+                                                        att.data(),
+                                                        span - 1,
+                                                        head_dim,
+                                                        n_heads,
+                                                        n_kv_heads,
+                                                        span);
+
+                          // Paged, with the blocks between sinks and window recycled (-1)
+                          std::vector<int> block_table(num_blocks);
+                          std::iota(block_table.begin(), block_table.end(), 0);
+                          std::shuffle(block_table.begin(), block_table.end(), rng);
+                          std::vector<float> paged_k(static_cast<size_t>(num_blocks) * block_size * kv_dim);
+                          std::vector<float> paged_v(paged_k.size());
+                          for (int t = 0; t < num_tokens; t++) {
+                              size_t slot = (static_cast<size_t>(block_table[t / block_size]) * block_size
+                                             + t % block_size)
+                                          * kv_dim;
+                              std::memcpy(&paged_k[slot], &k[static_cast<size_t>(t) * kv_dim], kv_dim * sizeof(float));
+                              std::memcpy(&paged_v[slot], &v[static_cast<size_t>(t) * kv_dim], kv_dim * sizeof(float));
+                          }
+                          int sink_blocks = (n_sinks + block_size - 1) / block_size;
+                          for (int b = sink_blocks; b < start / block_size; b++) {
+                              block_table[b] = -1;
+                          }
+                          Attention::paged_attention(out.data(),
+                                                     q.data(),
+                                                     paged_k.data(),
+                                                     paged_v.data(),
+                                                     block_table.data(),
+                                                     att.data(),
+                                                     num_tokens,
+                                                     block_size,
+                                                     head_dim,
+                                                     n_heads,
+                                                     n_kv_heads,
+                                                     window,
+                                                     sinks);
+                          return compare(ref.data(), out.data(), ref.size(), tol);
+                      }});
+
+    // Attention sinks move cached keys to new positions by rotating them again
+    checks.push_back({"rope shift vs rope at position", {64, 1e-4}, [](std::mt19937 &rng, Tolerance tol) {
+                          int  head_dim   = 2 * random_int(rng, 1, 64);
+                          int  n_kv_heads = random_int(rng, 1, 8);
+                          int  pos        = random_int(rng, 0, 512);
+                          int  shift      = random_int(rng, 0, pos);
+                          auto k          = random_vector(rng, static_cast<size_t>(n_kv_heads) * head_dim);
+
+                          auto k_ref = k;
+                          Ops::apply_rope(k_ref.data(), k_ref.data(), pos - shift, head_dim, 0, n_kv_heads, 10000.0f);
+                          Ops::apply_rope(k.data(), k.data(), pos, head_dim, 0, n_kv_heads, 10000.0f);
+                          Ops::apply_rope(k.data(), k.data(), -shift, head_dim, 0, n_kv_heads, 10000.0f);
+                          return compare(k_ref.data(), k.data(), k.size(), tol);
+                      }});
+
+    checks.push_back({"specialized vs generic kernels", {2, 1e-6}, [](std::mt19937 &rng, Tolerance tol) {
+                          const int dims[]        = {2048, 4096};
+                          const int head_dims[]   = {64, 128};
+                          const int block_sizes[] = {16, 32, 8};
+                          int       dim           = dims[random_int(rng, 0, 1)];
+                          int       head_dim      = head_dims[random_int(rng, 0, 1)];
+                          int       block_size    = block_sizes[random_int(rng, 0, 2)];
+                          int       n_kv_heads    = random_int(rng, 1, 4);
+                          int       n_heads       = n_kv_heads * random_int(rng, 1, 4);
+                          int       num_tokens    = random_int(rng, 1, 256);
+                          int       kv_dim        = n_kv_heads * head_dim;
+                          int       num_blocks    = (num_tokens + block_size - 1) / block_size;
+
+                          KernelTable generic;
+                          KernelTable fixed = KernelTable::select(dim, head_dim, block_size);
+
+                          auto               in     = random_vector(rng, dim, 4.0f);
+                          auto               weight = random_vector(rng, dim);
+                          std::vector<float> ref(dim), out(dim);
+                          generic.rms_norm(ref.data(), in.data(), weight.data(), dim);
+                          fixed.rms_norm(out.data(), in.data(), weight.data(), dim);
+                          Comparison c = compare(ref.data(), out.data(), ref.size(), tol);
+
+                          int  pos   = random_int(rng, 0, 2048);
+                          auto q     = random_vector(rng, static_cast<size_t>(n_heads) * head_dim);
+                          auto k     = random_vector(rng, static_cast<size_t>(kv_dim));
+                          auto q_ref = q, k_ref = k;
+                          generic.apply_rope(q_ref.data(), k_ref.data(), pos, head_dim, n_heads, n_kv_heads, 10000.0f);
+                          fixed.apply_rope(q.data(), k.data(), pos, head_dim, n_heads, n_kv_heads, 10000.0f);
+                          merge(c, compare(q_ref.data(), q.data(), q.size(), tol));
+                          merge(c, compare(k_ref.data(), k.data(), k.size(), tol));
+
+                          auto key   = random_vector(rng, static_cast<size_t>(num_tokens) * kv_dim);
+                          auto value = random_vector(rng, static_cast<size_t>(num_tokens) * kv_dim);
+                          std::vector<int> block_table(num_blocks);
+                          std::iota(block_table.begin(), block_table.end(), 0);
+                          std::shuffle(block_table.begin(), block_table.end(), rng);
+
+                          std::vector<float> att(static_cast<size_t>(n_heads) * num_tokens);
+                          ref.assign(static_cast<size_t>(n_heads) * head_dim, 0.0f);
+                          out.assign(ref.size(), 0.0f);
+                          generic.standard_attention(ref.data(),
+                                                     q.data(),
+                                                     key.data(),
+                                                     value.data(),
+                                                     att.data(),
+                                                     num_tokens - 1,
+                                                     head_dim,
+                                                     n_heads,
+                                                     n_kv_heads,
+                                                     num_tokens);
+                          fixed.standard_attention(out.data(),
+                                                   q.data(),
+                                                   key.data(),
+                                                   value.data(),
+                                                   att.data(),
+                                                   num_tokens - 1,
+                                                   head_dim,
+                                                   n_heads,
+                                                   n_kv_heads,
+                                                   num_tokens);
+                          merge(c, compare(ref.data(), out.data(), ref.size(), tol));
+
+                          // The cache buffers serve as a (partially filled) block pool
+                          std::vector<float> paged_k(static_cast<size_t>(num_blocks) * block_size * kv_dim);
+                          std::vector<float> paged_v(paged_k.size());
+                          std::copy(key.begin(), key.end(), paged_k.begin());
+                          std::copy(value.begin(), value.end(), paged_v.begin());
+                          generic.paged_attention(ref.data(),
+                                                  q.data(),
+                                                  paged_k.data(),
+                                                  paged_v.data(),
+                                                  block_table.data(),
+                                                  att.data(),
+                                                  num_tokens,
+                                                  block_size,
+                                                  head_dim,
+                                                  n_heads,
+                                                  n_kv_heads);
+                          fixed.paged_attention(out.data(),
+                                                q.data(),
+                                                paged_k.data(),
+                                                paged_v.data(),
+                                                block_table.data(),
+                                                att.data(),
+                                                num_tokens,
+                                                block_size,
+                                                head_dim,
+                                                n_heads,
+                                                n_kv_heads);
+                          merge(c, compare(ref.data(), out.data(), ref.size(), tol));
+                          return c;
+                      }});
+
+    checks.push_back({"log_sum_exp vs double log_softmax", {64, 1e-5}, [](std::mt19937 &rng, Tolerance tol) {
+                          int  size   = random_int(rng, 1, 40000);
+                          auto logits = random_vector(rng, size, 20.0f);
+
+                          double max_val = *std::max_element(logits.begin(), logits.end());
+                          double sum     = 0.0;
+                          for (float x : logits) {
+                              sum += std::exp(x - max_val);
+                          }
+                          double             lse = max_val + std::log(sum);
+                          std::vector<float> ref(size), out(size);
+                          float              fused = Ops::log_sum_exp(logits.data(), size);
+                          for (int i = 0; i < size; i++) {
+                              ref[i] = static_cast<float>(logits[i] - lse);
+                              out[i] = logits[i] - fused;
+                          }
+                          return compare(ref.data(), out.data(), ref.size(), tol);
+                      }});
+
+    checks.push_back({"top_k_logprobs vs sorted", {0, 0.0}, [](std::mt19937 &rng, Tolerance tol) {
+                          int  size   = random_int(rng, 1, 5000);
+                          int  k      = random_int(rng, 0, 64);
+                          auto logits = random_vector(rng, size, 4.0f);
+                          for (float &x : logits) {
+                              x = std::round(x * 4.0f) / 4.0f; // Ties must break toward the lower token
+                          }
+                          float lse = Ops::log_sum_exp(logits.data(), size);
+
+                          std::vector<int> order(size);
+                          std::iota(order.begin(), order.end(), 0);
+                          std::stable_sort(
+                              order.begin(), order.end(), [&](int a, int b) { return logits[a] > logits[b]; });
+                          int                            n = std::min(k, size);
+                          std::vector<Ops::TokenLogprob> top(std::max(k, 1));
+                          if (Ops::top_k_logprobs(top.data(), logits.data(), size, k, lse) != n) {
+                              return Comparison{1, 0, 0.0};
+                          }
+                          std::vector<float> ref, out;
+                          for (int i = 0; i < n; i++) {
+                              ref.insert(ref.end(), {static_cast<float>(order[i]), logits[order[i]] - lse});
+                              out.insert(out.end(), {static_cast<float>(top[i].token), top[i].logprob});
+                          }
+                          return compare(ref.data(), out.data(), ref.size(), tol);
+                      }});
+
+    // Logprobs are read before temperature and must not change what is sampled
+    checks.push_back({"sample with logprobs vs sample", {64, 1e-5}, [](std::mt19937 &rng, Tolerance tol) {
+                          int      vocab       = random_int(rng, 1, 5000);
+                          float    temperature = random_int(rng, 0, 3) * 0.5f;
+                          float    topp        = random_int(rng, 0, 1) ? 0.9f : 1.0f;
+                          unsigned seed        = static_cast<unsigned>(rng());
+                          Sampler  plain(vocab, temperature, topp, seed), with_logprobs(vocab, temperature, topp, seed);
+
+                          Comparison c;
+                          for (int step = 0; step < 4; step++) {
+                              auto logits = random_vector(rng, vocab, 5.0f);
+                              auto copy   = logits;
+
+                              float                          logprob;
+                              std::vector<Ops::TokenLogprob> top;
+                              int expected = plain.sample(copy.data());
+                              int token    = with_logprobs.sample(logits.data(), logprob, top, 3);
+                              if (token != expected || top.empty() || top[0].logprob < logprob) {
+                                  c.mismatches++;
+                                  continue;
+                              }
+                              double max_val = *std::max_element(logits.begin(), logits.end());
+                              double sum     = 0.0;
+                              for (float x : logits) {
+                                  sum += std::exp(x - max_val);
+                              }
+                              float ref = static_cast<float>(logits[token] - max_val - std::log(sum));
+                              merge(c, compare(&ref, &logprob, 1, tol));
+                          }
+                          return c;
+                      }});
+
+    return checks;
+}
+
+// ============================================================================
+// Reporting
+// ============================================================================
+
+static void print_header()
+{
+    std::cout << "\n"
+              << std::left << std::setw(36) << "check" << std::right << std::setw(8) << "trials" << std::setw(12)
+              << "max ulp" << std::setw(14) << "max rel err" << std::setw(12) << "mismatch" << std::setw(8)
+              << "result"
+              << "\n";
+    std::cout << std::string(90, '-') << "\n";
+}
+
+static bool report(const std::string &name, int trials, const Comparison &c)
+{
+    bool pass = c.mismatches == 0;
+    std::cout << std::left << std::setw(36) << name << std::right << std::setw(8) << trials << std::setw(12)
+              << c.max_ulp << std::scientific << std::setprecision(2) << std::setw(14) << c.max_rel_err
+              << std::defaultfloat << std::setw(12) << c.mismatches << std::setw(8) << (pass ? "PASS" : "FAIL")
+              << "\n";
+    return pass;
+}
+
+// ============================================================================
+// End-to-end Logits - Forward variants vs contiguous token-by-token forward
+// ============================================================================
+
+static void load_variant(LlamaModel &model, const std::string &path, bool paged, int block_size)
+{
+    model.load(path);
+    model.config.use_paged_attention = paged;
+    model.config.block_size          = block_size;
+    model.config.num_blocks          = (model.config.max_seq_len + block_size - 1) / block_size;
+    model.initialize_paged_attention();
+}
+
+// Logits of a forward with attention sinks that keeps every key un-rotated
+// and rotates the attended ones at their cache position on every step; the
+// paged model instead re-rotates cached keys as blocks are recycled
+static std::vector<std::vector<float>>
+sink_reference_logits(const LlamaModel &model, const std::vector<int> &tokens, int window, int sinks, int block_size)
+{
+    const Config &c           = model.config;
+    const auto   &w           = *model.weights;
+    int           kv_dim      = c.n_kv_heads * c.head_dim;
+    int           sink_blocks = (sinks + block_size - 1) / block_size;
+    size_t        layer_elems = tokens.size() * kv_dim;
+
+    std::vector<float> x(c.dim), xb(c.dim), xb2(c.dim), hb(c.hidden_dim), hb2(c.hidden_dim), q(c.dim);
+    std::vector<float> keys(c.n_layers * layer_elems), values(keys.size()), logits(c.vocab_size);
+    std::vector<float> att(static_cast<size_t>(c.n_heads) * tokens.size());
+    std::vector<std::vector<float>> all_logits;
+
+    for (int pos = 0; pos < static_cast<int>(tokens.size()); pos++) {
+        int first_needed = std::max(0, pos - window + 1) / block_size;
+        int recycled     = std::max(0, first_needed - sink_blocks);
+        int start        = std::max(0, pos + 1 - window);
+        int n_sinks      = std::min(sinks, start);
+        auto cache_pos   = [&](int t) { return t < sink_blocks * block_size ? t : t - recycled * block_size; };
+
+        std::memcpy(x.data(), w.token_embedding_table.data() + tokens[pos] * c.dim, c.dim * sizeof(float));
+        for (int l = 0; l < c.n_layers; l++) {
+            const auto &lw = w.layers[l];
+            float      *k  = keys.data() + l * layer_elems;
+            float      *v  = values.data() + l * layer_elems;
+            Ops::rms_norm(xb.data(), x.data(), lw.rms_att_weight.data(), c.dim);
+            Ops::matmul(q.data(), xb.data(), lw.wq.data(), c.dim, c.n_heads * c.head_dim);
+            Ops::matmul(k + pos * kv_dim, xb.data(), lw.wk.data(), c.dim, kv_dim);
+            Ops::matmul(v + pos * kv_dim, xb.data(), lw.wv.data(), c.dim, kv_dim);
+            Ops::apply_rope(q.data(), nullptr, cache_pos(pos), c.head_dim, c.n_heads, 0, c.rope_theta);
+
+            std::vector<float> gathered_k, gathered_v;
+            for (int t = 0; t <= pos; t++) {
+                if (t < n_sinks || t >= start) {
+                    gathered_k.insert(gathered_k.end(), k + t * kv_dim, k + (t + 1) * kv_dim);
+                    gathered_v.insert(gathered_v.end(), v + t * kv_dim, v + (t + 1) * kv_dim);
+                    float *row = gathered_k.data() + gathered_k.size() - kv_dim;
+                    Ops::apply_rope(row, row, cache_pos(t), c.head_dim, 0, c.n_kv_heads, c.rope_theta);
+                }
+            }
+            int span = static_cast<int>(gathered_k.size()) / kv_dim;
+            Attention::standard_attention(xb2.data(),
+                                          q.data(),
+                                          gathered_k.data(),
+                                          gathered_v.data(),
+                                          att.data(),
+                                          span - 1,
+                                          c.head_dim,
+                                          c.n_heads,
+                                          c.n_kv_heads,
+                                          span);
+            Ops::matmul_residual(x.data(), xb2.data(), lw.wo.data(), c.n_heads * c.head_dim, c.dim);
+
+            Ops::rms_norm(xb.data(), x.data(), lw.rms_ffn_weight.data(), c.dim);
+            Ops::matmul(hb.data(), xb.data(), lw.w_gate.data(), c.dim, c.hidden_dim);
+            Ops::matmul(hb2.data(), xb.data(), lw.w_up.data(), c.dim, c.hidden_dim);
+            Ops::swiglu(hb.data(), hb.data(), hb2.data(), c.hidden_dim);
+            Ops::matmul_residual(x.data(), hb.data(), lw.w_down.data(), c.hidden_dim, c.dim);
+        }
+        Ops::rms_norm(x.data(), x.data(), w.rms_final_weight.data(), c.dim);
+        Ops::matmul(logits.data(), x.data(), w.lm_head.data(), c.dim, c.vocab_size);
+        all_logits.push_back(logits);
+    }
+    return all_logits;
+}
+
+static bool check_end_to_end(const std::string &path, int num_tokens, unsigned seed, const Tolerance &tol)
+{
+    LlamaModel reference;
+    load_variant(reference, path, false, 16);
+    num_tokens = std::min(num_tokens, reference.config.max_seq_len);
+
+    std::mt19937     rng(seed);
+    std::vector<int> tokens(num_tokens);
+    for (int &token : tokens) {
+        token = random_int(rng, 0, reference.config.vocab_size - 1);
+    }
+
+    // Reference logits after every position
+    std::vector<std::vector<float>> ref_logits;
+    for (int pos = 0; pos < num_tokens; pos++) {
+        reference.forward(tokens[pos], pos);
+        ref_logits.emplace_back(reference.state.logits.begin(), reference.state.logits.end());
+    }
+
+    bool all_pass = true;
+    for (int block_size : {1, 16, 32}) {
+        LlamaModel paged;
+        load_variant(paged, path, true, block_size);
+        Comparison total;
+        for (int pos = 0; pos < num_tokens; pos++) {
+            paged.forward(tokens[pos], pos);
+            merge(total, compare(ref_logits[pos].data(), paged.state.logits.data(), ref_logits[pos].size(), tol));
+        }
+        all_pass &= report("logits paged bs=" + std::to_string(block_size), num_tokens, total);
+    }
+
+    for (int chunk_size : {1, 7, 64}) {
+        LlamaModelChunked chunked;
+        load_variant(chunked, path, false, 16);
+        Comparison total;
+        for (const auto &chunk : ChunkedPrefill::create_chunks(tokens, chunk_size)) {
+            chunked.forward_chunk(chunk.tokens, chunk.start_pos);
+            int last = chunk.start_pos + static_cast<int>(chunk.tokens.size()) - 1;
+            merge(total, compare(ref_logits[last].data(), chunked.state.logits.data(), ref_logits[last].size(), tol));
+        }
+        all_pass &= report("logits chunked prefill c=" + std::to_string(chunk_size), num_tokens, total);
+    }
+
+    // Scoring: log_softmax of the reference logits at each next token, and
+    // the top-5 log-probabilities at each position
+    for (int chunk_size : {1, 7, 64}) {
+        LlamaModelChunked chunked;
+        load_variant(chunked, path, false, 16);
+        auto               scores = chunked.score(tokens, chunk_size, 5);
+        std::vector<float> ref, out;
+        for (size_t i = 0; i < scores.size(); i++) {
+            const auto &logits = ref_logits[i];
+            double      max_val = *std::max_element(logits.begin(), logits.end());
+            double      sum     = 0.0;
+            for (float x : logits) {
+                sum += std::exp(x - max_val);
+            }
+            double lse = max_val + std::log(sum);
+
+            std::vector<float> sorted(logits.begin(), logits.end());
+            std::sort(sorted.begin(), sorted.end(), std::greater<float>());
+            ref.push_back(static_cast<float>(logits[tokens[i + 1]] - lse));
+            out.push_back(scores[i].logprob);
+            for (int j = 0; j < 5; j++) {
+                ref.push_back(static_cast<float>(sorted[j] - lse));
+                out.push_back(scores[i].top[j].logprob);
+            }
+        }
+        all_pass &= report("logprobs chunked scoring c=" + std::to_string(chunk_size),
+                           static_cast<int>(scores.size()),
+                           compare(ref.data(), out.data(), ref.size(), tol));
+    }
+
+    // Sliding window: the contiguous ring and the paged cache (whose pool only
+    // fits the window in every layer, so blocks must be recycled) must agree
+    int window = std::max(1, num_tokens / 3);
+    for (int block_size : {1, 16}) {
+        LlamaModel ring, paged;
+        ring.load(path);
+        ring.config.use_paged_attention = false;
+        ring.set_sliding_window(window);
+        paged.load(path);
+        paged.config.use_paged_attention = true;
+        paged.config.block_size          = block_size;
+        paged.config.num_blocks          = paged.config.n_layers * ((window + block_size - 1) / block_size + 1);
+        paged.set_sliding_window(window);
+        paged.initialize_paged_attention();
+        Comparison total;
+        for (int pos = 0; pos < num_tokens; pos++) {
+            ring.forward(tokens[pos], pos);
+            paged.forward(tokens[pos], pos);
+            merge(total, compare(ring.state.logits.data(), paged.state.logits.data(), ring.state.logits.size(), tol));
+        }
+        all_pass &= report("logits window paged bs=" + std::to_string(block_size), num_tokens, total);
+    }
+
+    // Attention sinks: runs past max_seq_len in a pool that only fits the sink
+    // blocks and the window, against the un-rotated reference
+    int sinks      = 4;
+    int long_steps = 2 * num_tokens + 8;
+    std::vector<int> long_tokens(long_steps);
+    for (int &token : long_tokens) {
+        token = random_int(rng, 0, reference.config.vocab_size - 1);
+    }
+    for (int block_size : {1, 16}) {
+        LlamaModel paged;
+        paged.load(path);
+        paged.config.use_paged_attention = true;
+        paged.config.block_size          = block_size;
+
+        int blocks_per_layer = (sinks + block_size - 1) / block_size + (window + block_size - 1) / block_size + 1;
+        paged.config.max_seq_len = num_tokens;
+        paged.config.num_blocks  = paged.config.n_layers * blocks_per_layer;
+        paged.set_sliding_window(window);
+        paged.set_attention_sinks(sinks);
+        paged.initialize_paged_attention();
+        auto       expected = sink_reference_logits(paged, long_tokens, window, sinks, block_size);
+        Comparison total;
+        for (int pos = 0; pos < long_steps; pos++) {
+            paged.forward(long_tokens[pos], pos);
+            merge(total, compare(expected[pos].data(), paged.state.logits.data(), expected[pos].size(), tol));
+        }
+        all_pass &= report("logits sinks paged bs=" + std::to_string(block_size), long_steps, total);
+    }
+
+    return all_pass;
+}
+
+#define ARGS_LIST path, trials, seed, num_tokens
+
+class CheckKernelsArgs : public ArgConfig<CheckKernelsArgs>
+{
+public:
+    Arg<std::string> path{"--model", "Model directory or .bin for end-to-end logits checks", ""};
+    Arg<int>         trials{"--trials", "Randomized shapes per kernel check", 50};
+    Arg<int>         seed{"--seed", "Random seed", 1234};
+    Arg<int>         num_tokens{"--num-tokens", "Positions compared in end-to-end checks", 64};
+
+    decltype(std::tie(ARGS_LIST)) args_tuple = std::tie(ARGS_LIST);
+};
+
+#undef ARGS_LIST
+
+int main(int argc, char **argv)
+{
+    CheckKernelsArgs args;
+    ArgParser        parser("nano-vllm kernel correctness checks");
+    if (!args.parse(parser, argc, argv)) {
+        return 1;
+    }
+
+    bool all_pass = true;
+    print_header();
+
+    std::mt19937 rng(static_cast<unsigned>(args.seed.value));
+    for (const auto &check : kernel_checks()) {
+        Comparison total;
+        for (int i = 0; i < args.trials; i++) {
+            merge(total, check.run(rng, check.tol));
+        }
+        all_pass &= report(check.name, args.trials, total);
+    }
+
+    if (!args.path.value.empty()) {
+        auto [model_path, tokenizer_path] = resolve_model_paths(args.path);
+        // Layers compound rounding differences; judge logits at a looser relative bound
+        all_pass &= check_end_to_end(model_path, args.num_tokens, static_cast<unsigned>(args.seed.value), {64, 1e-4});
+    }
+
+    std::cout << std::string(90, '-') << "\n" << (all_pass ? "All checks passed" : "Some checks FAILED") << "\n";
+    return all_pass ? 0 : 1;
+}
@@ -1,6 +1,8 @@
 #pragma once
 
+#include <algorithm>
 #include <cmath>
+#include <cstddef>
 #include <cstring>
 
 namespace BatchOps {
@@ -75,4 +77,153 @@ inline void batch_rms_norm(float *out, const float *in, const float *weight, int
     }
 }
 
+// ============================================================================
+// Fused kernels - RMSNorm folded into the matmul input, residual add folded
+// into the matmul output
+//
+// Rows of the batch go through the weights ROW_TILE at a time, so each weight
+// row is loaded once per tile instead of once per token. The normalized input
+// is never written out: batch_rms_scale computes each row's factor once (it
+// is shared by every matmul reading that norm), and batch_rms_norm_matmul
+// applies it while packing a tile of rows into a small buffer that stays in
+// cache. batch_matmul_residual adds into the residual stream instead of
+// writing a projection buffer for a separate add loop.
+// ============================================================================
+
+constexpr int ROW_TILE = 4;
+
+// out rows (= or += per RESIDUAL) for up to ROW_TILE contiguous input rows
+template <bool RESIDUAL>
+inline void matmul_tile(float *out, const float *in, const float *weight, int rows, int in_dim, int out_dim)
+{
+    for (int i = 0; i < out_dim; i++) {
+        const float *w_row         = weight + static_cast<size_t>(i) * in_dim;
+        float        val[ROW_TILE] = {};
+        for (int j = 0; j < in_dim; j++) {
+            for (int r = 0; r < rows; r++) {
+                val[r] += in[r * in_dim + j] * w_row[j];
+            }
+        }
+        for (int r = 0; r < rows; r++) {
+            if constexpr (RESIDUAL) {
+                out[r * out_dim + i] += val[r];
+            }
+            else {
+                out[r * out_dim + i] = val[r];
+            }
+        }
+    }
+}
+
+// scale[b] = 1 / rms(in[b])
+inline void batch_rms_scale(float *scale, const float *in, int batch_size, int dim, float eps = 1e-5f)
+{
+    for (int b = 0; b < batch_size; b++) {
+        const float *in_row = in + b * dim;
+
+        float ss = 0.0f;
+        for (int i = 0; i < dim; i++) {
+            ss += in_row[i] * in_row[i];
+        }
+        scale[b] = 1.0f / sqrtf(ss / dim + eps);
+    }
+}
+
+// out = batch_matmul(batch_rms_norm(in, norm_weight), weight), with scale from
+// batch_rms_scale. packed is scratch of ROW_TILE * in_dim floats.
+inline void batch_rms_norm_matmul(float       *out,
+                                  const float *in,
+                                  const float *scale,
+                                  const float *norm_weight,
+                                  const float *weight,
+                                  float       *packed,
+                                  int          batch_size,
+                                  int          in_dim,
+                                  int          out_dim)
+{
+    for (int b0 = 0; b0 < batch_size; b0 += ROW_TILE) {
+        int rows = std::min(ROW_TILE, batch_size - b0);
+        for (int r = 0; r < rows; r++) {
+            const float *in_row = in + (b0 + r) * in_dim;
+            float       *tile   = packed + r * in_dim;
+            float        s      = scale[b0 + r];
+            for (int j = 0; j < in_dim; j++) {
+                tile[j] = in_row[j] * s * norm_weight[j];
+            }
+        }
+        matmul_tile<false>(out + b0 * out_dim, packed, weight, rows, in_dim, out_dim);
+    }
+}
+
+// out = batch_rms_norm(in, norm_weight), with scale from batch_rms_scale, for
+// the consumers that need the normalized rows themselves (LoRA shrink)
+inline void
+batch_rms_norm(float *out, const float *in, const float *scale, const float *norm_weight, int batch_size, int dim)
+{
+    for (int b = 0; b < batch_size; b++) {
+        const float *in_row  = in + static_cast<size_t>(b) * dim;
+        float       *out_row = out + static_cast<size_t>(b) * dim;
+        for (int j = 0; j < dim; j++) {
+            out_row[j] = in_row[j] * scale[b] * norm_weight[j];
+        }
+    }
+}
+
+// out += batch_matmul(in, weight)
+inline void
+batch_matmul_residual(float *out, const float *in, const float *weight, int batch_size, int in_dim, int out_dim)
+{
+    for (int b0 = 0; b0 < batch_size; b0 += ROW_TILE) {
+        int rows = std::min(ROW_TILE, batch_size - b0);
+        matmul_tile<true>(out + b0 * out_dim, in + b0 * in_dim, weight, rows, in_dim, out_dim);
+    }
+}
+
+// ============================================================================
+// Grouped LoRA (SGMV) - Low-rank updates for a batch that mixes adapters
+//
+// The base projection runs once for the whole batch; the rows are grouped
+// into segments that share an adapter, and each segment adds its own
+// scale * B (A x) with one shrink GEMM (rows x in_dim -> rows x rank) and one
+// expand GEMM (rows x rank -> rows x out_dim), ROW_TILE rows at a time, so an
+// adapter's factors are streamed once per tile instead of once per row.
+// Segments without an adapter (a == nullptr) are base-model rows.
+// ============================================================================
+
+struct LoraSegment
+{
+    int          start = 0; // First batch row
+    int          rows  = 0;
+    const float *a     = nullptr; // [rank, in_dim]
+    const float *b     = nullptr; // [out_dim, rank]
+    int          rank  = 0;
+    float        scale = 1.0f;
+};
+
+// out[row] += scale * B (A in[row]) for the rows of every segment. buf is
+// scratch of ROW_TILE * (largest rank) floats.
+inline void batch_lora(float             *out,
+                       const float       *in,
+                       const LoraSegment *segments,
+                       int                num_segments,
+                       float             *buf,
+                       int                in_dim,
+                       int                out_dim)
+{
+    for (int s = 0; s < num_segments; s++) {
+        const LoraSegment &seg = segments[s];
+        if (!seg.a) {
+            continue;
+        }
+        for (int b0 = seg.start; b0 < seg.start + seg.rows; b0 += ROW_TILE) {
+            int rows = std::min(ROW_TILE, seg.start + seg.rows - b0);
+            matmul_tile<false>(buf, in + static_cast<size_t>(b0) * in_dim, seg.a, rows, in_dim, seg.rank);
+            for (int i = 0; i < rows * seg.rank; i++) {
+                buf[i] *= seg.scale;
+            }
+            matmul_tile<true>(out + static_cast<size_t>(b0) * out_dim, buf, seg.b, rows, seg.rank, out_dim);
+        }
+    }
+}
+
 } // namespace BatchOps
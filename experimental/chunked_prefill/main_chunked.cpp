@@ -1,17 +1,24 @@
 #include <chrono>
+#include <cmath>
+#include <fstream>
+#include <iomanip>
 #include <iostream>
+#include <sstream>
 #include <string>
 #include <vector>
 
 #include "../../include/core/sampler.hpp"
 #include "../../include/core/tokenizer.hpp"
 #include "../../include/utils/argparser.hpp"
+#include "../../include/utils/json_parser.hpp"
 #include "../../include/utils/logger.hpp"
 #include "../../include/utils/path.hpp"
 #include "model_chunked.hpp"
 
 // Arguments configuration using ArgConfig
-#define ARGS_LIST model_path, temperature, topp, steps, chunk_size, prompt, benchmark
+#define ARGS_LIST                                                                                   \
+    model_path, temperature, topp, steps, chunk_size, prompt, benchmark, score_jsonl, output_jsonl, \
+    top_logprobs, lora_dir, adapter, max_lora_rank
 
 class ChunkedPrefillArgs : public ArgConfig<ChunkedPrefillArgs>
 {
@@ -21,22 +28,163 @@ public:
     Arg<float>       topp        = {{"-p", "--top-p"}, "Top-p (nucleus) sampling parameter", 0.9f};
     Arg<int>         steps       = {{"-n", "--steps"}, "Number of steps to generate", 256};
     Arg<int> chunk_size        = {"--chunk-size", "Chunk size for prefill batching (0=disable, use token-by-token)", 0};
-    Arg<std::string> prompt    = {{"-i", "--input"}, "Input text prompt", nullptr};
-    Arg<bool>        benchmark = {"--benchmark", "Show detailed metrics", false};
+    Arg<std::string> prompt        = {{"-i", "--input"}, "Input text prompt", ""};
+    Arg<bool>        benchmark     = {"--benchmark", "Show detailed metrics", false};
+    Arg<std::string> score_jsonl   = {"--score-jsonl", "Score the prompt/continuation lines of a JSONL file", ""};
+    Arg<std::string> output_jsonl  = {"--output-jsonl", "Write scores as JSONL (- = stdout)", ""};
+    Arg<int>         top_logprobs  = {"--top-logprobs", "Most likely alternatives reported per scored token", 0};
+    Arg<std::string> lora_dir      = {"--lora-dir", "Directory of LoRA adapters (PEFT format)", ""};
+    Arg<std::string> adapter       = {"--adapter", "LoRA adapter under --lora-dir to run with", ""};
+    Arg<int>         max_lora_rank = {"--max-lora-rank", "Largest LoRA adapter rank accepted", 64};
 
     decltype(std::tie(ARGS_LIST)) args_tuple = std::tie(ARGS_LIST);
 };
 
 #undef ARGS_LIST
 
+// Number of leading tokens two encodings share
+static int common_prefix(const std::vector<int> &a, const std::vector<int> &b)
+{
+    size_t n = 0;
+    while (n < a.size() && n < b.size() && a[n] == b[n]) {
+        n++;
+    }
+    return static_cast<int>(n);
+}
+
+// One scored sequence as a JSONL line:
+// {"id", "tokens", "logprobs", "top_logprobs"?, "continuation_start", "sum_logprob", "perplexity"},
+// where logprobs[i] scores tokens[i + 1] and the sum covers logprobs[continuation_start:]
+static void write_scores(std::ostream                  &out,
+                         int                            id,
+                         const std::vector<int>        &tokens,
+                         const std::vector<TokenScore> &scores,
+                         int                            first,
+                         bool                           with_top,
+                         const Tokenizer               &tokenizer)
+{
+    std::ostringstream line;
+    line << std::fixed << std::setprecision(6);
+    line << "{\"id\": " << id << ", \"tokens\": [";
+    for (size_t i = 0; i < tokens.size(); i++) {
+        line << (i ? ", " : "") << tokens[i];
+    }
+
+    double sum = 0.0;
+    line << "], \"logprobs\": [";
+    for (size_t i = 0; i < scores.size(); i++) {
+        line << (i ? ", " : "") << scores[i].logprob;
+        if (static_cast<int>(i) >= first) {
+            sum += scores[i].logprob;
+        }
+    }
+    line << "]";
+
+    if (with_top) {
+        line << ", \"top_logprobs\": [";
+        for (size_t i = 0; i < scores.size(); i++) {
+            line << (i ? ", " : "") << "[";
+            for (size_t j = 0; j < scores[i].top.size(); j++) {
+                const auto &alt = scores[i].top[j];
+                line << (j ? ", " : "") << "{\"token\": " << alt.token << ", \"text\": \""
+                     << json::escape(tokenizer.decode(alt.token)) << "\", \"logprob\": " << alt.logprob << "}";
+            }
+            line << "]";
+        }
+        line << "]";
+    }
+
+    int num_scored = static_cast<int>(scores.size()) - first;
+    line << ", \"continuation_start\": " << first << ", \"sum_logprob\": " << sum
+         << ", \"perplexity\": " << (num_scored > 0 ? std::exp(-sum / num_scored) : 0.0) << "}\n";
+    out << line.str();
+}
+
+// Scoring mode: each input line is {"prompt", "continuation"?}. Every token
+// after BOS is scored; the sum and perplexity cover the continuation, or the
+// whole text when there is none. Lines are numbered in input order.
+static int run_scoring(LlamaModelChunked &model, Tokenizer &tokenizer, const ChunkedPrefillArgs &args)
+{
+    std::ifstream in(args.score_jsonl.get());
+    if (!in.is_open()) {
+        LOG_ERROR("Failed to open JSONL file: ", args.score_jsonl.get());
+        return 1;
+    }
+    std::ofstream file;
+    if (args.output_jsonl.get() != "-") {
+        file.open(args.output_jsonl.get());
+        if (!file.is_open()) {
+            LOG_ERROR("Failed to open JSONL output: ", args.output_jsonl.get());
+            return 1;
+        }
+    }
+    std::ostream &out        = file.is_open() ? file : std::cout;
+    int           chunk_size = args.chunk_size.get() > 0 ? args.chunk_size.get() : model.config.max_seq_len;
+    int           top_k      = args.top_logprobs.get();
+
+    json::JsonParser parser;
+    std::string      line;
+    int              line_number = 0, id = 0, num_failed = 0;
+    long             num_tokens  = 0;
+    auto             start       = std::chrono::high_resolution_clock::now();
+    while (std::getline(in, line)) {
+        line_number++;
+        if (line.find_first_not_of(" \t\r") == std::string::npos) {
+            continue;
+        }
+        try {
+            json::JsonObject obj          = parser.parse(line);
+            std::string      prompt       = obj.get_string("prompt");
+            std::string      continuation = obj.get_string("continuation");
+
+            // The continuation starts where the encoding stops matching the prompt's
+            std::vector<int> tokens  = tokenizer.encode(prompt + continuation, true, false);
+            int              context = continuation.empty() ? 1 : common_prefix(tokenizer.encode(prompt), tokens);
+
+            auto scores = model.score(tokens, chunk_size, top_k);
+            write_scores(out, id, tokens, scores, context - 1, top_k > 0, tokenizer);
+            num_tokens += static_cast<long>(scores.size());
+        }
+        catch (const std::exception &e) {
+            LOG_WARNING("Skipping JSONL line ", line_number, ": ", e.what());
+            num_failed++;
+        }
+        id++;
+    }
+    out.flush();
+
+    auto   end        = std::chrono::high_resolution_clock::now();
+    double elapsed_ms = std::chrono::duration<double, std::milli>(end - start).count();
+    LOG_SUCCESS("Scored ", id - num_failed, " sequences (", num_tokens, " tokens) in ", elapsed_ms, " ms");
+    if (elapsed_ms > 0) {
+        LOG_INFO("Throughput: ", num_tokens * 1000.0 / elapsed_ms, " tokens/sec");
+    }
+    return num_failed > 0 ? 1 : 0;
+}
+
 int main(int argc, char **argv)
 {
     ChunkedPrefillArgs args;
     ArgParser          parser("nano-vllm: Chunked Prefill Implementation");
 
+    // Scores on stdout: only errors (which go to stderr) may be logged
+    for (int i = 1; i + 1 < argc; i++) {
+        if (std::string(argv[i]) == "--output-jsonl" && std::string(argv[i + 1]) == "-") {
+            Logger::set_level(LogLevel::Error);
+        }
+    }
+
     if (!args.parse(parser, argc, argv)) {
         return 1;
     }
+    if (args.score_jsonl.get().empty() == args.prompt.get().empty()) {
+        LOG_ERROR("Exactly one of --input and --score-jsonl must be provided");
+        return 1;
+    }
+    if (!args.score_jsonl.get().empty() && args.output_jsonl.get().empty()) {
+        LOG_ERROR("--score-jsonl requires --output-jsonl (use - for stdout)");
+        return 1;
+    }
 
     std::string input_path = args.model_path.get();
 
@@ -54,6 +202,19 @@ int main(int argc, char **argv)
     LlamaModelChunked model;
     try {
         model.load(model_path);
+        if (model.config.sliding_window > 0) {
+            LOG_WARNING("Chunked forward has no sliding-window support: attending over the full context instead of ",
+                        model.config.sliding_window,
+                        " tokens");
+            model.set_sliding_window(0);
+        }
+        if (!args.lora_dir.get().empty()) {
+            model.initialize_lora(args.lora_dir, 1, args.max_lora_rank);
+        }
+        model.use_adapter(args.adapter);
+        if (args.chunk_size.get() > 0) {
+            model.reserve_chunks(args.chunk_size.get());
+        }
         LOG_SUCCESS("Model loaded successfully");
     }
     catch (const std::exception &e) {
@@ -61,9 +222,18 @@ int main(int argc, char **argv)
         return 1;
     }
 
-    Tokenizer tokenizer(tokenizer_path, model.config.vocab_size);
+    if (tokenizer_path.empty() && model.vocab.empty()) {
+        LOG_ERROR("No tokenizer.bin found and the model embeds no supported vocabulary");
+        return 1;
+    }
+    Tokenizer tokenizer = tokenizer_path.empty() ? Tokenizer(model.vocab, model.vocab_scores)
+                                                 : Tokenizer(tokenizer_path, model.config.vocab_size);
     LOG_SUCCESS("Tokenizer loaded successfully");
 
+    if (!args.score_jsonl.get().empty()) {
+        return run_scoring(model, tokenizer, args);
+    }
+
     Sampler sampler(model.config.vocab_size, args.temperature, args.topp, std::time(nullptr));
 
     std::vector<int> tokens = tokenizer.encode(args.prompt, true, false);
@@ -105,6 +275,7 @@ int main(int argc, char **argv)
             LOG_INFO("Avg chunk time: ", metrics.avg_chunk_time_ms, " ms");
         }
         LOG_INFO("Total time: ", metrics.total_time_ms, " ms");
+        LOG_INFO("Peak activation memory: ", model.peak_activation_bytes() / 1024.0, " KB");
         if (metrics.total_tokens > 0) {
             LOG_INFO("Throughput: ", metrics.tokens_per_second(), " tokens/sec");
         }
@@ -4,40 +4,81 @@
 #include <chrono>
 #include <cmath>
 #include <cstring>
+#include <span>
+#include <stdexcept>
+#include <string>
 #include <vector>
 
 #include "../../include/core/model.hpp"
 #include "../../include/ops/activation.hpp"
+#include "../../include/ops/logprobs.hpp"
 #include "batch_ops.hpp"
 #include "chunking.hpp"
 
+// Chunk buffers, carved from an arena sized once for the largest chunk. Each
+// chunk re-carves them at its own size, and every layer reuses them.
 struct ChunkedRunState
 {
-    int max_chunk_size = 0;
-
-    std::vector<float> x_batch;
-    std::vector<float> xb_batch;
-    std::vector<float> xb2_batch;
-    std::vector<float> hb_batch;
-    std::vector<float> hb2_batch;
-    std::vector<float> q_batch;
-    std::vector<float> k_batch;
-    std::vector<float> v_batch;
-    std::vector<float> att_batch;
-
-    void resize(int chunk_size, int dim, int hidden_dim, int n_heads, int max_seq_len)
+    int   max_chunk_size = 0;
+    Arena arena;
+
+    std::span<float> x_batch;   // [chunk, dim]
+    std::span<float> xb2_batch; // [chunk, dim]
+    std::span<float> hb_batch;  // [chunk, hidden_dim]
+    std::span<float> hb2_batch; // [chunk, hidden_dim]
+    std::span<float> q_batch;   // [chunk, dim]
+    std::span<float> k_batch;   // [chunk, dim]
+    std::span<float> v_batch;   // [chunk, dim]
+    std::span<float> att;       // [n_heads, max_seq_len], reused for each token of the chunk
+    std::span<float> rms_scale; // [chunk]
+    std::span<float> packed;    // [ROW_TILE, dim], normalized input tile of the fused matmuls
+    std::span<float> logits;    // [ROW_TILE, vocab_size], one tile of positions being scored
+    std::span<float> lora;      // [ROW_TILE, max_lora_rank], A x of a tile of rows
+
+    static size_t footprint(int chunk_size, const Config &config)
+    {
+        size_t dim    = static_cast<size_t>(chunk_size) * config.dim;
+        size_t hidden = static_cast<size_t>(chunk_size) * config.hidden_dim;
+        size_t att    = static_cast<size_t>(config.n_heads) * config.max_seq_len;
+        size_t rows   = chunk_size;
+        size_t packed = static_cast<size_t>(BatchOps::ROW_TILE) * config.dim;
+        size_t logits = static_cast<size_t>(BatchOps::ROW_TILE) * config.vocab_size;
+        size_t lora   = static_cast<size_t>(BatchOps::ROW_TILE) * config.max_lora_rank;
+        return Arena::footprint({dim, dim, hidden, hidden, dim, dim, dim, att, rows, packed, logits, lora});
+    }
+
+    void reserve(int chunk_size, const Config &config)
     {
         max_chunk_size = chunk_size;
-        x_batch.resize(chunk_size * dim);
-        xb_batch.resize(chunk_size * dim);
-        xb2_batch.resize(chunk_size * dim);
-        hb_batch.resize(chunk_size * hidden_dim);
-        hb2_batch.resize(chunk_size * hidden_dim);
-        q_batch.resize(chunk_size * dim);
-        k_batch.resize(chunk_size * dim);
-        v_batch.resize(chunk_size * dim);
-        att_batch.resize(chunk_size * n_heads * max_seq_len);
+        arena.reserve(footprint(chunk_size, config));
     }
+
+    void carve(int chunk_size, const Config &config)
+    {
+        size_t dim    = static_cast<size_t>(chunk_size) * config.dim;
+        size_t hidden = static_cast<size_t>(chunk_size) * config.hidden_dim;
+        arena.release(0);
+        x_batch   = arena.alloc(dim);
+        xb2_batch = arena.alloc(dim);
+        hb_batch  = arena.alloc(hidden);
+        hb2_batch = arena.alloc(hidden);
+        q_batch   = arena.alloc(dim);
+        k_batch   = arena.alloc(dim);
+        v_batch   = arena.alloc(dim);
+        att       = arena.alloc(static_cast<size_t>(config.n_heads) * config.max_seq_len);
+        rms_scale = arena.alloc(chunk_size);
+        packed    = arena.alloc(static_cast<size_t>(BatchOps::ROW_TILE) * config.dim);
+        logits    = arena.alloc(static_cast<size_t>(BatchOps::ROW_TILE) * config.vocab_size);
+        lora      = arena.alloc(static_cast<size_t>(BatchOps::ROW_TILE) * config.max_lora_rank);
+    }
+};
+
+// Log-probability of one token given the tokens before it
+struct TokenScore
+{
+    int                            token;
+    float                          logprob;
+    std::vector<Ops::TokenLogprob> top; // Most likely tokens at this position
 };
 
 class LlamaModelChunked : public LlamaModel
@@ -45,36 +86,137 @@ class LlamaModelChunked : public LlamaModel
 public:
     ChunkedRunState chunk_state;
 
+    // Size the chunk arena for chunks of up to max_chunk_size tokens, so that
+    // prefill allocates nothing
+    void reserve_chunks(int max_chunk_size)
+    {
+        chunk_state.reserve(max_chunk_size, config);
+        LOG_INFO("Chunk arena: ", chunk_state.arena.capacity() / 1024.0, " KB for chunks of ", max_chunk_size);
+    }
+
+    // Activation memory the forward passes so far have used, in bytes
+    size_t peak_activation_bytes() const { return state.arena.peak() + chunk_state.arena.peak(); }
+
+    // Run a chunk through the model; state.logits are those of its last token
     void forward_chunk(const std::vector<int> &chunk_tokens, int start_pos)
     {
-        int chunk_size = static_cast<int>(chunk_tokens.size());
+        forward_layers(chunk_tokens, start_pos);
 
-        if (chunk_state.max_chunk_size < chunk_size) {
-            chunk_state.resize(chunk_size, config.dim, config.hidden_dim, config.n_heads, config.max_seq_len);
+        // Generation continues from the last position only
+        const float *x_last = chunk_state.x_batch.data() + (chunk_tokens.size() - 1) * config.dim;
+        Ops::rms_norm(state.x.data(), x_last, weights->rms_final_weight.data(), config.dim);
+        Ops::matmul(state.logits.data(), state.x.data(), weights->lm_head.data(), config.dim, config.vocab_size);
+    }
+
+    // Scoring: the log-probability of every token after the first given the
+    // ones before it, plus the top_k alternatives at each position. Whole
+    // chunks go through the batched forward and the fused head below; nothing
+    // is sampled, and at most ROW_TILE rows of logits exist at a time.
+    std::vector<TokenScore> score(const std::vector<int> &tokens, int chunk_size, int top_k = 0)
+    {
+        if (static_cast<int>(tokens.size()) > config.max_seq_len) {
+            throw std::runtime_error("Cannot score " + std::to_string(tokens.size())
+                                     + " tokens: max_seq_len is " + std::to_string(config.max_seq_len));
         }
 
-        float *x   = chunk_state.x_batch.data();
-        float *xb  = chunk_state.xb_batch.data();
-        float *xb2 = chunk_state.xb2_batch.data();
-        float *hb  = chunk_state.hb_batch.data();
-        float *hb2 = chunk_state.hb2_batch.data();
-        float *q   = chunk_state.q_batch.data();
-        float *k   = chunk_state.k_batch.data();
-        float *v   = chunk_state.v_batch.data();
+        std::vector<TokenScore> scores;
+        if (tokens.size() < 2) {
+            return scores;
+        }
+
+        // The last token is only ever a target
+        std::vector<int> inputs(tokens.begin(), tokens.end() - 1);
+        scores.reserve(inputs.size());
+        for (const auto &chunk : ChunkedPrefill::create_chunks(inputs, chunk_size)) {
+            forward_layers(chunk.tokens, chunk.start_pos);
+            score_rows(tokens.data() + chunk.start_pos + 1, static_cast<int>(chunk.tokens.size()), top_k, scores);
+        }
+        return scores;
+    }
+
+    ChunkedPrefill::PrefillMetrics prefill_chunked(const std::vector<int> &tokens, int chunk_size)
+    {
+        auto chunks = ChunkedPrefill::create_chunks(tokens, chunk_size);
+
+        auto                           start = std::chrono::high_resolution_clock::now();
+        std::vector<double>            chunk_times;
+        ChunkedPrefill::PrefillMetrics metrics;
+
+        for (const auto &chunk : chunks) {
+            auto chunk_start = std::chrono::high_resolution_clock::now();
+
+            forward_chunk(chunk.tokens, chunk.start_pos);
+
+            auto   chunk_end  = std::chrono::high_resolution_clock::now();
+            double chunk_time = std::chrono::duration<double, std::milli>(chunk_end - chunk_start).count();
+            chunk_times.push_back(chunk_time);
+        }
+
+        auto end = std::chrono::high_resolution_clock::now();
+
+        metrics.total_time_ms     = std::chrono::duration<double, std::milli>(end - start).count();
+        metrics.num_chunks        = static_cast<int>(chunks.size());
+        metrics.total_tokens      = static_cast<int>(tokens.size());
+        metrics.chunk_size        = chunk_size;
+        metrics.avg_chunk_time_ms = 0.0;
+        for (double t : chunk_times)
+            metrics.avg_chunk_time_ms += t;
+        metrics.avg_chunk_time_ms /= std::max(1, metrics.num_chunks);
+
+        return metrics;
+    }
+
+private:
+    // Transformer layers over a chunk; leaves the final hidden states in x_batch
+    void forward_layers(const std::vector<int> &chunk_tokens, int start_pos)
+    {
+        int chunk_size = static_cast<int>(chunk_tokens.size());
+
+        // Chunks index the full contiguous cache, not the sliding-window ring
+        if (config.sliding_window > 0) {
+            throw std::runtime_error("Chunked forward does not support sliding-window attention");
+        }
+        // Also re-sized if LoRA was enabled after the arena was reserved
+        if (chunk_state.arena.capacity() < ChunkedRunState::footprint(chunk_size, config)) {
+            reserve_chunks(std::max(chunk_size, chunk_state.max_chunk_size));
+        }
+        chunk_state.carve(chunk_size, config);
+
+        float *x      = chunk_state.x_batch.data();
+        float *xb2    = chunk_state.xb2_batch.data();
+        float *hb     = chunk_state.hb_batch.data();
+        float *hb2    = chunk_state.hb2_batch.data();
+        float *q      = chunk_state.q_batch.data();
+        float *k      = chunk_state.k_batch.data();
+        float *v      = chunk_state.v_batch.data();
+        float *scale  = chunk_state.rms_scale.data();
+        float *packed = chunk_state.packed.data();
 
         for (int b = 0; b < chunk_size; b++) {
-            const float *embedding = weights.token_embedding_table.data() + chunk_tokens[b] * config.dim;
+            const float *embedding = weights->token_embedding_table.data() + chunk_tokens[b] * config.dim;
             std::memcpy(x + b * config.dim, embedding, config.dim * sizeof(float));
         }
 
         for (int layer = 0; layer < config.n_layers; layer++) {
-            auto &l = weights.layers[layer];
-
-            BatchOps::batch_rms_norm(xb, x, l.rms_att_weight.data(), chunk_size, config.dim);
-
-            BatchOps::batch_matmul(q, xb, l.wq.data(), chunk_size, config.dim, config.n_heads * config.head_dim);
-            BatchOps::batch_matmul(k, xb, l.wk.data(), chunk_size, config.dim, config.n_kv_heads * config.head_dim);
-            BatchOps::batch_matmul(v, xb, l.wv.data(), chunk_size, config.dim, config.n_kv_heads * config.head_dim);
+            auto                     &l    = weights->layers[layer];
+            const LoraAdapter::Layer *lora = adapter ? &adapter->layers[layer] : nullptr;
+
+            int q_dim  = config.n_heads * config.head_dim;
+            int kv_dim = config.n_kv_heads * config.head_dim;
+
+            // RMSNorm folded into the QKV matmuls
+            const float *norm = l.rms_att_weight.data();
+            BatchOps::batch_rms_scale(scale, x, chunk_size, config.dim);
+            BatchOps::batch_rms_norm_matmul(q, x, scale, norm, l.wq.data(), packed, chunk_size, config.dim, q_dim);
+            BatchOps::batch_rms_norm_matmul(k, x, scale, norm, l.wk.data(), packed, chunk_size, config.dim, kv_dim);
+            BatchOps::batch_rms_norm_matmul(v, x, scale, norm, l.wv.data(), packed, chunk_size, config.dim, kv_dim);
+            if (lora) {
+                // xb2 is free until attention writes it
+                BatchOps::batch_rms_norm(xb2, x, scale, norm, chunk_size, config.dim);
+                apply_lora_rows(q, xb2, lora->wq, chunk_size, config.dim, q_dim);
+                apply_lora_rows(k, xb2, lora->wk, chunk_size, config.dim, kv_dim);
+                apply_lora_rows(v, xb2, lora->wv, chunk_size, config.dim, kv_dim);
+            }
 
             BatchOps::batch_rope(
                 q, k, start_pos, chunk_size, config.head_dim, config.n_heads, config.n_kv_heads, config.rope_theta);
@@ -95,17 +237,22 @@ public:
 
             chunked_attention(layer, chunk_size, start_pos, xb2);
 
-            BatchOps::batch_matmul(xb, xb2, l.wo.data(), chunk_size, config.n_heads * config.head_dim, config.dim);
-
-            for (int b = 0; b < chunk_size; b++) {
-                for (int i = 0; i < config.dim; i++) {
-                    x[b * config.dim + i] += xb[b * config.dim + i];
-                }
+            BatchOps::batch_matmul_residual(x, xb2, l.wo.data(), chunk_size, q_dim, config.dim);
+            if (lora) {
+                apply_lora_rows(x, xb2, lora->wo, chunk_size, q_dim, config.dim);
             }
 
-            BatchOps::batch_rms_norm(xb, x, l.rms_ffn_weight.data(), chunk_size, config.dim);
-            BatchOps::batch_matmul(hb, xb, l.w_gate.data(), chunk_size, config.dim, config.hidden_dim);
-            BatchOps::batch_matmul(hb2, xb, l.w_up.data(), chunk_size, config.dim, config.hidden_dim);
+            norm = l.rms_ffn_weight.data();
+            BatchOps::batch_rms_scale(scale, x, chunk_size, config.dim);
+            BatchOps::batch_rms_norm_matmul(
+                hb, x, scale, norm, l.w_gate.data(), packed, chunk_size, config.dim, config.hidden_dim);
+            BatchOps::batch_rms_norm_matmul(
+                hb2, x, scale, norm, l.w_up.data(), packed, chunk_size, config.dim, config.hidden_dim);
+            if (lora) {
+                BatchOps::batch_rms_norm(xb2, x, scale, norm, chunk_size, config.dim);
+                apply_lora_rows(hb, xb2, lora->w_gate, chunk_size, config.dim, config.hidden_dim);
+                apply_lora_rows(hb2, xb2, lora->w_up, chunk_size, config.dim, config.hidden_dim);
+            }
 
             for (int b = 0; b < chunk_size; b++) {
                 Ops::swiglu(hb + b * config.hidden_dim,
@@ -114,59 +261,64 @@ public:
                             config.hidden_dim);
             }
 
-            BatchOps::batch_matmul(xb, hb, l.w_down.data(), chunk_size, config.hidden_dim, config.dim);
-
-            for (int b = 0; b < chunk_size; b++) {
-                for (int i = 0; i < config.dim; i++) {
-                    x[b * config.dim + i] += xb[b * config.dim + i];
-                }
+            BatchOps::batch_matmul_residual(x, hb, l.w_down.data(), chunk_size, config.hidden_dim, config.dim);
+            if (lora) {
+                apply_lora_rows(x, hb, lora->w_down, chunk_size, config.hidden_dim, config.dim);
             }
         }
+    }
 
-        for (int b = 0; b < chunk_size; b++) {
-            float *x_b = x + b * config.dim;
-            std::memcpy(state.x.data(), x_b, config.dim * sizeof(float));
-            Ops::rms_norm(state.x.data(), state.x.data(), weights.rms_final_weight.data(), config.dim);
-            Ops::matmul(state.logits.data(), state.x.data(), weights.lm_head.data(), config.dim, config.vocab_size);
+    // out += the current adapter's low-rank update of a projection, for every
+    // row of the chunk: one segment of the grouped LoRA kernel
+    void apply_lora_rows(float *out, const float *in, const LoraAdapter::Factors &f, int rows, int in_dim, int out_dim)
+    {
+        if (f.empty()) {
+            return;
         }
+        BatchOps::LoraSegment segment{0, rows, f.a.data(), f.b.data(), adapter->rank, adapter->scale};
+        BatchOps::batch_lora(out, in, &segment, 1, chunk_state.lora.data(), in_dim, out_dim);
     }
 
-    ChunkedPrefill::PrefillMetrics prefill_chunked(const std::vector<int> &tokens, int chunk_size)
+    // Final RMSNorm and lm_head over the first rows of x_batch (folded into one
+    // tiled matmul), then each row's log-softmax at its target token
+    void score_rows(const int *targets, int rows, int top_k, std::vector<TokenScore> &scores)
     {
-        auto chunks = ChunkedPrefill::create_chunks(tokens, chunk_size);
-
-        auto                           start = std::chrono::high_resolution_clock::now();
-        std::vector<double>            chunk_times;
-        ChunkedPrefill::PrefillMetrics metrics;
-
-        for (const auto &chunk : chunks) {
-            auto chunk_start = std::chrono::high_resolution_clock::now();
-
-            forward_chunk(chunk.tokens, chunk.start_pos);
-
-            auto   chunk_end  = std::chrono::high_resolution_clock::now();
-            double chunk_time = std::chrono::duration<double, std::milli>(chunk_end - chunk_start).count();
-            chunk_times.push_back(chunk_time);
+        const float *x      = chunk_state.x_batch.data();
+        float       *scale  = chunk_state.rms_scale.data();
+        float       *packed = chunk_state.packed.data();
+        float       *logits = chunk_state.logits.data();
+        int          vocab  = config.vocab_size;
+
+        BatchOps::batch_rms_scale(scale, x, rows, config.dim);
+        for (int b0 = 0; b0 < rows; b0 += BatchOps::ROW_TILE) {
+            int tile = std::min(BatchOps::ROW_TILE, rows - b0);
+            BatchOps::batch_rms_norm_matmul(logits,
+                                            x + static_cast<size_t>(b0) * config.dim,
+                                            scale + b0,
+                                            weights->rms_final_weight.data(),
+                                            weights->lm_head.data(),
+                                            packed,
+                                            tile,
+                                            config.dim,
+                                            vocab);
+            for (int r = 0; r < tile; r++) {
+                const float *row    = logits + static_cast<size_t>(r) * vocab;
+                int          target = targets[b0 + r];
+                float        lse    = Ops::log_sum_exp(row, vocab);
+
+                TokenScore token_score{target, row[target] - lse, {}};
+                if (top_k > 0) {
+                    token_score.top.resize(top_k);
+                    token_score.top.resize(Ops::top_k_logprobs(token_score.top.data(), row, vocab, top_k, lse));
+                }
+                scores.push_back(std::move(token_score));
+            }
         }
-
-        auto end = std::chrono::high_resolution_clock::now();
-
-        metrics.total_time_ms     = std::chrono::duration<double, std::milli>(end - start).count();
-        metrics.num_chunks        = static_cast<int>(chunks.size());
-        metrics.total_tokens      = static_cast<int>(tokens.size());
-        metrics.chunk_size        = chunk_size;
-        metrics.avg_chunk_time_ms = 0.0;
-        for (double t : chunk_times)
-            metrics.avg_chunk_time_ms += t;
-        metrics.avg_chunk_time_ms /= std::max(1, metrics.num_chunks);
-
-        return metrics;
     }
 
-private:
     void chunked_attention(int layer, int chunk_size, int start_pos, float *out)
     {
-        float *att = chunk_state.att_batch.data();
+        float *att = chunk_state.att.data();
         float *q   = chunk_state.q_batch.data();
 
         int   kv_mul       = config.n_heads / config.n_kv_heads;
@@ -180,7 +332,7 @@ private:
 
             for (int h = 0; h < config.n_heads; h++) {
                 float *q_head   = q + b * config.n_heads * config.head_dim + h * config.head_dim;
-                float *att_head = att + b * config.n_heads * config.max_seq_len + h * config.max_seq_len;
+                float *att_head = att + h * config.max_seq_len;
                 int    kv_h     = h / kv_mul;
 
                 for (int t = 0; t <= curr_pos; t++) {
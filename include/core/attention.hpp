@@ -1,10 +1,24 @@
 #pragma once
 
+#include <algorithm>
 #include <cmath>
 #include <cstring>
 
 // ============================================================================
 // Attention Implementations
+//
+// Both kernels are templates over their inner dimensions: 0 (the default)
+// takes head_dim / block_size from the arguments, a non-zero value fixes it
+// at compile time so the head_dim loops get known trip counts and the block
+// index math becomes shifts. KernelTable picks the instance per model.
+//
+// window > 0 selects sliding-window attention: only the last window positions
+// are attended to, so the cost per token is bounded by the window rather
+// than the sequence length. The contiguous cache is then a ring of window
+// rows (position t lives in row t % window); the paged kernel never reads
+// block table entries before the window, so those blocks may be recycled.
+// The paged kernel also takes sinks: the first sinks positions stay attended
+// next to the window (StreamingLLM attention sinks).
 // ============================================================================
 
 namespace Attention {
@@ -13,6 +27,7 @@ namespace Attention {
 // Standard Attention (Original contiguous memory approach)
 // ============================================================================
 
+template <int HEAD_DIM = 0>
 inline void standard_attention(float       *out,
                                const float *q,
                                const float *key_cache,   // Already offset to layer
@@ -22,11 +37,20 @@ inline void standard_attention(float       *out,
                                int          head_dim,
                                int          n_heads,
                                int          n_kv_heads,
-                               int          max_seq_len)
+                               int          max_seq_len,
+                               int          window = 0)
 {
+    if constexpr (HEAD_DIM > 0) {
+        head_dim = HEAD_DIM;
+    }
     int   kv_mul = n_heads / n_kv_heads;
     float scale  = 1.0f / sqrtf(head_dim);
 
+    // Attended positions [start, pos]; att_head[i] scores position start + i
+    int start = window > 0 ? std::max(0, pos - window + 1) : 0;
+    int span  = pos - start + 1;
+    auto row  = [&](int i) { return window > 0 ? (start + i) % window : start + i; };
+
     // Reset output
     std::memset(out, 0, n_heads * head_dim * sizeof(float));
 
@@ -36,40 +60,40 @@ inline void standard_attention(float       *out,
         int          kv_h     = h / kv_mul;
 
         // Score: Q * K^T
-        for (int t = 0; t <= pos; t++) {
-            const float *k_head = key_cache + t * n_kv_heads * head_dim + kv_h * head_dim;
+        for (int i = 0; i < span; i++) {
+            const float *k_head = key_cache + row(i) * n_kv_heads * head_dim + kv_h * head_dim;
             float        score  = 0.0f;
-            for (int i = 0; i < head_dim; i++) {
-                score += q_head[i] * k_head[i];
+            for (int d = 0; d < head_dim; d++) {
+                score += q_head[d] * k_head[d];
             }
             score *= scale;
-            att_head[t] = score;
+            att_head[i] = score;
         }
 
         // Softmax
         float max_val = -1e10;
-        for (int t = 0; t <= pos; t++) {
-            if (att_head[t] > max_val)
-                max_val = att_head[t];
+        for (int i = 0; i < span; i++) {
+            if (att_head[i] > max_val)
+                max_val = att_head[i];
         }
 
         float sum = 0.0f;
-        for (int t = 0; t <= pos; t++) {
-            att_head[t] = expf(att_head[t] - max_val);
-            sum += att_head[t];
+        for (int i = 0; i < span; i++) {
+            att_head[i] = expf(att_head[i] - max_val);
+            sum += att_head[i];
         }
 
-        for (int t = 0; t <= pos; t++) {
-            att_head[t] /= sum;
+        for (int i = 0; i < span; i++) {
+            att_head[i] /= sum;
         }
 
         // Weighted sum: softmax(Q*K^T) * V
         float *out_head = out + h * head_dim;
-        for (int t = 0; t <= pos; t++) {
-            const float *v_head = value_cache + t * n_kv_heads * head_dim + kv_h * head_dim;
-            float        prob   = att_head[t];
-            for (int i = 0; i < head_dim; i++) {
-                out_head[i] += prob * v_head[i];
+        for (int i = 0; i < span; i++) {
+            const float *v_head = value_cache + row(i) * n_kv_heads * head_dim + kv_h * head_dim;
+            float        prob   = att_head[i];
+            for (int d = 0; d < head_dim; d++) {
+                out_head[d] += prob * v_head[d];
             }
         }
     }
@@ -79,6 +103,7 @@ inline void standard_attention(float       *out,
 // Paged Attention (Block-based memory approach)
 // ============================================================================
 
+template <int HEAD_DIM = 0, int BLOCK_SIZE = 0>
 inline void paged_attention(float       *out,
                             const float *q,
                             const float *key_cache,
@@ -89,23 +114,37 @@ inline void paged_attention(float       *out,
                             int          block_size,
                             int          head_dim,
                             int          n_heads,
-                            int          n_kv_heads)
+                            int          n_kv_heads,
+                            int          window = 0,
+                            int          sinks  = 0)
 {
+    if constexpr (HEAD_DIM > 0) {
+        head_dim = HEAD_DIM;
+    }
+    if constexpr (BLOCK_SIZE > 0) {
+        block_size = BLOCK_SIZE;
+    }
     int   kv_mul = n_heads / n_kv_heads;
     float scale  = 1.0f / sqrtf(head_dim);
 
+    // Attended positions [0, n_sinks) + [start, num_tokens); att_head[i] scores
+    // the i-th of them
+    int start   = window > 0 ? std::max(0, num_tokens - window) : 0;
+    int n_sinks = std::min(sinks, start);
+    int span    = n_sinks + num_tokens - start;
+    auto token  = [&](int i) { return i < n_sinks ? i : start + i - n_sinks; };
+
     // Reset output
     std::memset(out, 0, n_heads * head_dim * sizeof(float));
 
-    int num_blocks = (num_tokens + block_size - 1) / block_size;
-
     for (int h = 0; h < n_heads; h++) {
         const float *q_head   = q + h * head_dim;
-        float       *att_head = att_scores + h * num_tokens;
+        float       *att_head = att_scores + h * span;
         int          kv_h     = h / kv_mul;
 
         // Score: Q * K^T (using block table)
-        for (int t = 0; t < num_tokens; t++) {
+        for (int j = 0; j < span; j++) {
+            int t              = token(j);
             int logical_block  = t / block_size;
             int block_offset   = t % block_size;
             int physical_block = block_table[logical_block];
@@ -119,29 +158,30 @@ inline void paged_attention(float       *out,
                 score += q_head[i] * k_head[i];
             }
             score *= scale;
-            att_head[t] = score;
+            att_head[j] = score;
         }
 
         // Softmax
         float max_val = -1e10;
-        for (int t = 0; t < num_tokens; t++) {
-            if (att_head[t] > max_val)
-                max_val = att_head[t];
+        for (int i = 0; i < span; i++) {
+            if (att_head[i] > max_val)
+                max_val = att_head[i];
         }
 
         float sum = 0.0f;
-        for (int t = 0; t < num_tokens; t++) {
-            att_head[t] = expf(att_head[t] - max_val);
-            sum += att_head[t];
+        for (int i = 0; i < span; i++) {
+            att_head[i] = expf(att_head[i] - max_val);
+            sum += att_head[i];
         }
 
-        for (int t = 0; t < num_tokens; t++) {
-            att_head[t] /= sum;
+        for (int i = 0; i < span; i++) {
+            att_head[i] /= sum;
         }
 
         // Weighted sum: softmax(Q*K^T) * V (using block table)
         float *out_head = out + h * head_dim;
-        for (int t = 0; t < num_tokens; t++) {
+        for (int j = 0; j < span; j++) {
+            int t              = token(j);
             int logical_block  = t / block_size;
             int block_offset   = t % block_size;
             int physical_block = block_table[logical_block];
@@ -150,7 +190,7 @@ inline void paged_attention(float       *out,
             const float *v_head = value_cache + physical_block * block_size * n_kv_heads * head_dim
                                 + block_offset * n_kv_heads * head_dim + kv_h * head_dim;
 
-            float prob = att_head[t];
+            float prob = att_head[j];
             for (int i = 0; i < head_dim; i++) {
                 out_head[i] += prob * v_head[i];
             }
@@ -0,0 +1,157 @@
+#pragma once
+
+#include <string>
+
+#include "core/attention.hpp"
+#include "ops/normalization.hpp"
+#include "ops/positional.hpp"
+
+// ============================================================================
+// Kernel Table - Shape-specialized kernel instances, chosen once per model
+//
+// RMSNorm, RoPE and both attention kernels are templates over their inner
+// dimensions (0 = runtime argument). The instances below fix those
+// dimensions for common model shapes, so the compiler sees constant trip
+// counts: it fully unrolls and vectorizes the head_dim loops without
+// remainder handling and turns the block_size divisions into shifts.
+//
+// select() runs once when the model is loaded (and again when the paged KV
+// layout is set up) and falls back to the generic instance for any other
+// shape; the forward pass then makes one indirect call per kernel. To add a
+// shape, extend the matching switch below.
+// ============================================================================
+
+class KernelTable
+{
+public:
+    using RmsNormFn           = void (*)(float *, const float *, const float *, int, float);
+    using RopeFn              = void (*)(float *, float *, int, int, int, int, float);
+    using StandardAttentionFn = void (*)(float *, const float *, const float *, const float *, float *, int, int,
+                                         int, int, int, int);
+    using PagedAttentionFn    = void (*)(float *, const float *, const float *, const float *, const int *, float *,
+                                      int, int, int, int, int, int, int);
+
+    // Instances for dim, head_dim and block_size, generic where none matches
+    static KernelTable select(int dim, int head_dim, int block_size)
+    {
+        KernelTable t;
+        switch (dim) {
+        case 2048:
+            t.rms_norm_ = &Ops::rms_norm<2048>;
+            t.dim_      = dim;
+            break;
+        case 4096:
+            t.rms_norm_ = &Ops::rms_norm<4096>;
+            t.dim_      = dim;
+            break;
+        default:
+            break;
+        }
+        switch (head_dim) {
+        case 64:
+            t.set_head_dim<64>(block_size);
+            break;
+        case 128:
+            t.set_head_dim<128>(block_size);
+            break;
+        default:
+            break;
+        }
+        return t;
+    }
+
+    // Same signatures as the Ops:: / Attention:: kernels
+
+    void rms_norm(float *out, const float *in, const float *weight, int size, float eps = 1e-5f) const
+    {
+        rms_norm_(out, in, weight, size, eps);
+    }
+
+    void apply_rope(float *q, float *k, int pos, int head_dim, int n_heads, int n_kv_heads, float theta) const
+    {
+        apply_rope_(q, k, pos, head_dim, n_heads, n_kv_heads, theta);
+    }
+
+    void standard_attention(float       *out,
+                            const float *q,
+                            const float *key_cache,
+                            const float *value_cache,
+                            float       *att_scores,
+                            int          pos,
+                            int          head_dim,
+                            int          n_heads,
+                            int          n_kv_heads,
+                            int          max_seq_len,
+                            int          window = 0) const
+    {
+        standard_attention_(
+            out, q, key_cache, value_cache, att_scores, pos, head_dim, n_heads, n_kv_heads, max_seq_len, window);
+    }
+
+    void paged_attention(float       *out,
+                         const float *q,
+                         const float *key_cache,
+                         const float *value_cache,
+                         const int   *block_table,
+                         float       *att_scores,
+                         int          num_tokens,
+                         int          block_size,
+                         int          head_dim,
+                         int          n_heads,
+                         int          n_kv_heads,
+                         int          window = 0,
+                         int          sinks  = 0) const
+    {
+        paged_attention_(out,
+                         q,
+                         key_cache,
+                         value_cache,
+                         block_table,
+                         att_scores,
+                         num_tokens,
+                         block_size,
+                         head_dim,
+                         n_heads,
+                         n_kv_heads,
+                         window,
+                         sinks);
+    }
+
+    // Picked instances, e.g. "dim=4096 head_dim=128 block_size=16" (* = generic)
+    std::string description() const
+    {
+        auto fixed = [](int value) { return value > 0 ? std::to_string(value) : std::string("*"); };
+        return "dim=" + fixed(dim_) + " head_dim=" + fixed(head_dim_) + " block_size=" + fixed(block_size_);
+    }
+
+private:
+    RmsNormFn           rms_norm_           = &Ops::rms_norm<>;
+    RopeFn              apply_rope_         = &Ops::apply_rope<>;
+    StandardAttentionFn standard_attention_ = &Attention::standard_attention<>;
+    PagedAttentionFn    paged_attention_    = &Attention::paged_attention<>;
+
+    // Compile-time dimension of the picked instances (0 = generic)
+    int dim_        = 0;
+    int head_dim_   = 0;
+    int block_size_ = 0;
+
+    template <int HEAD_DIM> void set_head_dim(int block_size)
+    {
+        apply_rope_         = &Ops::apply_rope<HEAD_DIM>;
+        standard_attention_ = &Attention::standard_attention<HEAD_DIM>;
+        head_dim_           = HEAD_DIM;
+        switch (block_size) {
+        case 16:
+            paged_attention_ = &Attention::paged_attention<HEAD_DIM, 16>;
+            block_size_      = block_size;
+            break;
+        case 32:
+            paged_attention_ = &Attention::paged_attention<HEAD_DIM, 32>;
+            block_size_      = block_size;
+            break;
+        default:
+            paged_attention_ = &Attention::paged_attention<HEAD_DIM, 0>;
+            break;
+        }
+    }
+};
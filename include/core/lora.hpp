@@ -0,0 +1,219 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <filesystem>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "core/model_loader.hpp"
+#include "core/weights.hpp"
+#include "utils/json_parser.hpp"
+#include "utils/logger.hpp"
+
+// ============================================================================
+// LoRA Adapters - Low-rank fine-tunes served on top of one base model
+//
+// An adapter replaces a projection W by W + scale * B A, with A [rank, in]
+// and B [out, rank] for rank much smaller than in and out. forward() runs the
+// shared base matmul and then adds the adapter's low-rank product, so an
+// adapter costs rank * (in + out) floats per projection rather than a copy
+// of the weights, and any number of variants share one TransformerWeights.
+//
+// Adapters are PEFT checkpoints: a directory holding adapter_config.json
+// ("r", "lora_alpha", "use_rslora") and adapter_model.safetensors. LoraCache
+// loads them by name from a root directory on first use and keeps the most
+// recently used ones in memory.
+// ============================================================================
+
+struct LoraAdapter
+{
+    // One projection's factors; empty if the adapter does not target it
+    struct Factors
+    {
+        Tensor a; // [rank, in_dim]
+        Tensor b; // [out_dim, rank]
+
+        bool empty() const { return a.empty(); }
+    };
+
+    struct Layer
+    {
+        Factors wq, wk, wv, wo, w_gate, w_up, w_down;
+    };
+
+    std::string        name;
+    int                rank  = 0;
+    float              scale = 1.0f; // lora_alpha / rank (/ sqrt(rank) with rsLoRA)
+    std::vector<Layer> layers;
+
+    size_t bytes() const
+    {
+        size_t floats = 0;
+        for (const auto &l : layers) {
+            for (const Factors *f : {&l.wq, &l.wk, &l.wv, &l.wo, &l.w_gate, &l.w_up, &l.w_down}) {
+                floats += f->a.size() + f->b.size();
+            }
+        }
+        return floats * sizeof(float);
+    }
+
+    // Load the PEFT adapter in dir for a base model of shape config
+    static std::shared_ptr<const LoraAdapter>
+    load(const std::string &dir, const std::string &name, const Config &config)
+    {
+        namespace fs = std::filesystem;
+        fs::path config_path  = fs::path(dir) / "adapter_config.json";
+        fs::path weights_path = fs::path(dir) / "adapter_model.safetensors";
+        if (!fs::exists(config_path) || !fs::exists(weights_path)) {
+            throw std::runtime_error("LoRA adapter not found: " + name);
+        }
+
+        json::JsonObject cfg     = json::JsonParser().parse_file(config_path.string());
+        auto             adapter = std::make_shared<LoraAdapter>();
+        adapter->name            = name;
+        adapter->rank            = cfg.get_int("r", 8);
+        float alpha              = cfg.get_float("lora_alpha", static_cast<float>(adapter->rank));
+        bool  rslora             = cfg.get_bool("use_rslora", false);
+        if (adapter->rank <= 0) {
+            throw std::runtime_error("LoRA adapter " + name + ": invalid rank");
+        }
+        adapter->scale = alpha / (rslora ? std::sqrt(static_cast<float>(adapter->rank)) : adapter->rank);
+
+        // Key tensors by their name from "layers." on, whatever prefix PEFT wrote
+        std::unordered_map<std::string, TensorInfo> tensors;
+        for (auto &[tensor_name, info] : read_safetensors(weights_path.string())) {
+            size_t at = tensor_name.find("layers.");
+            if (at != std::string::npos) {
+                tensors[tensor_name.substr(at)] = std::move(info);
+            }
+        }
+
+        int q_dim  = config.n_heads * config.head_dim;
+        int kv_dim = config.n_kv_heads * config.head_dim;
+        adapter->layers.resize(config.n_layers);
+        size_t found = 0;
+        for (int i = 0; i < config.n_layers; i++) {
+            auto &l      = adapter->layers[i];
+            auto  factor = [&](const char *module, int in_dim, int out_dim, int rope_heads = 0) {
+                std::string prefix = "layers." + std::to_string(i) + "." + module;
+                auto        a      = tensors.find(prefix + ".lora_A.weight");
+                auto        b      = tensors.find(prefix + ".lora_B.weight");
+                if (a == tensors.end() || b == tensors.end()) {
+                    return Factors{};
+                }
+                found++;
+                size_t a_size = static_cast<size_t>(adapter->rank) * in_dim;
+                size_t b_size = static_cast<size_t>(out_dim) * adapter->rank;
+                return Factors{take(a->second, prefix, a_size, config),
+                               take(b->second, prefix, b_size, config, rope_heads, adapter->rank)};
+            };
+            l.wq     = factor("self_attn.q_proj", config.dim, q_dim, config.n_heads);
+            l.wk     = factor("self_attn.k_proj", config.dim, kv_dim, config.n_kv_heads);
+            l.wv     = factor("self_attn.v_proj", config.dim, kv_dim);
+            l.wo     = factor("self_attn.o_proj", q_dim, config.dim);
+            l.w_gate = factor("mlp.gate_proj", config.dim, config.hidden_dim);
+            l.w_up   = factor("mlp.up_proj", config.dim, config.hidden_dim);
+            l.w_down = factor("mlp.down_proj", config.hidden_dim, config.dim);
+        }
+        if (found == 0) {
+            throw std::runtime_error("LoRA adapter " + name + " targets none of the model's projections");
+        }
+        return adapter;
+    }
+
+private:
+    // A factor as f32, checked against the base shape. PEFT adapters are
+    // trained against Hugging Face checkpoints, so the rows of q_proj / k_proj
+    // B (rope_heads > 0) hold RoPE halves and are interleaved like the base
+    // wq / wk.
+    static Tensor take(const TensorInfo  &t,
+                       const std::string &prefix,
+                       size_t             expected,
+                       const Config      &config,
+                       int                rope_heads = 0,
+                       int                rank       = 0)
+    {
+        if (t.numel() != expected) {
+            throw std::runtime_error("LoRA tensor " + prefix + " has " + std::to_string(t.numel())
+                                     + " elements, expected " + std::to_string(expected));
+        }
+        std::vector<float> values(expected);
+        dequantize(t, values.data());
+        if (rope_heads > 0) {
+            values = interleave_rope_halves(values, rope_heads, config.head_dim, rank);
+        }
+        return Tensor(std::move(values));
+    }
+};
+
+// ============================================================================
+// LoRA Cache - Adapters loaded on demand, least recently used evicted
+//
+// Shared by every replica of a model (get() is thread-safe). An evicted
+// adapter stays alive while a sequence that started with it still holds it.
+// ============================================================================
+
+class LoraCache
+{
+public:
+    // Adapters are read from dir/<name>; at most capacity stay loaded, and
+    // none may have a rank above max_rank
+    LoraCache(std::string dir, const Config &config, int capacity, int max_rank)
+        : dir_(std::move(dir))
+        , config_(config)
+        , capacity_(std::max(1, capacity))
+        , max_rank_(max_rank)
+    {
+        if (!std::filesystem::is_directory(dir_)) {
+            throw std::runtime_error("LoRA directory not found: " + dir_);
+        }
+    }
+
+    std::shared_ptr<const LoraAdapter> get(const std::string &name)
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto                        it = index_.find(name);
+        if (it != index_.end()) {
+            lru_.splice(lru_.begin(), lru_, it->second);
+            return *it->second;
+        }
+
+        // Names come from requests: keep them inside dir_
+        if (name.empty() || name.find('/') != std::string::npos || name[0] == '.') {
+            throw std::runtime_error("Invalid LoRA adapter name: " + name);
+        }
+        auto adapter = LoraAdapter::load((std::filesystem::path(dir_) / name).string(), name, config_);
+        if (adapter->rank > max_rank_) {
+            throw std::runtime_error("LoRA adapter " + name + " has rank " + std::to_string(adapter->rank)
+                                     + ", above --max-lora-rank " + std::to_string(max_rank_));
+        }
+        LOG_INFO("LoRA adapter loaded: ", name, " (rank ", adapter->rank, ", ", adapter->bytes() / 1024.0, " KB)");
+
+        lru_.push_front(adapter);
+        index_[name] = lru_.begin();
+        if (static_cast<int>(lru_.size()) > capacity_) {
+            LOG_INFO("LoRA adapter evicted: ", lru_.back()->name);
+            index_.erase(lru_.back()->name);
+            lru_.pop_back();
+        }
+        return adapter;
+    }
+
+private:
+    using Entry = std::shared_ptr<const LoraAdapter>;
+
+    std::string dir_;
+    Config      config_;
+    int         capacity_;
+    int         max_rank_;
+
+    std::mutex                                                  mutex_;
+    std::list<Entry>                                            lru_; // Most recently used first
+    std::unordered_map<std::string, std::list<Entry>::iterator> index_;
+};
@@ -1,93 +1,56 @@
 #pragma once
 
+#include <algorithm>
 #include <cmath>
 #include <cstring>
-#include <fstream>
+#include <memory>
+#include <span>
 #include <stdexcept>
 #include <string>
 #include <vector>
 
 #include "core/attention.hpp"
+#include "core/kernel_table.hpp"
+#include "core/lora.hpp"
+#include "core/model_loader.hpp"
+#include "core/weights.hpp"
 #include "ops/activation.hpp"
 #include "ops/linear.hpp"
 #include "ops/normalization.hpp"
 #include "ops/positional.hpp"
 #include "scheduler/block_manager.hpp"
+#include "scheduler/engine_metrics.hpp"
+#include "scheduler/kv_disk_store.hpp"
+#include "utils/arena.hpp"
 #include "utils/logger.hpp"
 #include "utils/metrics.hpp"
+#include "utils/profiler.hpp"
 
 // ============================================================================
-// Llama Model Configuration & Data Structures
+// Llama Model Runtime State
 // ============================================================================
 
-struct Config
-{
-    int dim;         // Transformer dimension
-    int hidden_dim;  // FFN hidden dimension
-    int n_layers;    // Number of layers
-    int n_heads;     // Number of query heads
-    int n_kv_heads;  // Number of key/value heads (can be < n_heads for GQA)
-    int vocab_size;  // Vocabulary size
-    int max_seq_len; // Maximum sequence length
-
-    // PagedAttention configuration
-    bool use_paged_attention = false; // Enable/disable PagedAttention
-    int  block_size          = 16;    // Block size for PagedAttention (in tokens)
-    int  num_blocks          = 256;   // Total number of physical blocks
-
-    // Derived/Constants
-    int   head_dim;
-    float rope_theta = 10000.0f;
-};
-
-// Holds the weights of the model.
-// We use std::vector for automatic memory management.
-struct TransformerWeights
-{
-    // Embedding
-    std::vector<float> token_embedding_table; // [vocab_size, dim]
-
-    // Layers
-    struct Layer
-    {
-        std::vector<float> rms_att_weight; // [dim]
-        std::vector<float> wq;             // [dim, n_heads * head_dim]
-        std::vector<float> wk;             // [dim, n_kv_heads * head_dim]
-        std::vector<float> wv;             // [dim, n_kv_heads * head_dim]
-        std::vector<float> wo;             // [n_heads * head_dim, dim]
-        std::vector<float> rms_ffn_weight; // [dim]
-        std::vector<float> w_gate;         // [dim, hidden_dim]
-        std::vector<float> w_up;           // [dim, hidden_dim]
-        std::vector<float> w_down;         // [hidden_dim, dim]
-    };
-
-    std::vector<Layer> layers;
-
-    // Final RMSNorm
-    std::vector<float> rms_final_weight; // [dim]
-
-    // Output Head (optional if shared)
-    std::vector<float> lm_head; // [vocab_size, dim]
-    bool               weights_shared = false;
-};
-
 // Runtime state buffers
 struct RunState
 {
+    Arena arena; // Backs the activation buffers below, allocated once per config
+
     // Current hidden states
-    std::vector<float> x;      // [dim]
-    std::vector<float> xb;     // [dim]
-    std::vector<float> xb2;    // [dim]
-    std::vector<float> hb;     // [hidden_dim]
-    std::vector<float> hb2;    // [hidden_dim]
-    std::vector<float> q;      // [dim]
-    std::vector<float> k;      // [dim]
-    std::vector<float> v;      // [dim]
-    std::vector<float> att;    // [n_heads, seq_len]
-    std::vector<float> logits; // [vocab_size]
+    std::span<float> x;      // [dim]
+    std::span<float> xb;     // [dim]
+    std::span<float> xb2;    // [dim]
+    std::span<float> hb;     // [hidden_dim]
+    std::span<float> hb2;    // [hidden_dim]
+    std::span<float> q;      // [dim]
+    std::span<float> k;      // [dim]
+    std::span<float> v;      // [dim]
+    std::span<float> att;    // [n_heads, seq_len]
+    std::span<float> logits; // [vocab_size]
+    std::span<float> lora;   // [max_lora_rank], A x of a LoRA update
 
     // Standard KV Cache (contiguous memory)
-    // Layout: [n_layers, max_seq_len, n_kv_heads, head_dim]
+    // Layout: [n_layers, kv_rows, n_kv_heads, head_dim], kv_rows = max_seq_len,
+    // or sliding_window rows used as a ring
     std::vector<float> key_cache;
     std::vector<float> value_cache;
 
@@ -104,29 +67,40 @@ struct RunState
 class LlamaModel
 {
 public:
-    Config             config;
-    TransformerWeights weights;
-    RunState           state;
+    Config                                    config;
+    std::shared_ptr<const TransformerWeights> weights;
+    RunState                                  state;
+    KernelTable                               kernels; // Shape-specialized instances for config
 
     // PagedAttention components
-    BlockManager                 *block_manager = nullptr;
+    std::unique_ptr<BlockManager> block_manager;
     std::vector<std::vector<int>> block_tables; // [n_layers][logical_blocks]
 
+    // Persistent prefix KV tier (optional)
+    std::unique_ptr<KVDiskStore> kv_store;
+    std::string                  kv_store_dir;
+
     // Metrics for memory comparison
     KVCacheMetrics metrics;
 
+    // Sliding window: logical blocks after the pinned sink blocks (at the front
+    // without sinks) already returned to block_manager (their entries are -1)
+    int recycled_blocks = 0;
+
+    // LoRA adapters: loaded on demand into a cache shared with every replica;
+    // adapter is the one the current sequence runs with (null = base model)
+    std::shared_ptr<LoraCache>         lora_cache;
+    std::shared_ptr<const LoraAdapter> adapter;
+
+    // Tokenizer vocabulary embedded in the model file (GGUF, packed); empty if none
+    std::vector<std::string> vocab;
+    std::vector<float>       vocab_scores;
+
     void load(const std::string &path)
     {
         LOG_INFO("Loading model: ", path);
-        std::ifstream file(path, std::ios::binary);
-        if (!file.is_open()) {
-            throw std::runtime_error("Failed to open model file");
-        }
-
-        // Read config
-        file.read(reinterpret_cast<char *>(&config), 7 * sizeof(int));
-        // Calculate derived
-        config.head_dim = config.dim / config.n_heads;
+        std::unique_ptr<ModelLoader> loader = ModelLoader::open(path);
+        config                              = loader->config();
 
         LOG_INFO("Config: dim=",
                  config.dim,
@@ -134,116 +108,231 @@ public:
                  config.n_layers,
                  " heads=",
                  config.n_heads,
+                 " kv_heads=",
+                 config.n_kv_heads,
                  " vocab=",
-                 config.vocab_size);
+                 config.vocab_size,
+                 " eos=",
+                 config.eos_token_id);
+
+        // Map or convert the weights
+        auto loaded = std::make_shared<TransformerWeights>();
+        loader->load_weights(*loaded);
+        weights      = std::move(loaded);
+        vocab        = loader->vocab();
+        vocab_scores = loader->vocab_scores();
+
+        kernels = KernelTable::select(config.dim, config.head_dim, config.block_size);
+        LOG_INFO("Kernels: ", kernels.description());
+        if (config.sliding_window > 0) {
+            LOG_INFO("Sliding-window attention: ", config.sliding_window, " tokens");
+        }
 
-        // Allocate weights
-        resize_weights();
+        // Allocate run state
+        resize_run_state();
+    }
 
-        // Read weights
-        read_weights(file);
+    // Attend to the last window tokens only (0 = full context). The contiguous
+    // cache shrinks to a ring of window rows, and with PagedAttention blocks
+    // that fall entirely out of the window go back to block_manager as the
+    // sequence advances, so KV memory per sequence is O(window) and positions
+    // may run past max_seq_len. Call before initialize_paged_attention().
+    void set_sliding_window(int window)
+    {
+        if (window < 0 || window > config.max_seq_len) {
+            throw std::runtime_error("Sliding window must be between 0 and max_seq_len ("
+                                     + std::to_string(config.max_seq_len) + ")");
+        }
+        config.sliding_window = window;
+        resize_run_state();
+        LOG_INFO("Sliding-window attention: ", window > 0 ? std::to_string(window) + " tokens" : "off");
+    }
 
-        // Allocate run state
+    // Keep the first sinks tokens attended next to the sliding window
+    // (StreamingLLM). Their blocks are never recycled, and RoPE positions
+    // count within the cache instead of the sequence: the keys left in the
+    // window are rotated back by block_size whenever a block is recycled, so
+    // sinks and window stay at the distances the model was trained on however
+    // long generation runs. Needs PagedAttention; call after set_sliding_window().
+    void set_attention_sinks(int sinks)
+    {
+        if (sinks < 0) {
+            throw std::runtime_error("Attention sinks must not be negative");
+        }
+        if (sinks > 0 && (config.sliding_window == 0 || !config.use_paged_attention)) {
+            throw std::runtime_error("Attention sinks need a sliding window and PagedAttention");
+        }
+        if (sinks + config.sliding_window > config.max_seq_len) {
+            throw std::runtime_error("Attention sinks plus the sliding window must not exceed max_seq_len ("
+                                     + std::to_string(config.max_seq_len) + ")");
+        }
+        config.attention_sinks = sinks;
+        LOG_INFO("Attention sinks: ", sinks > 0 ? std::to_string(sinks) + " tokens" : "off");
+    }
+
+    // Serve LoRA adapters from dir/<name> (PEFT format), keeping at most
+    // max_loras loaded; adapters may have rank up to max_rank
+    void initialize_lora(const std::string &dir, int max_loras, int max_rank)
+    {
+        if (max_rank <= 0) {
+            throw std::runtime_error("--max-lora-rank must be positive");
+        }
+        lora_cache           = std::make_shared<LoraCache>(dir, config, max_loras, max_rank);
+        config.max_lora_rank = max_rank;
         resize_run_state();
+        LOG_INFO("LoRA adapters: ", dir, " (up to ", max_loras, " loaded, rank <= ", max_rank, ")");
+    }
+
+    // Run the following forward() calls with the named adapter (empty = base
+    // model). Throws if it cannot be loaded.
+    void use_adapter(const std::string &name)
+    {
+        if (name.empty()) {
+            adapter.reset();
+            return;
+        }
+        if (!lora_cache) {
+            throw std::runtime_error("Request names LoRA adapter " + name + " but no --lora-dir is set");
+        }
+        adapter = lora_cache->get(name);
+    }
+
+    // True once a sequence at pos can grow no further
+    bool context_full(int pos) const { return config.sliding_window == 0 && pos >= config.max_seq_len; }
+
+    // Another engine over the same read-only weights. It gets its own RunState,
+    // KV pool of num_blocks blocks and block tables, so replicas can run
+    // concurrently on separate threads without copying the weights.
+    std::unique_ptr<LlamaModel> replicate(int num_blocks) const
+    {
+        auto replica               = std::make_unique<LlamaModel>();
+        replica->config            = config;
+        replica->config.num_blocks = num_blocks;
+        replica->weights           = weights;
+        replica->kernels           = kernels;
+        replica->lora_cache        = lora_cache;
+        replica->resize_run_state();
+        replica->initialize_paged_attention();
+        if (kv_store) {
+            replica->initialize_kv_store(kv_store_dir);
+        }
+        return replica;
     }
 
     void forward(int token, int pos)
     {
+        PROFILE_SCOPE("forward");
+
         // 1. Embedding
-        const float *content_row = weights.token_embedding_table.data() + token * config.dim;
-        std::memcpy(state.x.data(), content_row, config.dim * sizeof(float));
+        {
+            PROFILE_SCOPE("embedding");
+            const float *content_row = weights->token_embedding_table.data() + token * config.dim;
+            std::memcpy(state.x.data(), content_row, config.dim * sizeof(float));
+        }
+
+        // Blocks that left the window can serve this position
+        if (config.use_paged_attention && config.sliding_window > 0) {
+            recycle_kv_blocks(pos);
+        }
+        int rope_pos = cache_position(pos);
 
         // 2. Layers
         for (int i = 0; i < config.n_layers; i++) {
-            auto &l = weights.layers[i];
+            const auto               &l    = weights->layers[i];
+            const LoraAdapter::Layer *lora = adapter ? &adapter->layers[i] : nullptr;
 
             // RMSNorm
-            Ops::rms_norm(state.xb.data(), state.x.data(), l.rms_att_weight.data(), config.dim);
+            {
+                PROFILE_SCOPE("rms_norm");
+                kernels.rms_norm(state.xb.data(), state.x.data(), l.rms_att_weight.data(), config.dim);
+            }
 
             // QKV Matmul
-            Ops::matmul(state.q.data(), state.xb.data(), l.wq.data(), config.dim, config.n_heads * config.head_dim);
-            Ops::matmul(state.k.data(), state.xb.data(), l.wk.data(), config.dim, config.n_kv_heads * config.head_dim);
-            Ops::matmul(state.v.data(), state.xb.data(), l.wv.data(), config.dim, config.n_kv_heads * config.head_dim);
+            {
+                PROFILE_SCOPE("qkv_matmul");
+                int q_dim  = config.n_heads * config.head_dim;
+                int kv_dim = config.n_kv_heads * config.head_dim;
+                Ops::matmul(state.q.data(), state.xb.data(), l.wq.data(), config.dim, q_dim);
+                Ops::matmul(state.k.data(), state.xb.data(), l.wk.data(), config.dim, kv_dim);
+                Ops::matmul(state.v.data(), state.xb.data(), l.wv.data(), config.dim, kv_dim);
+                if (lora) {
+                    apply_lora(state.q.data(), state.xb.data(), lora->wq, config.dim, q_dim);
+                    apply_lora(state.k.data(), state.xb.data(), lora->wk, config.dim, kv_dim);
+                    apply_lora(state.v.data(), state.xb.data(), lora->wv, config.dim, kv_dim);
+                }
+            }
 
             // RoPE
-            Ops::apply_rope(state.q.data(),
-                            state.k.data(),
-                            pos,
-                            config.head_dim,
-                            config.n_heads,
-                            config.n_kv_heads,
-                            config.rope_theta);
+            {
+                PROFILE_SCOPE("rope");
+                kernels.apply_rope(state.q.data(),
+                                   state.k.data(),
+                                   rope_pos,
+                                   config.head_dim,
+                                   config.n_heads,
+                                   config.n_kv_heads,
+                                   config.rope_theta);
+            }
 
             // Save to KV Cache
-            if (config.use_paged_attention) {
-                // PagedAttention: Block-based KV cache
-                // Allocate new block if needed
-                if (pos % config.block_size == 0) {
-                    int new_block = block_manager->allocate_block();
-                    if (new_block == -1) {
-                        throw std::runtime_error("Out of memory: no free blocks");
-                    }
-                    block_tables[i].push_back(new_block);
+            {
+                PROFILE_SCOPE("kv_write");
+                if (config.use_paged_attention && pos % config.block_size == 0) {
+                    // PagedAttention: allocate a new block when entering one
+                    allocate_kv_block(i);
                 }
-
-                // Get current block
-                int logical_block  = pos / config.block_size;
-                int block_offset   = pos % config.block_size;
-                int physical_block = block_tables[i][logical_block];
-
-                // Calculate cache pointers
-                // Layout: [n_layers, num_blocks, block_size, n_kv_heads, head_dim]
-                size_t layer_cache_offset =
-                    i * config.num_blocks * config.block_size * config.n_kv_heads * config.head_dim;
-                size_t block_cache_offset = physical_block * config.block_size * config.n_kv_heads * config.head_dim;
-                size_t pos_cache_offset   = block_offset * config.n_kv_heads * config.head_dim;
-
-                float *k_cache_ptr =
-                    state.paged_key_cache.data() + layer_cache_offset + block_cache_offset + pos_cache_offset;
-                float *v_cache_ptr =
-                    state.paged_value_cache.data() + layer_cache_offset + block_cache_offset + pos_cache_offset;
-
-                std::memcpy(k_cache_ptr, state.k.data(), config.n_kv_heads * config.head_dim * sizeof(float));
-                std::memcpy(v_cache_ptr, state.v.data(), config.n_kv_heads * config.head_dim * sizeof(float));
-            }
-            else {
-                // Standard: Contiguous KV cache
-                int    layer_offset = i * config.max_seq_len * config.n_kv_heads * config.head_dim;
-                int    pos_offset   = pos * config.n_kv_heads * config.head_dim;
-                float *k_cache_ptr  = state.key_cache.data() + layer_offset + pos_offset;
-                float *v_cache_ptr  = state.value_cache.data() + layer_offset + pos_offset;
-
-                std::memcpy(k_cache_ptr, state.k.data(), config.n_kv_heads * config.head_dim * sizeof(float));
-                std::memcpy(v_cache_ptr, state.v.data(), config.n_kv_heads * config.head_dim * sizeof(float));
+                std::memcpy(key_slot(i, pos), state.k.data(), config.n_kv_heads * config.head_dim * sizeof(float));
+                std::memcpy(value_slot(i, pos), state.v.data(), config.n_kv_heads * config.head_dim * sizeof(float));
             }
 
             // Multi-head Attention
-            attention(i, pos, state.xb2.data()); // writes to xb2
-
-            // Output Projection
-            Ops::matmul(state.xb.data(), state.xb2.data(), l.wo.data(), config.n_heads * config.head_dim, config.dim);
+            {
+                PROFILE_SCOPE("attention");
+                attention(i, pos, state.xb2.data()); // writes to xb2
+            }
 
-            // Residual
-            for (int j = 0; j < config.dim; j++)
-                state.x[j] += state.xb[j];
+            // Output Projection + Residual
+            {
+                PROFILE_SCOPE("attn_output");
+                int q_dim = config.n_heads * config.head_dim;
+                Ops::matmul_residual(state.x.data(), state.xb2.data(), l.wo.data(), q_dim, config.dim);
+                if (lora) {
+                    apply_lora(state.x.data(), state.xb2.data(), lora->wo, q_dim, config.dim);
+                }
+            }
 
             // FFN
-            Ops::rms_norm(state.xb.data(), state.x.data(), l.rms_ffn_weight.data(), config.dim);
-            Ops::matmul(state.hb.data(), state.xb.data(), l.w_gate.data(), config.dim, config.hidden_dim);
-            Ops::matmul(state.hb2.data(), state.xb.data(), l.w_up.data(), config.dim, config.hidden_dim);
-            Ops::swiglu(state.hb.data(), state.hb.data(), state.hb2.data(), config.hidden_dim);
-            Ops::matmul(state.xb.data(), state.hb.data(), l.w_down.data(), config.hidden_dim, config.dim);
-
-            // Residual
-            for (int j = 0; j < config.dim; j++)
-                state.x[j] += state.xb[j];
+            {
+                PROFILE_SCOPE("rms_norm");
+                kernels.rms_norm(state.xb.data(), state.x.data(), l.rms_ffn_weight.data(), config.dim);
+            }
+            {
+                PROFILE_SCOPE("ffn");
+                Ops::matmul(state.hb.data(), state.xb.data(), l.w_gate.data(), config.dim, config.hidden_dim);
+                Ops::matmul(state.hb2.data(), state.xb.data(), l.w_up.data(), config.dim, config.hidden_dim);
+                if (lora) {
+                    apply_lora(state.hb.data(), state.xb.data(), lora->w_gate, config.dim, config.hidden_dim);
+                    apply_lora(state.hb2.data(), state.xb.data(), lora->w_up, config.dim, config.hidden_dim);
+                }
+                Ops::swiglu(state.hb.data(), state.hb.data(), state.hb2.data(), config.hidden_dim);
+                Ops::matmul_residual(state.x.data(), state.hb.data(), l.w_down.data(), config.hidden_dim, config.dim);
+                if (lora) {
+                    apply_lora(state.x.data(), state.hb.data(), lora->w_down, config.hidden_dim, config.dim);
+                }
+            }
         }
 
         // Final RMSNorm
-        Ops::rms_norm(state.x.data(), state.x.data(), weights.rms_final_weight.data(), config.dim);
+        {
+            PROFILE_SCOPE("rms_norm");
+            kernels.rms_norm(state.x.data(), state.x.data(), weights->rms_final_weight.data(), config.dim);
+        }
 
         // Classifier
-        Ops::matmul(state.logits.data(), state.x.data(), weights.lm_head.data(), config.dim, config.vocab_size);
+        {
+            PROFILE_SCOPE("classifier");
+            Ops::matmul(state.logits.data(), state.x.data(), weights->lm_head.data(), config.dim, config.vocab_size);
+        }
     }
 
     void initialize_paged_attention()
@@ -252,11 +341,15 @@ public:
             return;
         }
 
-        // Initialize BlockManager
-        block_manager = new BlockManager(config.num_blocks, config.block_size);
+        // block_size may have changed since load
+        kernels = KernelTable::select(config.dim, config.head_dim, config.block_size);
+
+        // Initialize BlockManager (re-initialization starts from an empty pool)
+        block_manager = std::make_unique<BlockManager>(config.num_blocks, config.block_size);
 
         // Initialize block tables for each layer
-        block_tables.resize(config.n_layers);
+        block_tables.assign(config.n_layers, {});
+        recycled_blocks = 0;
 
         // Allocate paged KV cache
         // Layout: [n_layers, num_blocks, block_size, n_kv_heads, head_dim]
@@ -266,6 +359,7 @@ public:
 
         state.paged_key_cache.resize(paged_cache_size);
         state.paged_value_cache.resize(paged_cache_size);
+        publish_kv_blocks(0, config.num_blocks);
 
         LOG_SUCCESS("PagedAttention initialized: ",
                     config.num_blocks,
@@ -276,6 +370,177 @@ public:
                     " total capacity");
     }
 
+    // Return the current sequence's KV blocks to block_manager so the next
+    // sequence can start from position 0 without re-creating the pool
+    void release_kv_blocks()
+    {
+        if (!config.use_paged_attention || !block_manager) {
+            return;
+        }
+        for (auto &table : block_tables) {
+            for (int block : table) {
+                if (block >= 0) {
+                    block_manager->free_block(block);
+                }
+            }
+            table.clear();
+        }
+        recycled_blocks = 0;
+        publish_kv_blocks(0, config.num_blocks);
+    }
+
+    // Attach a persistent KV block store rooted at dir
+    void initialize_kv_store(const std::string &dir)
+    {
+        if (config.sliding_window > 0) {
+            throw std::runtime_error("The KV disk store needs the full context and cannot use a sliding window");
+        }
+        kv_store_dir = dir;
+        kv_store = std::make_unique<KVDiskStore>(
+            dir, fingerprint(), config.n_layers, config.block_size, config.n_kv_heads * config.head_dim);
+    }
+
+    // Identifies the model (shape + weights) that produced a KV block.
+    // Hashes the config and a sample of every tensor: small tensors whole,
+    // large ones as FINGERPRINT_SAMPLES runs spread evenly over the data, so
+    // a fine-tune that leaves the norms alone still gets its own store
+    // without reading gigabytes at startup.
+    uint64_t fingerprint() const
+    {
+        constexpr size_t FINGERPRINT_SAMPLES = 256;
+        constexpr size_t SAMPLE_FLOATS       = 16; // One cache line
+
+        uint64_t h = KVStore::FNV_OFFSET;
+        for (int field : {config.dim,
+                          config.hidden_dim,
+                          config.n_layers,
+                          config.n_heads,
+                          config.n_kv_heads,
+                          config.vocab_size,
+                          config.max_seq_len}) {
+            h = KVStore::hash_bytes(&field, sizeof(field), h);
+        }
+        h = KVStore::hash_bytes(&config.rope_theta, sizeof(float), h);
+        weights->for_each_tensor([&](TransformerWeights::Role, int, const Tensor &t) {
+            size_t size = t.size();
+            h           = KVStore::hash_bytes(&size, sizeof(size), h);
+            if (size <= FINGERPRINT_SAMPLES * SAMPLE_FLOATS) {
+                h = KVStore::hash_bytes(t.data(), size * sizeof(float), h);
+                return;
+            }
+            size_t stride = (size - SAMPLE_FLOATS) / (FINGERPRINT_SAMPLES - 1);
+            for (size_t i = 0; i < FINGERPRINT_SAMPLES; i++) {
+                h = KVStore::hash_bytes(t.data() + i * stride, SAMPLE_FLOATS * sizeof(float), h);
+            }
+        });
+        return h;
+    }
+
+    // Load KV for the longest stored block-aligned prefix of tokens[0, max_tokens)
+    // into a fresh cache. Returns the number of positions restored; the caller
+    // resumes forward() from that position.
+    int restore_prefix(const std::vector<int> &tokens, int max_tokens)
+    {
+        if (!kv_store || adapter) {
+            return 0;
+        }
+
+        int      kv_dim   = config.n_kv_heads * config.head_dim;
+        uint64_t hash     = KVStore::FNV_OFFSET;
+        int      restored = 0;
+
+        for (int start = 0; start + config.block_size <= max_tokens; start += config.block_size) {
+            hash                = KVStore::hash_block(hash, tokens.data() + start, config.block_size);
+            MappedKVBlock block = kv_store->map(hash, tokens.data() + start);
+            if (!block) {
+                break;
+            }
+
+            for (int i = 0; i < config.n_layers; i++) {
+                if (config.use_paged_attention) {
+                    allocate_kv_block(i);
+                }
+                for (int t = 0; t < config.block_size; t++) {
+                    std::memcpy(key_slot(i, start + t), block.key(i) + t * kv_dim, kv_dim * sizeof(float));
+                    std::memcpy(value_slot(i, start + t), block.value(i) + t * kv_dim, kv_dim * sizeof(float));
+                }
+            }
+            restored += config.block_size;
+        }
+
+        auto &engine_metrics = EngineMetrics::instance();
+        engine_metrics.prefix_cache_queries.inc(max_tokens / config.block_size);
+        engine_metrics.prefix_cache_hits.inc(restored / config.block_size);
+
+        if (restored > 0) {
+            LOG_INFO("Restored ", restored, " prompt tokens from KV disk store");
+        }
+        return restored;
+    }
+
+    // Write every full block of tokens[0, num_tokens) that is not yet stored
+    void persist_prefix(const std::vector<int> &tokens, int num_tokens)
+    {
+        if (!kv_store || adapter) {
+            return;
+        }
+
+        uint64_t           hash = KVStore::FNV_OFFSET;
+        std::vector<float> payload;
+
+        for (int start = 0; start + config.block_size <= num_tokens; start += config.block_size) {
+            hash = KVStore::hash_block(hash, tokens.data() + start, config.block_size);
+            if (kv_store->contains(hash)) {
+                continue;
+            }
+
+            payload.resize(kv_store->block_floats());
+            read_kv_block(start, config.block_size, payload.data());
+            kv_store->put(hash, tokens.data() + start, payload);
+        }
+    }
+
+    // Floats in one KV block: [n_layers][key, value][block_size][kv_dim],
+    // the layout shared by the KV disk store and the KV transfer channel
+    size_t kv_block_floats() const
+    {
+        return static_cast<size_t>(config.n_layers) * 2 * config.block_size * config.n_kv_heads * config.head_dim;
+    }
+
+    // Copy positions [start, start + count) of the cache, count <= block_size,
+    // into one block at dst (rows past count are left untouched)
+    void read_kv_block(int start, int count, float *dst)
+    {
+        int kv_dim = config.n_kv_heads * config.head_dim;
+        for (int i = 0; i < config.n_layers; i++) {
+            float *keys   = dst + static_cast<size_t>(2 * i) * config.block_size * kv_dim;
+            float *values = keys + static_cast<size_t>(config.block_size) * kv_dim;
+            for (int t = 0; t < count; t++) {
+                std::memcpy(keys + t * kv_dim, key_slot(i, start + t), kv_dim * sizeof(float));
+                std::memcpy(values + t * kv_dim, value_slot(i, start + t), kv_dim * sizeof(float));
+            }
+        }
+    }
+
+    // Inverse of read_kv_block. start must be block-aligned and the cache
+    // filled up to it; with PagedAttention a physical block is allocated per
+    // layer from block_manager.
+    void write_kv_block(int start, int count, const float *src)
+    {
+        int kv_dim = config.n_kv_heads * config.head_dim;
+        for (int i = 0; i < config.n_layers; i++) {
+            if (config.use_paged_attention) {
+                allocate_kv_block(i);
+            }
+            const float *keys   = src + static_cast<size_t>(2 * i) * config.block_size * kv_dim;
+            const float *values = keys + static_cast<size_t>(config.block_size) * kv_dim;
+            for (int t = 0; t < count; t++) {
+                std::memcpy(key_slot(i, start + t), keys + t * kv_dim, kv_dim * sizeof(float));
+                std::memcpy(value_slot(i, start + t), values + t * kv_dim, kv_dim * sizeof(float));
+            }
+        }
+    }
+
     // Print KV cache memory comparison metrics
     void print_metrics(int final_position)
     {
@@ -284,7 +549,7 @@ public:
         }
 
         // Get number of blocks used (from first layer's block table)
-        int blocks_used = block_tables.empty() ? 0 : static_cast<int>(block_tables[0].size());
+        int blocks_used = block_tables.empty() ? 0 : static_cast<int>(block_tables[0].size()) - recycled_blocks;
 
         metrics.set_sequence_length(final_position);
         metrics.set_blocks_used(blocks_used);
@@ -293,92 +558,38 @@ public:
     }
 
 private:
-    void resize_weights()
-    {
-        weights.token_embedding_table.resize(config.vocab_size * config.dim);
-        weights.layers.resize(config.n_layers);
-        for (auto &l : weights.layers) {
-            l.rms_att_weight.resize(config.dim);
-            l.wq.resize(config.dim * config.n_heads * config.head_dim);
-            l.wk.resize(config.dim * config.n_kv_heads * config.head_dim);
-            l.wv.resize(config.dim * config.n_kv_heads * config.head_dim);
-            l.wo.resize(config.n_heads * config.head_dim * config.dim);
-            l.rms_ffn_weight.resize(config.dim);
-            l.w_gate.resize(config.dim * config.hidden_dim);
-            l.w_up.resize(config.dim * config.hidden_dim);
-            l.w_down.resize(config.hidden_dim * config.dim);
-        }
-        weights.rms_final_weight.resize(config.dim);
-        weights.lm_head.resize(config.vocab_size * config.dim);
-    }
+    // This engine's part of the pool-wide KV block gauges
+    GaugeShare kv_blocks_used_share_{EngineMetrics::instance().kv_blocks_used};
+    GaugeShare kv_blocks_total_share_{EngineMetrics::instance().kv_blocks_total};
 
-    // Reads data assuming flat float structure
-    void read_weights(std::ifstream &file)
+    void publish_kv_blocks(int used, int total)
     {
-        auto read_tensor = [&](std::vector<float> &vec) {
-            file.read(reinterpret_cast<char *>(vec.data()), vec.size() * sizeof(float));
-        };
-
-        read_tensor(weights.token_embedding_table);
-
-        // llama2.c file format stores weights grouped by parameter type, not by layer.
-        // We must iterate over layers for each parameter type.
-
-        for (int i = 0; i < config.n_layers; i++)
-            read_tensor(weights.layers[i].rms_att_weight);
-        for (int i = 0; i < config.n_layers; i++)
-            read_tensor(weights.layers[i].wq);
-        for (int i = 0; i < config.n_layers; i++)
-            read_tensor(weights.layers[i].wk);
-        for (int i = 0; i < config.n_layers; i++)
-            read_tensor(weights.layers[i].wv);
-        for (int i = 0; i < config.n_layers; i++)
-            read_tensor(weights.layers[i].wo);
-        for (int i = 0; i < config.n_layers; i++)
-            read_tensor(weights.layers[i].rms_ffn_weight);
-
-        for (int i = 0; i < config.n_layers; i++)
-            read_tensor(weights.layers[i].w_gate);
-        for (int i = 0; i < config.n_layers; i++)
-            read_tensor(weights.layers[i].w_down);
-        for (int i = 0; i < config.n_layers; i++)
-            read_tensor(weights.layers[i].w_up);
-
-        read_tensor(weights.rms_final_weight);
-
-        // Handling shared weights vs non-shared
-        long current = file.tellg();
-        file.seekg(0, std::ios::end);
-        long end       = file.tellg();
-        long remaining = end - current;
-        file.seekg(current, std::ios::beg);
-
-        if (remaining >= weights.lm_head.size() * sizeof(float)) {
-            read_tensor(weights.lm_head);
-        }
-        else {
-            // Shared weights
-            weights.weights_shared = true;
-            weights.lm_head        = weights.token_embedding_table;
-            LOG_INFO("Weights shared: lm_head <- token_embedding");
-        }
+        EngineMetrics::instance().set_kv_blocks(kv_blocks_used_share_, kv_blocks_total_share_, used, total);
     }
 
     void resize_run_state()
     {
-        state.x.resize(config.dim);
-        state.xb.resize(config.dim);
-        state.xb2.resize(config.dim);
-        state.hb.resize(config.hidden_dim);
-        state.hb2.resize(config.hidden_dim);
-        state.q.resize(config.dim);
-        state.k.resize(config.dim);
-        state.v.resize(config.dim);
-        state.att.resize(config.n_heads * config.max_seq_len);
-        state.logits.resize(config.vocab_size);
+        size_t dim     = config.dim;
+        size_t hidden  = config.hidden_dim;
+        size_t att     = static_cast<size_t>(config.n_heads) * config.max_seq_len;
+        size_t n_vocab = config.vocab_size;
+        size_t rank    = config.max_lora_rank;
+        state.arena.reserve(Arena::footprint({dim, dim, dim, hidden, hidden, dim, dim, dim, att, n_vocab, rank}));
+        state.x      = state.arena.alloc(dim);
+        state.xb     = state.arena.alloc(dim);
+        state.xb2    = state.arena.alloc(dim);
+        state.hb     = state.arena.alloc(hidden);
+        state.hb2    = state.arena.alloc(hidden);
+        state.q      = state.arena.alloc(dim);
+        state.k      = state.arena.alloc(dim);
+        state.v      = state.arena.alloc(dim);
+        state.att    = state.arena.alloc(att);
+        state.logits = state.arena.alloc(n_vocab);
+        state.lora   = state.arena.alloc(rank);
+        LOG_INFO("Activation arena: ", state.arena.capacity() / 1024.0, " KB");
 
         // KV Cache
-        size_t cache_size = static_cast<size_t>(config.n_layers) * static_cast<size_t>(config.max_seq_len)
+        size_t cache_size = static_cast<size_t>(config.n_layers) * static_cast<size_t>(kv_rows())
                           * static_cast<size_t>(config.n_kv_heads) * static_cast<size_t>(config.head_dim);
 
         constexpr size_t MAX_CACHE_ELEMENTS = 25'000'000'000ULL; // ~100GB in floats
@@ -386,10 +597,118 @@ private:
             throw std::runtime_error("KV cache size exceeds limit");
         }
 
-        state.key_cache.resize(cache_size);
-        state.value_cache.resize(cache_size);
+        state.key_cache.assign(cache_size, 0.0f);
+        state.value_cache.assign(cache_size, 0.0f);
+        state.key_cache.shrink_to_fit();
+        state.value_cache.shrink_to_fit();
+    }
+
+    // out += the current adapter's low-rank update of a projection of in
+    void apply_lora(float *out, const float *in, const LoraAdapter::Factors &f, int in_dim, int out_dim)
+    {
+        if (!f.empty()) {
+            Ops::lora(
+                out, in, f.a.data(), f.b.data(), state.lora.data(), in_dim, adapter->rank, out_dim, adapter->scale);
+        }
+    }
+
+    // Rows per layer of the contiguous cache
+    int kv_rows() const { return config.sliding_window > 0 ? config.sliding_window : config.max_seq_len; }
+
+    // Logical blocks holding the attention sinks, never recycled
+    int sink_blocks() const { return (config.attention_sinks + config.block_size - 1) / config.block_size; }
+
+    // RoPE position of pos: with sinks the recycled blocks are cut out, so
+    // positions stay below sinks + window + block_size
+    int cache_position(int pos) const
+    {
+        return config.attention_sinks > 0 ? pos - recycled_blocks * config.block_size : pos;
+    }
+
+    // Sliding window: return every block between the sink blocks and the
+    // window of pos to block_manager. The table entries stay (as -1) so
+    // logical block numbers keep matching positions.
+    void recycle_kv_blocks(int pos)
+    {
+        int first_needed = std::max(0, pos - config.sliding_window + 1) / config.block_size;
+        int first        = sink_blocks() + recycled_blocks;
+        if (first >= first_needed) {
+            return;
+        }
+        for (int b = first; b < first_needed; b++) {
+            for (auto &table : block_tables) {
+                if (b < static_cast<int>(table.size())) {
+                    block_manager->free_block(table[b]);
+                    table[b] = -1;
+                }
+            }
+        }
+        recycled_blocks += first_needed - first;
+        if (config.attention_sinks > 0) {
+            shift_window_keys(first_needed, (first_needed - first) * config.block_size);
+        }
+        publish_kv_blocks(block_manager->get_num_blocks() - block_manager->get_num_free_blocks(),
+                          block_manager->get_num_blocks());
     }
 
+    // Attention sinks: rotate the cached keys of logical blocks from first on
+    // back by shift positions, as RoPE rotations compose (R(a) R(b) = R(a + b)).
+    // Whole blocks are rotated with one call; rows not written yet are
+    // overwritten later anyway.
+    void shift_window_keys(int first, int shift)
+    {
+        size_t block_elems = static_cast<size_t>(config.block_size) * config.n_kv_heads * config.head_dim;
+        size_t layer_elems = static_cast<size_t>(config.num_blocks) * block_elems;
+        for (int layer = 0; layer < config.n_layers; layer++) {
+            const auto &table = block_tables[layer];
+            float      *keys  = state.paged_key_cache.data() + layer * layer_elems;
+            for (int b = first; b < static_cast<int>(table.size()); b++) {
+                float *block = keys + static_cast<size_t>(table[b]) * block_elems;
+                kernels.apply_rope(block,
+                                   block,
+                                   -shift,
+                                   config.head_dim,
+                                   0,
+                                   config.block_size * config.n_kv_heads,
+                                   config.rope_theta);
+            }
+        }
+    }
+
+    // PagedAttention: map the next logical block of a layer to a free physical block
+    void allocate_kv_block(int layer)
+    {
+        int new_block = block_manager->allocate_block();
+        if (new_block == -1) {
+            throw std::runtime_error("Out of memory: no free blocks");
+        }
+        block_tables[layer].push_back(new_block);
+
+        publish_kv_blocks(block_manager->get_num_blocks() - block_manager->get_num_free_blocks(),
+                          block_manager->get_num_blocks());
+    }
+
+    // KV cache row for (layer, pos) in whichever layout is active
+    // Paged:      [n_layers, num_blocks, block_size, n_kv_heads, head_dim]
+    // Contiguous: [n_layers, kv_rows, n_kv_heads, head_dim], pos % kv_rows with a window
+    float *kv_slot(std::vector<float> &paged_cache, std::vector<float> &cache, int layer, int pos)
+    {
+        size_t kv_dim = static_cast<size_t>(config.n_kv_heads) * config.head_dim;
+        if (config.use_paged_attention) {
+            size_t layer_cache_offset = static_cast<size_t>(layer) * config.num_blocks * config.block_size * kv_dim;
+            int    physical_block     = block_tables[layer][pos / config.block_size];
+            size_t block_cache_offset = static_cast<size_t>(physical_block) * config.block_size * kv_dim;
+            size_t pos_cache_offset   = (pos % config.block_size) * kv_dim;
+            return paged_cache.data() + layer_cache_offset + block_cache_offset + pos_cache_offset;
+        }
+        size_t layer_offset = static_cast<size_t>(layer) * kv_rows() * kv_dim;
+        int    row          = config.sliding_window > 0 ? pos % config.sliding_window : pos;
+        return cache.data() + layer_offset + row * kv_dim;
+    }
+
+    float *key_slot(int layer, int pos) { return kv_slot(state.paged_key_cache, state.key_cache, layer, pos); }
+    float *value_slot(int layer, int pos) { return kv_slot(state.paged_value_cache, state.value_cache, layer, pos); }
+
     void attention(int layer, int pos, float *out)
     {
         if (config.use_paged_attention) {
@@ -402,32 +721,35 @@ private:
             const float *paged_key_ptr   = state.paged_key_cache.data() + layer_cache_offset;
             const float *paged_value_ptr = state.paged_value_cache.data() + layer_cache_offset;
 
-            Attention::paged_attention(out,
+            kernels.paged_attention(out,
+                                    state.q.data(),
+                                    paged_key_ptr,
+                                    paged_value_ptr,
+                                    block_tables[layer].data(),
+                                    state.att.data(),
+                                    num_tokens,
+                                    config.block_size,
+                                    config.head_dim,
+                                    config.n_heads,
+                                    config.n_kv_heads,
+                                    config.sliding_window,
+                                    config.attention_sinks);
+        }
+        else {
+            // Standard attention path
+            size_t layer_offset = static_cast<size_t>(layer) * kv_rows() * config.n_kv_heads * config.head_dim;
+
+            kernels.standard_attention(out,
                                        state.q.data(),
-                                       paged_key_ptr,
-                                       paged_value_ptr,
-                                       block_tables[layer].data(),
+                                       state.key_cache.data() + layer_offset,
+                                       state.value_cache.data() + layer_offset,
                                        state.att.data(),
-                                       num_tokens,
-                                       config.block_size,
+                                       pos,
                                        config.head_dim,
                                        config.n_heads,
-                                       config.n_kv_heads);
-        }
-        else {
-            // Standard attention path
-            int layer_offset = layer * config.max_seq_len * config.n_kv_heads * config.head_dim;
-
-            Attention::standard_attention(out,
-                                          state.q.data(),
-                                          state.key_cache.data() + layer_offset,
-                                          state.value_cache.data() + layer_offset,
-                                          state.att.data(),
-                                          pos,
-                                          config.head_dim,
-                                          config.n_heads,
-                                          config.n_kv_heads,
-                                          config.max_seq_len);
+                                       config.n_kv_heads,
+                                       config.max_seq_len,
+                                       config.sliding_window);
         }
     }
 };
@@ -0,0 +1,1024 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "core/packed_format.hpp"
+#include "core/weights.hpp"
+#include "utils/json_parser.hpp"
+#include "utils/logger.hpp"
+
+// ============================================================================
+// Model Loader - llama2.c, safetensors, GGUF and packed weight files
+//
+// Each format is parsed into a table of named tensors (dtype, shape and a
+// pointer into the mmapped file) and a Config built from the file's own
+// metadata. Weights are then taken from the table by role: F32 tensors that
+// are suitably aligned are mapped in place, with no copy, and paged in on
+// first use; F16, BF16 and the GGUF block quantizations (Q8_0, Q4_0) are
+// converted to owned f32 arrays, since every kernel computes in f32.
+// ============================================================================
+
+namespace fs = std::filesystem;
+
+// Read-only private mapping of a whole file
+class MappedFile
+{
+public:
+    explicit MappedFile(const std::string &path)
+        : path_(path)
+    {
+        int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0) {
+            throw std::runtime_error("Failed to open model file: " + path);
+        }
+        struct stat st;
+        if (fstat(fd, &st) != 0 || st.st_size == 0) {
+            ::close(fd);
+            throw std::runtime_error("Empty or unreadable model file: " + path);
+        }
+        size_ = static_cast<size_t>(st.st_size);
+        void *base = mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+        ::close(fd);
+        if (base == MAP_FAILED) {
+            throw std::runtime_error("Failed to map model file: " + path);
+        }
+        data_ = static_cast<const uint8_t *>(base);
+    }
+
+    ~MappedFile() { munmap(const_cast<uint8_t *>(data_), size_); }
+
+    MappedFile(const MappedFile &)            = delete;
+    MappedFile &operator=(const MappedFile &) = delete;
+
+    const uint8_t     *data() const { return data_; }
+    size_t             size() const { return size_; }
+    const std::string &path() const { return path_; }
+
+private:
+    std::string    path_;
+    const uint8_t *data_ = nullptr;
+    size_t         size_ = 0;
+};
+
+enum class DType { F32, F16, BF16, Q8_0, Q4_0 };
+
+inline const char *dtype_name(DType dtype)
+{
+    switch (dtype) {
+    case DType::F32:
+        return "F32";
+    case DType::F16:
+        return "F16";
+    case DType::BF16:
+        return "BF16";
+    case DType::Q8_0:
+        return "Q8_0";
+    case DType::Q4_0:
+        return "Q4_0";
+    }
+    return "?";
+}
+
+// Bytes of numel elements; the block quantizations pack 32 values per block
+// as an f16 scale followed by the quants
+inline size_t dtype_bytes(DType dtype, size_t numel)
+{
+    switch (dtype) {
+    case DType::F32:
+        return numel * 4;
+    case DType::F16:
+    case DType::BF16:
+        return numel * 2;
+    case DType::Q8_0:
+        return numel / 32 * (2 + 32);
+    case DType::Q4_0:
+        return numel / 32 * (2 + 16);
+    }
+    return 0;
+}
+
+inline float fp16_to_fp32(uint16_t h)
+{
+    uint32_t sign     = static_cast<uint32_t>(h & 0x8000) << 16;
+    uint32_t exponent = (h >> 10) & 0x1f;
+    uint32_t mantissa = h & 0x3ff;
+    uint32_t bits;
+    if (exponent == 0x1f) {
+        bits = sign | 0x7f800000 | (mantissa << 13); // Inf / NaN
+    }
+    else if (exponent != 0) {
+        bits = sign | ((exponent + 112) << 23) | (mantissa << 13);
+    }
+    else if (mantissa == 0) {
+        bits = sign; // Zero
+    }
+    else {
+        // Subnormal: renormalize
+        exponent = 113;
+        while (!(mantissa & 0x400)) {
+            mantissa <<= 1;
+            exponent--;
+        }
+        bits = sign | (exponent << 23) | ((mantissa & 0x3ff) << 13);
+    }
+    float f;
+    std::memcpy(&f, &bits, sizeof(f));
+    return f;
+}
+
+inline float bf16_to_fp32(uint16_t h)
+{
+    uint32_t bits = static_cast<uint32_t>(h) << 16;
+    float    f;
+    std::memcpy(&f, &bits, sizeof(f));
+    return f;
+}
+
+// One tensor of a model file
+struct TensorInfo
+{
+    DType                             dtype;
+    std::vector<int64_t>              shape; // Outermost dimension first
+    const uint8_t                    *data = nullptr;
+    std::shared_ptr<const MappedFile> file;
+
+    size_t numel() const
+    {
+        size_t n = 1;
+        for (int64_t d : shape) {
+            n *= static_cast<size_t>(d);
+        }
+        return n;
+    }
+};
+
+// A TensorInfo for shape at offset in file, checked to lie within the file
+inline TensorInfo make_tensor_info(const std::string                       &name,
+                                   DType                                    dtype,
+                                   std::vector<int64_t>                     shape,
+                                   size_t                                   offset,
+                                   const std::shared_ptr<const MappedFile> &file)
+{
+    TensorInfo t{dtype, std::move(shape), file->data() + offset, file};
+    if (dtype == DType::Q8_0 || dtype == DType::Q4_0) {
+        if (t.numel() % 32 != 0) {
+            throw std::runtime_error("Tensor " + name + ": quantized size is not a multiple of 32");
+        }
+    }
+    if (offset > file->size() || dtype_bytes(dtype, t.numel()) > file->size() - offset) {
+        throw std::runtime_error("Tensor " + name + " runs past the end of " + file->path());
+    }
+    return t;
+}
+
+// Convert any supported dtype to f32
+inline void dequantize(const TensorInfo &t, float *out)
+{
+    size_t         n   = t.numel();
+    const uint8_t *src = t.data;
+    auto           u16 = [](const uint8_t *p) {
+        uint16_t v;
+        std::memcpy(&v, p, sizeof(v));
+        return v;
+    };
+
+    switch (t.dtype) {
+    case DType::F32:
+        std::memcpy(out, src, n * sizeof(float));
+        break;
+    case DType::F16:
+        for (size_t i = 0; i < n; i++) {
+            out[i] = fp16_to_fp32(u16(src + 2 * i));
+        }
+        break;
+    case DType::BF16:
+        for (size_t i = 0; i < n; i++) {
+            out[i] = bf16_to_fp32(u16(src + 2 * i));
+        }
+        break;
+    case DType::Q8_0:
+        // Block: f16 scale, int8 quants[32]
+        for (size_t b = 0; b < n / 32; b++, src += 34) {
+            float         d  = fp16_to_fp32(u16(src));
+            const int8_t *qs = reinterpret_cast<const int8_t *>(src + 2);
+            for (int j = 0; j < 32; j++) {
+                out[b * 32 + j] = d * qs[j];
+            }
+        }
+        break;
+    case DType::Q4_0:
+        // Block: f16 scale, 16 bytes of nibbles; low nibbles are values
+        // 0..15 and high nibbles 16..31, both offset by 8
+        for (size_t b = 0; b < n / 32; b++, src += 18) {
+            float d = fp16_to_fp32(u16(src));
+            for (int j = 0; j < 16; j++) {
+                out[b * 32 + j]      = d * ((src[2 + j] & 0x0f) - 8);
+                out[b * 32 + j + 16] = d * ((src[2 + j] >> 4) - 8);
+            }
+        }
+        break;
+    }
+}
+
+// HF checkpoints order each head's rows of a [heads * head_dim, cols] matrix
+// as [first halves | second halves] of the RoPE pairs; forward() rotates
+// adjacent pairs (2i, 2i + 1)
+inline std::vector<float> interleave_rope_halves(const std::vector<float> &m, int heads, int head_dim, size_t cols)
+{
+    std::vector<float> out(m.size());
+    for (int h = 0; h < heads; h++) {
+        for (int i = 0; i < head_dim / 2; i++) {
+            for (int k = 0; k < 2; k++) {
+                size_t src = static_cast<size_t>(h) * head_dim + k * (head_dim / 2) + i;
+                size_t dst = static_cast<size_t>(h) * head_dim + 2 * i + k;
+                std::memcpy(out.data() + dst * cols, m.data() + src * cols, cols * sizeof(float));
+            }
+        }
+    }
+    return out;
+}
+
+// Tensor table of one safetensors file: an 8-byte header length, a JSON table
+// of {dtype, shape, data_offsets} and the raw tensor bytes. Tensors of dtypes
+// other than F32, F16 and BF16 are skipped.
+inline std::unordered_map<std::string, TensorInfo> read_safetensors(const std::string &path)
+{
+    auto     file = std::make_shared<const MappedFile>(path);
+    uint64_t header_len;
+    if (file->size() < sizeof(header_len)) {
+        throw std::runtime_error("Truncated safetensors file: " + path);
+    }
+    std::memcpy(&header_len, file->data(), sizeof(header_len));
+    if (header_len > file->size() - sizeof(header_len)) {
+        throw std::runtime_error("Corrupt safetensors header: " + path);
+    }
+    size_t data_start = sizeof(header_len) + header_len;
+
+    std::unordered_map<std::string, TensorInfo> tensors;
+    std::string      header(reinterpret_cast<const char *>(file->data()) + sizeof(header_len), header_len);
+    json::JsonObject table = json::JsonParser().parse(header);
+    for (const auto &[name, value] : table.data) {
+        const auto *entry = std::get_if<json::JsonObject>(&value);
+        if (name == "__metadata__" || !entry) {
+            continue;
+        }
+        std::string          dtype_str = entry->get_string("dtype");
+        std::vector<double>  offsets   = entry->get_numbers("data_offsets");
+        std::vector<int64_t> shape;
+        for (double d : entry->get_numbers("shape")) {
+            shape.push_back(static_cast<int64_t>(d));
+        }
+
+        DType dtype;
+        if (dtype_str == "F32") {
+            dtype = DType::F32;
+        }
+        else if (dtype_str == "F16") {
+            dtype = DType::F16;
+        }
+        else if (dtype_str == "BF16") {
+            dtype = DType::BF16;
+        }
+        else {
+            LOG_DEBUG("Safetensors: skipping ", name, " (", dtype_str, ")");
+            continue;
+        }
+        if (offsets.size() != 2) {
+            throw std::runtime_error("Safetensors tensor " + name + " has no data_offsets");
+        }
+        size_t offset = data_start + static_cast<size_t>(offsets[0]);
+        tensors[name] = make_tensor_info(name, dtype, std::move(shape), offset, file);
+    }
+    return tensors;
+}
+
+class ModelLoader
+{
+public:
+    virtual ~ModelLoader() = default;
+
+    // A .pack file (see `pack`), a .gguf file, a .safetensors file or a
+    // directory of safetensors shards (with config.json), and anything else
+    // as a llama2.c checkpoint
+    static std::unique_ptr<ModelLoader> open(const std::string &path);
+
+    virtual const char *format() const = 0;
+
+    const Config &config() const { return config_; }
+
+    // Tokenizer vocabulary embedded in the model file (GGUF, packed); empty if none
+    const std::vector<std::string> &vocab() const { return vocab_; }
+    const std::vector<float>       &vocab_scores() const { return vocab_scores_; }
+
+    void load_weights(TransformerWeights &w)
+    {
+        const Config &c      = config_;
+        size_t        q_dim  = static_cast<size_t>(c.n_heads) * c.head_dim;
+        size_t        kv_dim = static_cast<size_t>(c.n_kv_heads) * c.head_dim;
+
+        w.token_embedding_table = take(EMBED, 0, static_cast<size_t>(c.vocab_size) * c.dim);
+        w.layers.resize(c.n_layers);
+        for (int i = 0; i < c.n_layers; i++) {
+            auto &l          = w.layers[i];
+            l.rms_att_weight = take(RMS_ATT, i, c.dim);
+            l.wq             = take(WQ, i, q_dim * c.dim, c.n_heads);
+            l.wk             = take(WK, i, kv_dim * c.dim, c.n_kv_heads);
+            l.wv             = take(WV, i, kv_dim * c.dim);
+            l.wo             = take(WO, i, c.dim * q_dim);
+            l.rms_ffn_weight = take(RMS_FFN, i, c.dim);
+            l.w_gate         = take(W_GATE, i, static_cast<size_t>(c.hidden_dim) * c.dim);
+            l.w_up           = take(W_UP, i, static_cast<size_t>(c.hidden_dim) * c.dim);
+            l.w_down         = take(W_DOWN, i, static_cast<size_t>(c.dim) * c.hidden_dim);
+        }
+        w.rms_final_weight = take(RMS_FINAL, 0, c.dim);
+
+        if (tensors_.count(tensor_name(LM_HEAD, 0))) {
+            w.lm_head = take(LM_HEAD, 0, static_cast<size_t>(c.vocab_size) * c.dim);
+        }
+        else {
+            // Shared weights
+            w.weights_shared = true;
+            w.lm_head        = w.token_embedding_table.share();
+            LOG_INFO("Weights shared: lm_head <- token_embedding");
+        }
+
+        LOG_INFO("Loaded ", format(), " weights: ", mapped_, " tensors mapped in place, ", converted_, " converted");
+    }
+
+protected:
+    using Role = TransformerWeights::Role;
+    using enum TransformerWeights::Role;
+
+    virtual std::string tensor_name(Role role, int layer) const = 0;
+
+    Config                                      config_{};
+    std::unordered_map<std::string, TensorInfo> tensors_;
+    std::vector<std::string>                    vocab_;
+    std::vector<float>                          vocab_scores_;
+
+    // Rows of wq/wk hold each head's RoPE pairs as two halves (HF layout)
+    // rather than interleaved (llama2.c and GGUF layout)
+    bool rope_halves_ = false;
+
+    void add_tensor(const std::string                       &name,
+                    DType                                    dtype,
+                    std::vector<int64_t>                     shape,
+                    size_t                                   offset,
+                    const std::shared_ptr<const MappedFile> &file)
+    {
+        tensors_[name] = make_tensor_info(name, dtype, std::move(shape), offset, file);
+    }
+
+    // Derive head_dim and sanity-check the metadata
+    void finish_config()
+    {
+        Config &c = config_;
+        if (c.dim <= 0 || c.hidden_dim <= 0 || c.n_layers <= 0 || c.n_heads <= 0 || c.n_kv_heads <= 0
+            || c.vocab_size <= 0 || c.max_seq_len <= 0 || c.sliding_window < 0
+            || c.sliding_window > c.max_seq_len) {
+            throw std::runtime_error(std::string("Invalid ") + format() + " model config");
+        }
+        if (c.dim % c.n_heads != 0 || c.n_heads % c.n_kv_heads != 0) {
+            throw std::runtime_error("Model config: heads do not divide dim / query heads");
+        }
+        c.head_dim = c.dim / c.n_heads;
+    }
+
+private:
+    int mapped_    = 0;
+    int converted_ = 0;
+
+    // The tensor for role as an f32 [rows, cols] array. rope_heads > 0 marks
+    // wq/wk, whose rows are reordered if the file stores RoPE halves.
+    Tensor take(Role role, int layer, size_t expected, int rope_heads = 0)
+    {
+        std::string name = tensor_name(role, layer);
+        auto        it   = tensors_.find(name);
+        if (it == tensors_.end()) {
+            throw std::runtime_error(std::string("Missing tensor in ") + format() + " model: " + name);
+        }
+        const TensorInfo &t = it->second;
+        if (t.numel() != expected) {
+            throw std::runtime_error("Tensor " + name + " has " + std::to_string(t.numel()) + " elements, expected "
+                                     + std::to_string(expected));
+        }
+
+        bool permute = rope_halves_ && rope_heads > 0;
+        if (t.dtype == DType::F32 && !permute && reinterpret_cast<uintptr_t>(t.data) % alignof(float) == 0) {
+            mapped_++;
+            return Tensor::view(reinterpret_cast<const float *>(t.data), expected, t.file);
+        }
+
+        std::vector<float> out(expected);
+        dequantize(t, out.data());
+        if (permute) {
+            out = interleave_rope_halves(out, rope_heads, config_.head_dim, config_.dim);
+        }
+        converted_++;
+        return Tensor(std::move(out));
+    }
+};
+
+// ============================================================================
+// llama2.c checkpoint: 7 int32 config fields, then every f32 tensor grouped by
+// parameter type, then the classifier unless it is shared with the embedding
+// ============================================================================
+
+class Llama2cLoader : public ModelLoader
+{
+public:
+    explicit Llama2cLoader(const std::string &path)
+    {
+        auto file = std::make_shared<const MappedFile>(path);
+        if (file->size() < 7 * sizeof(int32_t)) {
+            throw std::runtime_error("Model file too small: " + path);
+        }
+        int32_t header[7];
+        std::memcpy(header, file->data(), sizeof(header));
+        config_.dim         = header[0];
+        config_.hidden_dim  = header[1];
+        config_.n_layers    = header[2];
+        config_.n_heads     = header[3];
+        config_.n_kv_heads  = header[4];
+        config_.vocab_size  = header[5];
+        config_.max_seq_len = header[6];
+        finish_config();
+
+        const Config &c      = config_;
+        size_t        q_dim  = static_cast<size_t>(c.n_heads) * c.head_dim;
+        size_t        kv_dim = static_cast<size_t>(c.n_kv_heads) * c.head_dim;
+        size_t        offset = 7 * sizeof(int32_t);
+
+        auto add = [&](Role role, int layer, size_t numel) {
+            add_tensor(tensor_name(role, layer), DType::F32, {static_cast<int64_t>(numel)}, offset, file);
+            offset += numel * sizeof(float);
+        };
+        auto add_layers = [&](Role role, size_t numel) {
+            for (int i = 0; i < c.n_layers; i++) {
+                add(role, i, numel);
+            }
+        };
+
+        add(EMBED, 0, static_cast<size_t>(c.vocab_size) * c.dim);
+        add_layers(RMS_ATT, c.dim);
+        add_layers(WQ, q_dim * c.dim);
+        add_layers(WK, kv_dim * c.dim);
+        add_layers(WV, kv_dim * c.dim);
+        add_layers(WO, c.dim * q_dim);
+        add_layers(RMS_FFN, c.dim);
+        add_layers(W_GATE, static_cast<size_t>(c.hidden_dim) * c.dim);
+        add_layers(W_DOWN, static_cast<size_t>(c.dim) * c.hidden_dim);
+        add_layers(W_UP, static_cast<size_t>(c.hidden_dim) * c.dim);
+        add(RMS_FINAL, 0, c.dim);
+
+        size_t lm_head_bytes = static_cast<size_t>(c.vocab_size) * c.dim * sizeof(float);
+        if (file->size() - offset >= lm_head_bytes) {
+            add(LM_HEAD, 0, static_cast<size_t>(c.vocab_size) * c.dim);
+        }
+    }
+
+    const char *format() const override { return "llama2.c"; }
+
+protected:
+    std::string tensor_name(Role role, int layer) const override
+    {
+        return TransformerWeights::tensor_name(role, layer);
+    }
+};
+
+// ============================================================================
+// Safetensors (Hugging Face Llama checkpoints): one or more shards, each an
+// 8-byte header length, a JSON table of {dtype, shape, data_offsets} and the
+// raw tensor bytes; the config comes from config.json next to the shards
+// ============================================================================
+
+class SafetensorsLoader : public ModelLoader
+{
+public:
+    explicit SafetensorsLoader(const std::string &path)
+    {
+        fs::path                 p(path);
+        fs::path                 dir = fs::is_directory(p) ? p : p.parent_path();
+        std::vector<std::string> shards;
+        if (fs::is_directory(p)) {
+            for (const auto &entry : fs::directory_iterator(p)) {
+                if (entry.path().extension() == ".safetensors") {
+                    shards.push_back(entry.path().string());
+                }
+            }
+            std::sort(shards.begin(), shards.end());
+        }
+        else {
+            shards.push_back(path);
+        }
+        if (shards.empty()) {
+            throw std::runtime_error("No .safetensors files in: " + path);
+        }
+
+        read_config((dir / "config.json").string());
+        for (const auto &shard : shards) {
+            read_shard(shard);
+        }
+        rope_halves_ = true;
+        LOG_INFO("Safetensors: ", tensors_.size(), " tensors in ", shards.size(), " shard(s)");
+    }
+
+    const char *format() const override { return "safetensors"; }
+
+protected:
+    std::string tensor_name(Role role, int layer) const override
+    {
+        static const char *names[] = {"model.embed_tokens.weight",
+                                      "input_layernorm.weight",
+                                      "self_attn.q_proj.weight",
+                                      "self_attn.k_proj.weight",
+                                      "self_attn.v_proj.weight",
+                                      "self_attn.o_proj.weight",
+                                      "post_attention_layernorm.weight",
+                                      "mlp.gate_proj.weight",
+                                      "mlp.up_proj.weight",
+                                      "mlp.down_proj.weight",
+                                      "model.norm.weight",
+                                      "lm_head.weight"};
+        if (role == EMBED || role == RMS_FINAL || role == LM_HEAD) {
+            return names[role];
+        }
+        return "model.layers." + std::to_string(layer) + "." + names[role];
+    }
+
+private:
+    void read_config(const std::string &path)
+    {
+        if (!fs::exists(path)) {
+            throw std::runtime_error("config.json not found next to safetensors: " + path);
+        }
+        json::JsonObject cfg = json::JsonParser().parse_file(path);
+
+        std::string model_type = cfg.get_string("model_type", "llama");
+        if (model_type != "llama" && model_type != "mistral") {
+            LOG_WARNING("Safetensors model_type '", model_type, "' is not Llama; loading it as Llama");
+        }
+
+        Config &c        = config_;
+        c.dim            = cfg.get_int("hidden_size");
+        c.hidden_dim     = cfg.get_int("intermediate_size");
+        c.n_layers       = cfg.get_int("num_hidden_layers");
+        c.n_heads        = cfg.get_int("num_attention_heads");
+        c.n_kv_heads     = cfg.get_int("num_key_value_heads", c.n_heads);
+        c.vocab_size     = cfg.get_int("vocab_size");
+        c.max_seq_len    = cfg.get_int("max_position_embeddings", 2048);
+        c.rope_theta     = cfg.get_float("rope_theta", 10000.0f);
+        auto eos         = cfg.get_numbers("eos_token_id"); // A number or a list of them
+        c.eos_token_id   = eos.empty() ? 2 : static_cast<int>(eos.front());
+        c.sliding_window = cfg.get_bool("use_sliding_window", true) ? cfg.get_int("sliding_window", 0) : 0;
+        if (c.sliding_window >= c.max_seq_len) {
+            c.sliding_window = 0; // Covers the whole context anyway
+        }
+        finish_config();
+
+        if (cfg.has("head_dim") && cfg.get_int("head_dim") != c.head_dim) {
+            throw std::runtime_error("config.json: head_dim != hidden_size / num_attention_heads is not supported");
+        }
+    }
+
+    void read_shard(const std::string &path)
+    {
+        for (auto &[name, tensor] : read_safetensors(path)) {
+            tensors_[name] = std::move(tensor);
+        }
+    }
+};
+
+// ============================================================================
+// GGUF (llama.cpp): a header of typed key/value metadata and tensor infos,
+// then the tensor data, each tensor aligned to general.alignment. Dimensions
+// are listed innermost first; wq/wk rows are already RoPE-interleaved.
+// ============================================================================
+
+class GGUFLoader : public ModelLoader
+{
+public:
+    explicit GGUFLoader(const std::string &path)
+    {
+        auto file = std::make_shared<const MappedFile>(path);
+        cur_      = file->data();
+        end_      = file->data() + file->size();
+
+        if (read<uint32_t>() != 0x46554747) { // "GGUF"
+            throw std::runtime_error("Not a GGUF file: " + path);
+        }
+        uint32_t version = read<uint32_t>();
+        if (version < 2) {
+            throw std::runtime_error("GGUF version " + std::to_string(version) + " is not supported");
+        }
+        uint64_t n_tensors = read<uint64_t>();
+        uint64_t n_kv      = read<uint64_t>();
+
+        for (uint64_t i = 0; i < n_kv; i++) {
+            std::string key = read_string();
+            read_value(key, read<uint32_t>());
+        }
+
+        struct PendingTensor
+        {
+            std::string          name;
+            DType                dtype;
+            std::vector<int64_t> shape;
+            uint64_t             offset;
+        };
+        std::vector<PendingTensor> pending;
+        for (uint64_t i = 0; i < n_tensors; i++) {
+            PendingTensor t;
+            t.name          = read_string();
+            uint32_t n_dims = read<uint32_t>();
+            for (uint32_t d = 0; d < n_dims; d++) {
+                t.shape.insert(t.shape.begin(), static_cast<int64_t>(read<uint64_t>()));
+            }
+            t.dtype  = ggml_dtype(t.name, read<uint32_t>());
+            t.offset = read<uint64_t>();
+            pending.push_back(std::move(t));
+        }
+
+        size_t alignment  = static_cast<size_t>(number("general.alignment", 32));
+        size_t data_start = static_cast<size_t>(cur_ - file->data());
+        data_start        = (data_start + alignment - 1) / alignment * alignment;
+        for (auto &t : pending) {
+            add_tensor(t.name, t.dtype, std::move(t.shape), data_start + t.offset, file);
+        }
+
+        read_config();
+        read_vocab();
+        LOG_INFO("GGUF v", version, ": ", tensors_.size(), " tensors, ", n_kv, " metadata keys");
+    }
+
+    const char *format() const override { return "GGUF"; }
+
+protected:
+    std::string tensor_name(Role role, int layer) const override
+    {
+        static const char *names[] = {"token_embd.weight",
+                                      "attn_norm.weight",
+                                      "attn_q.weight",
+                                      "attn_k.weight",
+                                      "attn_v.weight",
+                                      "attn_output.weight",
+                                      "ffn_norm.weight",
+                                      "ffn_gate.weight",
+                                      "ffn_up.weight",
+                                      "ffn_down.weight",
+                                      "output_norm.weight",
+                                      "output.weight"};
+        if (role == EMBED || role == RMS_FINAL || role == LM_HEAD) {
+            return names[role];
+        }
+        return "blk." + std::to_string(layer) + "." + names[role];
+    }
+
+private:
+    enum ValueType : uint32_t {
+        UINT8   = 0,
+        INT8    = 1,
+        UINT16  = 2,
+        INT16   = 3,
+        UINT32  = 4,
+        INT32   = 5,
+        FLOAT32 = 6,
+        BOOL    = 7,
+        STRING  = 8,
+        ARRAY   = 9,
+        UINT64  = 10,
+        INT64   = 11,
+        FLOAT64 = 12,
+    };
+
+    const uint8_t *cur_ = nullptr;
+    const uint8_t *end_ = nullptr;
+
+    std::unordered_map<std::string, double>      numbers_;
+    std::unordered_map<std::string, std::string> strings_;
+    std::vector<std::string>                     tokens_;
+    std::vector<float>                           scores_;
+
+    template <typename T> T read()
+    {
+        if (static_cast<size_t>(end_ - cur_) < sizeof(T)) {
+            throw std::runtime_error("Truncated GGUF header");
+        }
+        T v;
+        std::memcpy(&v, cur_, sizeof(T));
+        cur_ += sizeof(T);
+        return v;
+    }
+
+    std::string read_string()
+    {
+        uint64_t len = read<uint64_t>();
+        if (len > static_cast<uint64_t>(end_ - cur_)) {
+            throw std::runtime_error("Truncated GGUF string");
+        }
+        std::string s(reinterpret_cast<const char *>(cur_), len);
+        cur_ += len;
+        return s;
+    }
+
+    // A scalar of the given type as a double; false if the type is not numeric
+    bool read_number(uint32_t type, double &out)
+    {
+        switch (type) {
+        case UINT8:
+            out = read<uint8_t>();
+            return true;
+        case INT8:
+            out = read<int8_t>();
+            return true;
+        case UINT16:
+            out = read<uint16_t>();
+            return true;
+        case INT16:
+            out = read<int16_t>();
+            return true;
+        case UINT32:
+            out = read<uint32_t>();
+            return true;
+        case INT32:
+            out = read<int32_t>();
+            return true;
+        case FLOAT32:
+            out = read<float>();
+            return true;
+        case BOOL:
+            out = read<uint8_t>();
+            return true;
+        case UINT64:
+            out = static_cast<double>(read<uint64_t>());
+            return true;
+        case INT64:
+            out = static_cast<double>(read<int64_t>());
+            return true;
+        case FLOAT64:
+            out = read<double>();
+            return true;
+        }
+        return false;
+    }
+
+    // Keep the scalars and the two vocabulary arrays; skip everything else
+    void read_value(const std::string &key, uint32_t type)
+    {
+        double number;
+        if (read_number(type, number)) {
+            numbers_[key] = number;
+            return;
+        }
+        if (type == STRING) {
+            strings_[key] = read_string();
+            return;
+        }
+        if (type != ARRAY) {
+            throw std::runtime_error("GGUF key " + key + " has unknown type " + std::to_string(type));
+        }
+
+        uint32_t elem_type = read<uint32_t>();
+        uint64_t count     = read<uint64_t>();
+        for (uint64_t i = 0; i < count; i++) {
+            if (key == "tokenizer.ggml.tokens" && elem_type == STRING) {
+                tokens_.push_back(read_string());
+            }
+            else if (key == "tokenizer.ggml.scores" && elem_type == FLOAT32) {
+                scores_.push_back(read<float>());
+            }
+            else if (elem_type == STRING) {
+                read_string();
+            }
+            else if (elem_type == ARRAY || !read_number(elem_type, number)) {
+                read_value(key, elem_type);
+            }
+        }
+    }
+
+    double number(const std::string &key, double default_val) const
+    {
+        auto it = numbers_.find(key);
+        return it == numbers_.end() ? default_val : it->second;
+    }
+
+    static DType ggml_dtype(const std::string &name, uint32_t type)
+    {
+        switch (type) {
+        case 0:
+            return DType::F32;
+        case 1:
+            return DType::F16;
+        case 2:
+            return DType::Q4_0;
+        case 8:
+            return DType::Q8_0;
+        case 30:
+            return DType::BF16;
+        }
+        throw std::runtime_error("GGUF tensor " + name + ": ggml type " + std::to_string(type)
+                                 + " is not supported (F32, F16, BF16, Q8_0, Q4_0 are)");
+    }
+
+    void read_config()
+    {
+        auto        arch_it = strings_.find("general.architecture");
+        std::string arch    = arch_it == strings_.end() ? "llama" : arch_it->second;
+        if (arch != "llama") {
+            LOG_WARNING("GGUF architecture '", arch, "' is not llama; loading it as Llama");
+        }
+
+        auto embd = tensors_.find(tensor_name(EMBED, 0));
+        if (embd == tensors_.end() || embd->second.shape.size() != 2) {
+            throw std::runtime_error("GGUF model has no 2-D " + tensor_name(EMBED, 0));
+        }
+
+        Config &c      = config_;
+        c.dim          = static_cast<int>(number(arch + ".embedding_length", 0));
+        c.hidden_dim   = static_cast<int>(number(arch + ".feed_forward_length", 0));
+        c.n_layers     = static_cast<int>(number(arch + ".block_count", 0));
+        c.n_heads      = static_cast<int>(number(arch + ".attention.head_count", 0));
+        c.n_kv_heads   = static_cast<int>(number(arch + ".attention.head_count_kv", c.n_heads));
+        c.vocab_size   = static_cast<int>(embd->second.shape[0]);
+        c.max_seq_len  = static_cast<int>(number(arch + ".context_length", 2048));
+        c.rope_theta   = static_cast<float>(number(arch + ".rope.freq_base", 10000.0));
+        c.eos_token_id = static_cast<int>(number("tokenizer.ggml.eos_token_id", 2));
+        finish_config();
+
+        double key_length = number(arch + ".attention.key_length", c.head_dim);
+        if (static_cast<int>(key_length) != c.head_dim) {
+            throw std::runtime_error("GGUF: attention.key_length != embedding_length / head_count is not supported");
+        }
+    }
+
+    // SentencePiece vocabularies only; BPE (gpt2) ones need merges, which the
+    // Tokenizer does not implement, so tokenizer.bin is used instead
+    void read_vocab()
+    {
+        auto model_it = strings_.find("tokenizer.ggml.model");
+        if (tokens_.empty() || model_it == strings_.end()) {
+            return;
+        }
+        if (model_it->second != "llama") {
+            LOG_WARNING("GGUF tokenizer '", model_it->second, "' is not supported; tokenizer.bin is required");
+            return;
+        }
+        if (static_cast<int>(tokens_.size()) != config_.vocab_size) {
+            LOG_WARNING("GGUF vocabulary has ", tokens_.size(), " tokens for vocab_size ", config_.vocab_size);
+            return;
+        }
+
+        // SentencePiece marks spaces with U+2581; the Tokenizer expects ' '
+        static const std::string space_mark = "\xe2\x96\x81";
+        vocab_.reserve(tokens_.size());
+        for (std::string &token : tokens_) {
+            for (size_t at = token.find(space_mark); at != std::string::npos; at = token.find(space_mark, at + 1)) {
+                token.replace(at, space_mark.size(), " ");
+            }
+            vocab_.push_back(std::move(token));
+        }
+        vocab_scores_ = scores_;
+        vocab_scores_.resize(vocab_.size(), 0.0f);
+    }
+};
+
+// ============================================================================
+// Packed model (core/packed_format.hpp): every tensor is already f32 in the
+// kernels' layout, so every tensor is mapped in place
+// ============================================================================
+
+class PackedLoader : public ModelLoader
+{
+public:
+    explicit PackedLoader(const std::string &path)
+        : file_(std::make_shared<const MappedFile>(path))
+    {
+        Pack::Header h;
+        if (file_->size() < sizeof(h)) {
+            throw std::runtime_error("Not a packed model: " + path);
+        }
+        std::memcpy(&h, file_->data(), sizeof(h));
+        if (std::memcmp(h.magic, Pack::MAGIC, sizeof(Pack::MAGIC)) != 0) {
+            throw std::runtime_error("Not a packed model: " + path);
+        }
+        if (h.version != Pack::VERSION || h.layout != Pack::LAYOUT_F32_ROW_MAJOR) {
+            throw std::runtime_error("Packed model " + path + " has version " + std::to_string(h.version)
+                                     + ", layout " + std::to_string(h.layout) + "; re-run pack with this build");
+        }
+        if (h.file_size != file_->size()) {
+            throw std::runtime_error("Truncated packed model: " + path);
+        }
+        uint64_t table_bytes = h.num_tensors * sizeof(Pack::TensorEntry);
+        if (h.num_tensors > file_->size() / sizeof(Pack::TensorEntry) || h.vocab_offset != sizeof(h) + table_bytes
+            || h.vocab_bytes > file_->size() - h.vocab_offset) {
+            throw std::runtime_error("Corrupt packed model header: " + path);
+        }
+        if (Pack::metadata_checksum(h, file_->data() + sizeof(h), table_bytes + h.vocab_bytes) != h.checksum) {
+            throw std::runtime_error("Packed model checksum mismatch: " + path);
+        }
+
+        Config &c        = config_;
+        c.dim            = h.dim;
+        c.hidden_dim     = h.hidden_dim;
+        c.n_layers       = h.n_layers;
+        c.n_heads        = h.n_heads;
+        c.n_kv_heads     = h.n_kv_heads;
+        c.vocab_size     = h.vocab_size;
+        c.max_seq_len    = h.max_seq_len;
+        c.eos_token_id   = h.eos_token_id;
+        c.rope_theta     = h.rope_theta;
+        c.sliding_window = h.sliding_window;
+        finish_config();
+
+        entries_.resize(h.num_tensors);
+        std::memcpy(entries_.data(), file_->data() + sizeof(h), table_bytes);
+        for (auto &entry : entries_) {
+            entry.name[sizeof(entry.name) - 1] = '\0';
+            if (entry.offset % Pack::ALIGNMENT != 0) {
+                throw std::runtime_error(std::string("Misaligned tensor in packed model: ") + entry.name);
+            }
+            add_tensor(entry.name, DType::F32, {static_cast<int64_t>(entry.numel)}, entry.offset, file_);
+        }
+
+        const uint8_t *p   = file_->data() + h.vocab_offset;
+        const uint8_t *end = p + h.vocab_bytes;
+        while (p < end) {
+            float    score;
+            uint32_t len;
+            if (static_cast<size_t>(end - p) < sizeof(score) + sizeof(len)) {
+                throw std::runtime_error("Corrupt packed vocabulary: " + path);
+            }
+            std::memcpy(&score, p, sizeof(score));
+            std::memcpy(&len, p + sizeof(score), sizeof(len));
+            p += sizeof(score) + sizeof(len);
+            if (len > static_cast<size_t>(end - p)) {
+                throw std::runtime_error("Corrupt packed vocabulary: " + path);
+            }
+            vocab_.emplace_back(reinterpret_cast<const char *>(p), len);
+            vocab_scores_.push_back(score);
+            p += len;
+        }
+
+        LOG_INFO("Packed model v",
+                 h.version,
+                 " (",
+                 std::string(h.isa, strnlen(h.isa, sizeof(h.isa))),
+                 "): ",
+                 entries_.size(),
+                 " tensors, ",
+                 vocab_.size(),
+                 " vocabulary tokens");
+    }
+
+    const char *format() const override { return "packed"; }
+
+    // Names of the tensors whose bytes no longer match their checksum
+    std::vector<std::string> verify_tensors() const
+    {
+        std::vector<std::string> corrupt;
+        for (const auto &entry : entries_) {
+            if (Pack::checksum(file_->data() + entry.offset, entry.numel * sizeof(float)) != entry.checksum) {
+                corrupt.push_back(entry.name);
+            }
+        }
+        return corrupt;
+    }
+
+protected:
+    std::string tensor_name(Role role, int layer) const override
+    {
+        return TransformerWeights::tensor_name(role, layer);
+    }
+
+private:
+    std::shared_ptr<const MappedFile> file_;
+    std::vector<Pack::TensorEntry>    entries_;
+};
+
+inline std::unique_ptr<ModelLoader> ModelLoader::open(const std::string &path)
+{
+    fs::path p(path);
+    if (p.extension() == ".pack") {
+        return std::make_unique<PackedLoader>(path);
+    }
+    if (fs::is_directory(p) || p.extension() == ".safetensors") {
+        return std::make_unique<SafetensorsLoader>(path);
+    }
+    if (p.extension() == ".gguf") {
+        return std::make_unique<GGUFLoader>(path);
+    }
+    return std::make_unique<Llama2cLoader>(path);
+}
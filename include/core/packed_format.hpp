@@ -0,0 +1,219 @@
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <unistd.h>
+
+#include "core/weights.hpp"
+
+// ============================================================================
+// Packed Model Format - Weights stored in the layout the kernels read
+//
+// `pack` converts a model of any supported format once into a file whose
+// tensors need no work at load: f32, row-major [out, in], wq/wk rows
+// RoPE-interleaved, each tensor 64-byte aligned, tokenizer vocabulary
+// included. Loading is mmap plus turning table offsets into pointers; no
+// tensor is converted, copied or read until the kernels touch it.
+//
+// File: Header | TensorEntry[num_tensors] | vocab | 64-byte aligned tensors
+//
+// The header records the format version and the weight layout; a loader
+// rejects layouts it does not know rather than guessing. The header, table
+// and vocab are checksummed and verified on every load; each tensor has its
+// own checksum, which `pack --verify` checks (reading every byte would undo
+// the point of mapping).
+// ============================================================================
+
+namespace Pack {
+
+constexpr char     MAGIC[8]  = {'N', 'V', 'L', 'L', 'M', 'P', 'K', '\0'};
+constexpr uint32_t VERSION   = 2; // 2: sliding_window
+constexpr uint64_t ALIGNMENT = 64;
+
+// Weight layouts; add one (and bump nothing else) when a kernel wants its
+// weights pre-arranged differently
+enum Layout : uint32_t {
+    LAYOUT_F32_ROW_MAJOR = 1, // f32 [out, in], the layout Ops::matmul reads
+};
+
+struct Header
+{
+    char     magic[8];
+    uint32_t version;
+    uint32_t layout;
+    char     isa[16]; // Target the packer was built for, e.g. "x86_64-avx2"
+    int32_t  dim;
+    int32_t  hidden_dim;
+    int32_t  n_layers;
+    int32_t  n_heads;
+    int32_t  n_kv_heads;
+    int32_t  vocab_size;
+    int32_t  max_seq_len;
+    int32_t  eos_token_id;
+    float    rope_theta;
+    uint32_t weights_shared;
+    int32_t  sliding_window; // 0 = full context
+    uint32_t reserved;       // Zero
+    uint64_t num_tensors;
+    uint64_t vocab_offset; // Per token: f32 score, u32 length, bytes
+    uint64_t vocab_bytes;
+    uint64_t file_size;
+    uint64_t checksum; // Of header (with this field 0), table and vocab
+};
+
+struct TensorEntry
+{
+    char     name[48]; // TransformerWeights::tensor_name, NUL-terminated
+    uint64_t offset;   // From the start of the file, ALIGNMENT-aligned
+    uint64_t numel;    // f32 elements
+    uint64_t checksum; // Of the tensor's bytes
+};
+
+constexpr uint64_t FNV_OFFSET = 1469598103934665603ULL;
+constexpr uint64_t FNV_PRIME  = 1099511628211ULL;
+
+// FNV-1a over 64-bit words (then the tail bytes): fast enough to checksum
+// gigabytes of weights at pack time
+inline uint64_t checksum(const void *data, size_t len, uint64_t seed = FNV_OFFSET)
+{
+    const auto *bytes = static_cast<const unsigned char *>(data);
+    uint64_t    h     = seed;
+    size_t      i     = 0;
+    for (; i + 8 <= len; i += 8) {
+        uint64_t word;
+        std::memcpy(&word, bytes + i, sizeof(word));
+        h = (h ^ word) * FNV_PRIME;
+    }
+    for (; i < len; i++) {
+        h = (h ^ bytes[i]) * FNV_PRIME;
+    }
+    return h;
+}
+
+// Checksum of the header, table and vocab (the bytes before the tensors)
+inline uint64_t metadata_checksum(Header header, const void *table_and_vocab, size_t len)
+{
+    header.checksum = 0;
+    return checksum(table_and_vocab, len, checksum(&header, sizeof(header)));
+}
+
+inline const char *build_isa()
+{
+#if defined(__x86_64__) && defined(__AVX512F__)
+    return "x86_64-avx512";
+#elif defined(__x86_64__) && defined(__AVX2__)
+    return "x86_64-avx2";
+#elif defined(__x86_64__)
+    return "x86_64";
+#elif defined(__aarch64__)
+    return "aarch64";
+#else
+    return "generic";
+#endif
+}
+
+inline uint64_t align_up(uint64_t offset) { return (offset + ALIGNMENT - 1) / ALIGNMENT * ALIGNMENT; }
+
+// Write weights (as loaded, i.e. already in kernel layout) and the tokenizer
+// vocabulary to path. Returns the file size.
+inline uint64_t write(const std::string              &path,
+                      const Config                   &config,
+                      const TransformerWeights       &weights,
+                      const std::vector<std::string> &vocab,
+                      const std::vector<float>       &vocab_scores)
+{
+    Header header{};
+    std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+    std::strncpy(header.isa, build_isa(), sizeof(header.isa) - 1);
+    header.version        = VERSION;
+    header.layout         = LAYOUT_F32_ROW_MAJOR;
+    header.dim            = config.dim;
+    header.hidden_dim     = config.hidden_dim;
+    header.n_layers       = config.n_layers;
+    header.n_heads        = config.n_heads;
+    header.n_kv_heads     = config.n_kv_heads;
+    header.vocab_size     = config.vocab_size;
+    header.max_seq_len    = config.max_seq_len;
+    header.eos_token_id   = config.eos_token_id;
+    header.rope_theta     = config.rope_theta;
+    header.weights_shared = weights.weights_shared;
+    header.sliding_window = config.sliding_window;
+
+    // Metadata: table then vocab, right after the header
+    std::vector<TensorEntry>    entries;
+    std::vector<const Tensor *> tensors;
+    weights.for_each_tensor([&](TransformerWeights::Role role, int layer, const Tensor &t) {
+        TensorEntry entry{};
+        std::string name = TransformerWeights::tensor_name(role, layer);
+        std::strncpy(entry.name, name.c_str(), sizeof(entry.name) - 1);
+        entry.numel    = t.size();
+        entry.checksum = checksum(t.data(), t.size() * sizeof(float));
+        entries.push_back(entry);
+        tensors.push_back(&t);
+    });
+
+    std::vector<char> metadata(entries.size() * sizeof(TensorEntry));
+    for (size_t i = 0; i < vocab.size(); i++) {
+        float       score       = i < vocab_scores.size() ? vocab_scores[i] : 0.0f;
+        uint32_t    len         = static_cast<uint32_t>(vocab[i].size());
+        const char *score_bytes = reinterpret_cast<const char *>(&score);
+        const char *len_bytes   = reinterpret_cast<const char *>(&len);
+        metadata.insert(metadata.end(), score_bytes, score_bytes + sizeof(score));
+        metadata.insert(metadata.end(), len_bytes, len_bytes + sizeof(len));
+        metadata.insert(metadata.end(), vocab[i].begin(), vocab[i].end());
+    }
+    header.num_tensors  = entries.size();
+    header.vocab_offset = sizeof(Header) + entries.size() * sizeof(TensorEntry);
+    header.vocab_bytes  = metadata.size() - entries.size() * sizeof(TensorEntry);
+
+    uint64_t offset = align_up(sizeof(Header) + metadata.size());
+    for (auto &entry : entries) {
+        entry.offset = offset;
+        offset       = align_up(offset + entry.numel * sizeof(float));
+    }
+    header.file_size = offset;
+    std::memcpy(metadata.data(), entries.data(), entries.size() * sizeof(TensorEntry));
+    header.checksum = metadata_checksum(header, metadata.data(), metadata.size());
+
+    // Temp file renamed into place, so a reader never maps a partial pack
+    std::string tmp_path = path + ".tmp." + std::to_string(::getpid());
+    {
+        std::ofstream file(tmp_path, std::ios::binary | std::ios::trunc);
+        if (!file.is_open()) {
+            throw std::runtime_error("Failed to open " + tmp_path);
+        }
+        static const char padding[ALIGNMENT] = {};
+        uint64_t          written            = 0;
+        auto              pad_to             = [&](uint64_t target) {
+            file.write(padding, static_cast<std::streamsize>(target - written));
+            written = target;
+        };
+
+        file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+        file.write(metadata.data(), static_cast<std::streamsize>(metadata.size()));
+        written = sizeof(header) + metadata.size();
+        for (size_t i = 0; i < entries.size(); i++) {
+            pad_to(entries[i].offset);
+            file.write(reinterpret_cast<const char *>(tensors[i]->data()),
+                       static_cast<std::streamsize>(entries[i].numel * sizeof(float)));
+            written += entries[i].numel * sizeof(float);
+        }
+        pad_to(header.file_size);
+        if (!file.good()) {
+            file.close();
+            std::remove(tmp_path.c_str());
+            throw std::runtime_error("Failed to write " + tmp_path);
+        }
+    }
+    std::filesystem::rename(tmp_path, path);
+    return header.file_size;
+}
+
+} // namespace Pack
@@ -1,21 +1,62 @@
 #pragma once
 
 #include <chrono>
+#include <fstream>
+#include <iomanip>
 #include <iostream>
+#include <memory>
+#include <sstream>
 #include <string>
+#include <utility>
 #include <vector>
 
 #include "core/model.hpp"
 #include "core/sampler.hpp"
 #include "core/tokenizer.hpp"
 #include "scheduler/batched_runner.hpp"
+#include "scheduler/disaggregated_runner.hpp"
 #include "scheduler/benchmark.hpp"
+#include "scheduler/load_generator.hpp"
+#include "scheduler/pipeline_runner.hpp"
 #include "scheduler/request.hpp"
+#include "scheduler/replica_pool.hpp"
 #include "scheduler/request_processor.hpp"
 #include "scheduler/scheduler.hpp"
+#include "scheduler/tensor_parallel_runner.hpp"
 #include "utils/json_parser.hpp"
+#include "utils/jsonl.hpp"
 #include "utils/logger.hpp"
 
+// ============================================================================
+// Parallelism - How the engine is spread over the machine's cores
+// ============================================================================
+
+struct ParallelConfig
+{
+    int replicas        = 1; // Data-parallel engines sharing one weight copy
+    int pipeline_stages = 1; // Layer groups, each on its own core group
+    int tensor_parallel = 1; // Processes each holding a shard of every layer
+    int prefill_workers = 0; // Prefill processes feeding a decode-only engine (0 = off)
+
+    bool is_parallel() const
+    {
+        return replicas > 1 || pipeline_stages > 1 || tensor_parallel > 1 || prefill_workers > 0;
+    }
+
+    // Empty if the combination is supported, otherwise the reason
+    std::string validate() const
+    {
+        if (replicas < 1 || pipeline_stages < 1 || tensor_parallel < 1 || prefill_workers < 0) {
+            return "--replicas, --pipeline-stages and --tensor-parallel must be at least 1, "
+                   "--prefill-workers at least 0";
+        }
+        if ((replicas > 1) + (pipeline_stages > 1) + (tensor_parallel > 1) + (prefill_workers > 0) > 1) {
+            return "Only one of --replicas, --pipeline-stages, --tensor-parallel and --prefill-workers can be used";
+        }
+        return "";
+    }
+};
+
 // ============================================================================
 // Single Prompt Mode
 // ============================================================================
@@ -33,14 +74,16 @@ inline int run_single_prompt(LlamaModel        &model,
     LOG_INFO("Encoded prompt into ", tokens.size(), " tokens");
     LOG_INFO("Starting generation with temperature=", temperature, " topp=", top_p, " steps=", steps);
 
+    Logger::flush();
     std::cout << "\n" << prompt;
     std::cout.flush();
 
-    int pos = 0;
-    for (size_t i = 0; i < tokens.size() - 1; i++) {
-        model.forward(tokens[i], pos);
-        pos++;
+    int prefill_len = static_cast<int>(tokens.size()) - 1;
+    int pos         = model.restore_prefix(tokens, prefill_len);
+    for (; pos < prefill_len; pos++) {
+        model.forward(tokens[pos], pos);
     }
+    model.persist_prefix(tokens, prefill_len);
     int token = tokens.back();
 
     auto start = std::chrono::high_resolution_clock::now();
@@ -52,7 +95,7 @@ inline int run_single_prompt(LlamaModel        &model,
         std::cout.flush();
         token = next_token;
         pos++;
-        if (pos >= model.config.max_seq_len)
+        if (model.context_full(pos))
             break;
     }
 
@@ -68,14 +111,21 @@ inline int run_single_prompt(LlamaModel        &model,
 // JSON Benchmark Mode - Sequential
 // ============================================================================
 
-inline int run_json_sequential(LlamaModel &model, Tokenizer &tokenizer, std::vector<Request> &requests)
+inline BenchmarkMetrics run_json_sequential(LlamaModel &model, Tokenizer &tokenizer, std::vector<Request> &requests)
 {
     RequestProcessor processor(model, tokenizer);
     BenchmarkMetrics metrics;
 
     auto total_start = std::chrono::high_resolution_clock::now();
 
+    // Every request is submitted up front; later ones queue behind earlier ones
+    auto arrival = Request::Clock::now();
     for (auto &request : requests) {
+        request.arrival_time = arrival;
+    }
+
+    for (auto &request : requests) {
+        Logger::flush();
         std::cout << "\n--- Request " << request.id << " ---\n";
         std::cout << "Prompt: " << request.prompt.substr(0, 50) << (request.prompt.size() > 50 ? "..." : "") << "\n";
         std::cout << "Output: ";
@@ -90,15 +140,15 @@ inline int run_json_sequential(LlamaModel &model, Tokenizer &tokenizer, std::vec
     auto total_end        = std::chrono::high_resolution_clock::now();
     metrics.total_time_ms = std::chrono::duration<double, std::milli>(total_end - total_start).count();
 
-    metrics.print();
-    return 0;
+    return metrics;
 }
 
 // ============================================================================
 // JSON Benchmark Mode - Batched (Continuous Batching)
 // ============================================================================
 
-inline int run_json_batched(LlamaModel &model, Tokenizer &tokenizer, std::vector<Request> &requests, int max_batch_size)
+inline BenchmarkMetrics
+run_json_batched(LlamaModel &model, Tokenizer &tokenizer, std::vector<Request> &requests, int max_batch_size)
 {
     SchedulerConfig config;
     config.max_batch_size = max_batch_size;
@@ -108,9 +158,301 @@ inline int run_json_batched(LlamaModel &model, Tokenizer &tokenizer, std::vector
 
     LOG_INFO("Running in batched mode with max_batch_size=", max_batch_size);
 
-    BenchmarkMetrics metrics = runner.run_all(requests, scheduler);
+    return runner.run_all(requests, scheduler);
+}
 
-    metrics.print();
+// ============================================================================
+// JSON Benchmark Mode - Data-parallel replicas
+// ============================================================================
+
+inline BenchmarkMetrics run_json_replicated(LlamaModel           &model,
+                                            Tokenizer            &tokenizer,
+                                            std::vector<Request> &requests,
+                                            int                   max_batch_size,
+                                            int                   replicas)
+{
+    SchedulerConfig config;
+    config.max_batch_size = std::max(1, max_batch_size);
+
+    // Offline: every request may be in flight at once
+    ReplicaPool pool(model, tokenizer, replicas, config, static_cast<int>(requests.size()));
+
+    size_t next = 0;
+    return pool.run(
+        [&](Request &request) {
+            if (next == requests.size()) {
+                return false;
+            }
+            request = requests[next++];
+            return true;
+        },
+        [&](const Request &request) { requests[request.id] = request; });
+}
+
+// ============================================================================
+// JSON Benchmark Mode - Layer pipeline
+// ============================================================================
+
+inline BenchmarkMetrics run_json_pipelined(LlamaModel           &model,
+                                           Tokenizer            &tokenizer,
+                                           std::vector<Request> &requests,
+                                           int                   max_batch_size,
+                                           int                   pipeline_stages)
+{
+    PipelineRunner pipeline(model, tokenizer, pipeline_stages, std::max(max_batch_size, pipeline_stages));
+
+    size_t next = 0;
+    return pipeline.run(
+        [&](Request &request) {
+            if (next == requests.size()) {
+                return false;
+            }
+            request = requests[next++];
+            return true;
+        },
+        [&](const Request &request) { requests[request.id] = request; });
+}
+
+// ============================================================================
+// JSON Benchmark Mode - Tensor parallel
+// ============================================================================
+
+inline BenchmarkMetrics run_json_tensor_parallel(LlamaModel           &model,
+                                                 Tokenizer            &tokenizer,
+                                                 std::vector<Request> &requests,
+                                                 int                   tensor_parallel)
+{
+    TensorParallelRunner tp(model, tokenizer, tensor_parallel);
+
+    // Every request is submitted up front, as in sequential mode
+    auto arrival = Request::Clock::now();
+
+    size_t next = 0;
+    return tp.run(
+        [&](Request &request) {
+            if (next == requests.size()) {
+                return false;
+            }
+            request              = requests[next++];
+            request.arrival_time = arrival;
+            return true;
+        },
+        [&](const Request &request) { requests[request.id] = request; });
+}
+
+// ============================================================================
+// JSON Benchmark Mode - Disaggregated prefill/decode
+// ============================================================================
+
+inline BenchmarkMetrics run_json_disaggregated(LlamaModel           &model,
+                                               Tokenizer            &tokenizer,
+                                               std::vector<Request> &requests,
+                                               int                   prefill_workers)
+{
+    DisaggregatedRunner runner(model, tokenizer, prefill_workers);
+
+    // Every request is submitted up front, as in sequential mode
+    auto arrival = Request::Clock::now();
+
+    size_t next = 0;
+    return runner.run(
+        [&](Request &request) {
+            if (next == requests.size()) {
+                return false;
+            }
+            request              = requests[next++];
+            request.arrival_time = arrival;
+            return true;
+        },
+        [&](const Request &request) { requests[request.id] = request; });
+}
+
+// ============================================================================
+// JSON Benchmark Mode - Open-loop (Poisson/gamma or trace-driven arrivals)
+// ============================================================================
+
+inline void print_load_curve(const std::vector<std::pair<std::string, BenchmarkMetrics>> &runs)
+{
+    Logger::flush();
+    std::cout << "\n" << std::left << std::setw(12) << "Arrivals" << std::right;
+    for (const char *col : {"req/s", "tok/s", "goodput", "TTFT p50", "TTFT p99", "TPOT p50", "TPOT p99", "E2E p99"}) {
+        std::cout << std::setw(11) << col;
+    }
+    std::cout << "\n" << std::string(100, '-') << "\n";
+    for (const auto &[label, m] : runs) {
+        std::cout << std::left << std::setw(12) << label << std::right << std::fixed << std::setprecision(2);
+        std::cout << std::setw(11) << m.request_throughput() << std::setw(11) << m.overall_tokens_per_sec();
+        std::cout << std::setw(11) << (m.slo.enabled() ? m.goodput() : m.request_throughput());
+        std::cout << std::setw(11) << m.ttft.percentile_ms(50.0) << std::setw(11) << m.ttft.percentile_ms(99.0);
+        std::cout << std::setw(11) << m.tpot.percentile_ms(50.0) << std::setw(11) << m.tpot.percentile_ms(99.0);
+        std::cout << std::setw(11) << m.e2e_latency.percentile_ms(99.0) << "\n";
+    }
+    std::cout << std::string(100, '-') << "\n";
+}
+
+inline int run_load_benchmark(LlamaModel                  &model,
+                              Tokenizer                   &tokenizer,
+                              const std::vector<Request>  &requests,
+                              const LoadConfig            &load,
+                              const ServiceLevelObjective &slo,
+                              int                          max_batch_size,
+                              const std::string           &metrics_json)
+{
+    std::vector<std::pair<std::string, BenchmarkMetrics>> runs;
+
+    auto run_once = [&](const std::string &label, const std::vector<double> &arrival_offsets_ms) {
+        double span_ms = arrival_offsets_ms.empty() ? 0.0 : arrival_offsets_ms.back();
+        LOG_INFO("Open-loop run (", label, "): ", requests.size(), " requests over ", span_ms, " ms");
+
+        std::vector<Request> run_requests = requests;
+        SchedulerConfig      config;
+        config.max_batch_size = std::max(1, max_batch_size);
+
+        Scheduler     scheduler(config);
+        BatchedRunner runner(model, tokenizer);
+
+        BenchmarkMetrics metrics = runner.run_open_loop(run_requests, arrival_offsets_ms, scheduler, slo);
+        metrics.print();
+        runs.emplace_back(label, std::move(metrics));
+    };
+
+    if (!load.trace_path.empty()) {
+        run_once("trace", LoadGen::load_arrival_trace(load.trace_path, static_cast<int>(requests.size())));
+    }
+    else {
+        for (double rate : load.request_rates) {
+            std::ostringstream label;
+            label << rate << " req/s";
+            run_once(label.str(),
+                     LoadGen::gamma_arrivals(static_cast<int>(requests.size()), rate, load.burstiness, load.seed));
+        }
+    }
+
+    print_load_curve(runs);
+
+    if (!metrics_json.empty()) {
+        std::ofstream file(metrics_json);
+        file << "{\"burstiness\": " << load.burstiness << ", \"runs\": [\n";
+        for (size_t i = 0; i < runs.size(); i++) {
+            file << "{\"arrivals\": \"" << runs[i].first << "\", \"metrics\": " << runs[i].second.to_json() << "}"
+                 << (i + 1 < runs.size() ? "," : "") << "\n";
+        }
+        file << "]}\n";
+        if (!file.good()) {
+            LOG_ERROR("Failed to write metrics JSON: ", metrics_json);
+            return 1;
+        }
+        LOG_INFO("Metrics written to ", metrics_json);
+    }
+
+    LOG_SUCCESS("Load benchmark completed");
+    return 0;
+}
+
+// ============================================================================
+// Offline Batch Mode - Stream JSONL requests in, JSONL completions out
+// ============================================================================
+
+inline int run_jsonl_batch(LlamaModel        &model,
+                           Tokenizer         &tokenizer,
+                           const std::string &input_path,
+                           const std::string &output_path,
+                           int                max_batch_size,
+                           int                max_in_flight,
+                           const std::string &metrics_json = "",
+                           ParallelConfig     parallel     = {})
+{
+    std::unique_ptr<json::JsonlReader> reader;
+    std::unique_ptr<json::JsonlWriter> writer;
+    try {
+        reader = std::make_unique<json::JsonlReader>(input_path);
+        writer = std::make_unique<json::JsonlWriter>(output_path, model.config.eos_token_id);
+    }
+    catch (const std::exception &e) {
+        LOG_ERROR(e.what());
+        return 1;
+    }
+
+    SchedulerConfig config;
+    config.max_batch_size = std::max(1, max_batch_size);
+
+    LOG_INFO("Streaming ",
+             input_path,
+             " -> ",
+             output_path,
+             " (max_batch_size=",
+             config.max_batch_size,
+             ", max_in_flight=",
+             max_in_flight,
+             ")");
+
+    int  num_failed   = 0;
+    auto next_request = [&](Request &request) { return reader->next(request); };
+    auto on_finish    = [&](const Request &request) {
+        num_failed += request.status == RequestStatus::FAILED;
+        writer->write(request);
+    };
+
+    BenchmarkMetrics metrics;
+    if (parallel.replicas > 1) {
+        ReplicaPool pool(model, tokenizer, parallel.replicas, config, max_in_flight);
+        metrics = pool.run(next_request, on_finish);
+    }
+    else if (parallel.pipeline_stages > 1) {
+        // Pipeline slots are the in-flight bound: a request is read only when one frees up
+        PipelineRunner pipeline(
+            model, tokenizer, parallel.pipeline_stages, std::max(config.max_batch_size, parallel.pipeline_stages));
+        metrics = pipeline.run(next_request, on_finish);
+    }
+    else if (parallel.tensor_parallel > 1) {
+        try {
+            TensorParallelRunner tp(model, tokenizer, parallel.tensor_parallel);
+            metrics = tp.run(next_request, on_finish);
+        }
+        catch (const std::exception &e) {
+            LOG_ERROR(e.what());
+            return 1;
+        }
+    }
+    else if (parallel.prefill_workers > 0) {
+        try {
+            DisaggregatedRunner runner(model, tokenizer, parallel.prefill_workers);
+            metrics = runner.run(next_request, on_finish);
+        }
+        catch (const std::exception &e) {
+            LOG_ERROR(e.what());
+            return 1;
+        }
+    }
+    else {
+        Scheduler     scheduler(config);
+        BatchedRunner runner(model, tokenizer);
+        runner.set_stream_output(false);
+        metrics = runner.run_streaming(next_request, on_finish, scheduler, max_in_flight);
+    }
+    writer->flush();
+
+    if (!writer->good()) {
+        LOG_ERROR("Failed to write completions to ", output_path);
+        return 1;
+    }
+    LOG_SUCCESS("Wrote ", writer->num_written(), " completions (", reader->num_skipped(), " input lines skipped)");
+
+    // Keep stdout pure JSONL when completions go there
+    if (output_path != "-") {
+        metrics.print();
+    }
+    if (!metrics_json.empty()) {
+        if (!metrics.write_json(metrics_json)) {
+            LOG_ERROR("Failed to write metrics JSON: ", metrics_json);
+            return 1;
+        }
+        LOG_INFO("Metrics written to ", metrics_json);
+    }
+    if (num_failed > 0) {
+        LOG_ERROR(num_failed, " requests failed (finish_reason \"error\")");
+        return 1;
+    }
     return 0;
 }
 
@@ -118,8 +460,14 @@ inline int run_json_batched(LlamaModel &model, Tokenizer &tokenizer, std::vector
 // JSON Benchmark Mode - Entry Point
 // ============================================================================
 
-inline int
-run_json_benchmark(LlamaModel &model, Tokenizer &tokenizer, const std::string &json_path, int max_batch_size = 1)
+inline int run_json_benchmark(LlamaModel                  &model,
+                              Tokenizer                   &tokenizer,
+                              const std::string           &json_path,
+                              int                          max_batch_size = 1,
+                              const std::string           &metrics_json   = "",
+                              const LoadConfig            &load           = {},
+                              const ServiceLevelObjective &slo            = {},
+                              const ParallelConfig        &parallel       = {})
 {
     std::vector<Request> requests;
     try {
@@ -131,15 +479,55 @@ run_json_benchmark(LlamaModel &model, Tokenizer &tokenizer, const std::string &j
         return 1;
     }
 
-    int result;
-    if (max_batch_size <= 1) {
+    if (load.is_open_loop()) {
+        if (parallel.is_parallel()) {
+            LOG_WARNING("Parallel and disaggregated modes are ignored for open-loop runs");
+        }
+        return run_load_benchmark(model, tokenizer, requests, load, slo, max_batch_size, metrics_json);
+    }
+
+    BenchmarkMetrics metrics;
+    if (parallel.replicas > 1) {
+        metrics = run_json_replicated(model, tokenizer, requests, max_batch_size, parallel.replicas);
+    }
+    else if (parallel.pipeline_stages > 1) {
+        metrics = run_json_pipelined(model, tokenizer, requests, max_batch_size, parallel.pipeline_stages);
+    }
+    else if (parallel.tensor_parallel > 1) {
+        try {
+            metrics = run_json_tensor_parallel(model, tokenizer, requests, parallel.tensor_parallel);
+        }
+        catch (const std::exception &e) {
+            LOG_ERROR(e.what());
+            return 1;
+        }
+    }
+    else if (parallel.prefill_workers > 0) {
+        try {
+            metrics = run_json_disaggregated(model, tokenizer, requests, parallel.prefill_workers);
+        }
+        catch (const std::exception &e) {
+            LOG_ERROR(e.what());
+            return 1;
+        }
+    }
+    else if (max_batch_size <= 1) {
         LOG_INFO("Running in sequential mode");
-        result = run_json_sequential(model, tokenizer, requests);
+        metrics = run_json_sequential(model, tokenizer, requests);
     }
     else {
-        result = run_json_batched(model, tokenizer, requests, max_batch_size);
+        metrics = run_json_batched(model, tokenizer, requests, max_batch_size);
+    }
+
+    metrics.print();
+    if (!metrics_json.empty()) {
+        if (!metrics.write_json(metrics_json)) {
+            LOG_ERROR("Failed to write metrics JSON: ", metrics_json);
+            return 1;
+        }
+        LOG_INFO("Metrics written to ", metrics_json);
     }
 
     LOG_SUCCESS("Benchmark completed");
-    return result;
+    return 0;
 }
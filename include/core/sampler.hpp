@@ -5,6 +5,8 @@
 #include <vector>
 
 #include "ops/activation.hpp"
+#include "ops/logprobs.hpp"
+#include "utils/profiler.hpp"
 
 // ============================================================================
 // Sampler - Temperature and Top-p Sampling
@@ -23,6 +25,8 @@ public:
 
     int sample(float *logits)
     {
+        PROFILE_SCOPE("sampler");
+
         // 1. Temperature
         if (temperature == 0.0f) {
             return std::distance(logits, std::max_element(logits, logits + vocab_size));
@@ -83,9 +87,33 @@ public:
         }
     }
 
+    // sample(), also reporting the sampled token's log-probability and the
+    // top_n most likely tokens. Both come from the model's distribution, i.e.
+    // the raw logits before temperature: one log-sum-exp pass and one partial
+    // selection, no sort. Temperature and top-p then work on a copy, so the
+    // sampled token's logit is still there to read (greedy needs no copy).
+    int sample(float *logits, float &logprob, std::vector<Ops::TokenLogprob> &top, int top_n)
+    {
+        float lse = Ops::log_sum_exp(logits, vocab_size);
+        top.resize(std::max(top_n, 0));
+        top.resize(Ops::top_k_logprobs(top.data(), logits, vocab_size, top_n, lse));
+
+        int token;
+        if (temperature == 0.0f) {
+            token = sample(logits);
+        }
+        else {
+            scratch.assign(logits, logits + vocab_size);
+            token = sample(scratch.data());
+        }
+        logprob = logits[token] - lse;
+        return token;
+    }
+
 private:
-    int          vocab_size;
-    float        temperature;
-    float        topp;
-    std::mt19937 rng;
+    int                vocab_size;
+    float              temperature;
+    float              topp;
+    std::mt19937       rng;
+    std::vector<float> scratch; // Logits copy for sampling with logprobs
 };
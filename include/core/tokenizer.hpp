@@ -4,6 +4,7 @@
 #include <fstream>
 #include <stdexcept>
 #include <string>
+#include <utility>
 #include <vector>
 
 #include "utils/logger.hpp"
@@ -28,6 +29,20 @@ public:
         load(path);
     }
 
+    // From a vocabulary embedded in the model file (GGUF, packed)
+    Tokenizer(std::vector<std::string> pieces, std::vector<float> scores)
+        : vocab_size(static_cast<int>(pieces.size()))
+        , max_token_length(0)
+        , vocab(std::move(pieces))
+        , vocab_scores(std::move(scores))
+    {
+        LOG_INFO("Using the tokenizer embedded in the model (", vocab_size, " tokens)");
+        for (const auto &piece : vocab) {
+            max_token_length = std::max(max_token_length, static_cast<int>(piece.size()));
+        }
+        build_sorted_vocab();
+    }
+
     void load(const std::string &path)
     {
         LOG_INFO("Loading tokenizer: ", path);
@@ -53,13 +68,12 @@ public:
             vocab[i] = word;
         }
 
-        // Build sorted vocab for fast lookup
-        for (int i = 0; i < vocab_size; i++) {
-            sorted_vocab.push_back({vocab[i], i});
-        }
-        std::sort(sorted_vocab.begin(), sorted_vocab.end());
+        build_sorted_vocab();
     }
 
+    const std::vector<std::string> &pieces() const { return vocab; }
+    const std::vector<float>       &scores() const { return vocab_scores; }
+
     std::string decode(int token) const
     {
         if (token < 0 || token >= vocab_size)
@@ -137,6 +151,15 @@ private:
     std::vector<float>       vocab_scores;
     std::vector<TokenIndex>  sorted_vocab;
 
+    // Sorted vocab for fast lookup
+    void build_sorted_vocab()
+    {
+        for (int i = 0; i < vocab_size; i++) {
+            sorted_vocab.push_back({vocab[i], i});
+        }
+        std::sort(sorted_vocab.begin(), sorted_vocab.end());
+    }
+
     int str_lookup(const std::string &str) const
     {
         TokenIndex query = {str, 0};
@@ -0,0 +1,209 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+// ============================================================================
+// Llama Model Configuration & Weights
+// ============================================================================
+
+struct Config
+{
+    int dim;         // Transformer dimension
+    int hidden_dim;  // FFN hidden dimension
+    int n_layers;    // Number of layers
+    int n_heads;     // Number of query heads
+    int n_kv_heads;  // Number of key/value heads (can be < n_heads for GQA)
+    int vocab_size;  // Vocabulary size
+    int max_seq_len; // Maximum sequence length
+
+    // PagedAttention configuration
+    bool use_paged_attention = false; // Enable/disable PagedAttention
+    int  block_size          = 16;    // Block size for PagedAttention (in tokens)
+    int  num_blocks          = 256;   // Total number of physical blocks
+
+    // Sliding-window attention: attend to the last sliding_window tokens only
+    // (0 = full context)
+    int sliding_window = 0;
+
+    // StreamingLLM attention sinks: the first attention_sinks tokens stay
+    // attended next to the window (0 = none, needs PagedAttention)
+    int attention_sinks = 0;
+
+    // LoRA: largest adapter rank served (0 = no adapters)
+    int max_lora_rank = 0;
+
+    // Derived/Constants
+    int   head_dim;
+    float rope_theta   = 10000.0f;
+    int   eos_token_id = 2; // From the model metadata when the format has it
+};
+
+// A read-only float tensor. It either owns its values or views values mapped
+// in place from a model file; a view holds a reference on the mapping, so it
+// stays valid however long the file loader lives. Copying always produces an
+// owned tensor, so a copy (e.g. a pipeline stage placing its layers on its
+// own NUMA node) never aliases the file.
+class Tensor
+{
+public:
+    Tensor() = default;
+
+    Tensor(std::vector<float> values)
+        : owned_(std::move(values))
+    {
+        reset_view();
+    }
+
+    // View size floats at data, kept alive by mapping
+    static Tensor view(const float *data, size_t size, std::shared_ptr<const void> mapping)
+    {
+        Tensor t;
+        t.data_    = data;
+        t.size_    = size;
+        t.mapping_ = std::move(mapping);
+        return t;
+    }
+
+    Tensor(const Tensor &other)
+        : owned_(other.begin(), other.end())
+    {
+        reset_view();
+    }
+
+    Tensor(Tensor &&other) noexcept
+        : owned_(std::move(other.owned_))
+        , data_(other.data_)
+        , size_(other.size_)
+        , mapping_(std::move(other.mapping_))
+    {
+        other.data_ = nullptr;
+        other.size_ = 0;
+    }
+
+    Tensor &operator=(const Tensor &other)
+    {
+        if (this != &other) {
+            owned_.assign(other.begin(), other.end());
+            mapping_.reset();
+            reset_view();
+        }
+        return *this;
+    }
+
+    Tensor &operator=(Tensor &&other) noexcept
+    {
+        owned_      = std::move(other.owned_);
+        data_       = other.data_;
+        size_       = other.size_;
+        mapping_    = std::move(other.mapping_);
+        other.data_ = nullptr;
+        other.size_ = 0;
+        return *this;
+    }
+
+    const float *data() const { return data_; }
+    size_t       size() const { return size_; }
+    bool         empty() const { return size_ == 0; }
+    const float *begin() const { return data_; }
+    const float *end() const { return data_ + size_; }
+
+    // True if the values live in a mapped model file rather than on the heap
+    bool mapped() const { return mapping_ != nullptr; }
+
+    // Another view of the same values: free for a mapped tensor, a copy otherwise
+    Tensor share() const { return mapped() ? view(data_, size_, mapping_) : Tensor(*this); }
+
+private:
+    std::vector<float>          owned_;
+    const float                *data_ = nullptr;
+    size_t                      size_ = 0;
+    std::shared_ptr<const void> mapping_;
+
+    void reset_view()
+    {
+        data_ = owned_.data();
+        size_ = owned_.size();
+    }
+};
+
+// Holds the weights of the model. Tensors are mapped in place from the model
+// file where the on-disk layout allows it and converted to owned f32 arrays
+// otherwise. Once loaded the weights are read-only and shared (via
+// shared_ptr) by every replica of the model.
+struct TransformerWeights
+{
+    // Embedding
+    Tensor token_embedding_table; // [vocab_size, dim]
+
+    // Layers
+    struct Layer
+    {
+        Tensor rms_att_weight; // [dim]
+        Tensor wq;             // [dim, n_heads * head_dim]
+        Tensor wk;             // [dim, n_kv_heads * head_dim]
+        Tensor wv;             // [dim, n_kv_heads * head_dim]
+        Tensor wo;             // [n_heads * head_dim, dim]
+        Tensor rms_ffn_weight; // [dim]
+        Tensor w_gate;         // [dim, hidden_dim]
+        Tensor w_up;           // [dim, hidden_dim]
+        Tensor w_down;         // [hidden_dim, dim]
+    };
+
+    std::vector<Layer> layers;
+
+    // Final RMSNorm
+    Tensor rms_final_weight; // [dim]
+
+    // Output Head (optional if shared)
+    Tensor lm_head; // [vocab_size, dim]
+    bool   weights_shared = false;
+
+    enum Role { EMBED, RMS_ATT, WQ, WK, WV, WO, RMS_FFN, W_GATE, W_UP, W_DOWN, RMS_FINAL, LM_HEAD };
+
+    // Canonical (Meta checkpoint) name of a tensor, e.g. "layers.3.wq"
+    static std::string tensor_name(Role role, int layer)
+    {
+        static const char *names[] = {"tok_embeddings",
+                                      "attention_norm",
+                                      "wq",
+                                      "wk",
+                                      "wv",
+                                      "wo",
+                                      "ffn_norm",
+                                      "w1",
+                                      "w3",
+                                      "w2",
+                                      "norm",
+                                      "output"};
+        if (role == EMBED || role == RMS_FINAL || role == LM_HEAD) {
+            return names[role];
+        }
+        return "layers." + std::to_string(layer) + "." + names[role];
+    }
+
+    // fn(role, layer, tensor) for every tensor; lm_head is skipped if shared
+    template <typename Fn> void for_each_tensor(Fn &&fn) const
+    {
+        fn(EMBED, 0, token_embedding_table);
+        for (int i = 0; i < static_cast<int>(layers.size()); i++) {
+            const Layer &l = layers[i];
+            fn(RMS_ATT, i, l.rms_att_weight);
+            fn(WQ, i, l.wq);
+            fn(WK, i, l.wk);
+            fn(WV, i, l.wv);
+            fn(WO, i, l.wo);
+            fn(RMS_FFN, i, l.rms_ffn_weight);
+            fn(W_GATE, i, l.w_gate);
+            fn(W_UP, i, l.w_up);
+            fn(W_DOWN, i, l.w_down);
+        }
+        fn(RMS_FINAL, 0, rms_final_weight);
+        if (!weights_shared) {
+            fn(LM_HEAD, 0, lm_head);
+        }
+    }
+};
@@ -21,4 +21,39 @@ inline void matmul(float *out, const float *in, const float *weight, int in_dim,
     }
 }
 
+// Matrix Multiplication with the residual add as its epilogue
+// out[i] += dot(in, weight[i]), so the projection never round-trips through
+// a scratch buffer before being added to the residual stream
+inline void matmul_residual(float *out, const float *in, const float *weight, int in_dim, int out_dim)
+{
+    for (int i = 0; i < out_dim; i++) {
+        float        val   = 0.0f;
+        const float *w_row = weight + i * in_dim;
+        for (int j = 0; j < in_dim; j++) {
+            val += in[j] * w_row[j];
+        }
+        out[i] += val;
+    }
+}
+
+// LoRA update of a projection: out += scale * B (A in), with A [rank, in_dim]
+// and B [out_dim, rank]. The low-rank product goes through buf [rank], so the
+// update costs rank * (in_dim + out_dim) instead of a dense in_dim * out_dim.
+inline void lora(float       *out,
+                 const float *in,
+                 const float *a,
+                 const float *b,
+                 float       *buf,
+                 int          in_dim,
+                 int          rank,
+                 int          out_dim,
+                 float        scale)
+{
+    matmul(buf, in, a, in_dim, rank);
+    for (int r = 0; r < rank; r++) {
+        buf[r] *= scale;
+    }
+    matmul_residual(out, buf, b, rank, out_dim);
+}
+
 } // namespace Ops
@@ -0,0 +1,66 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+
+// ============================================================================
+// Log-probabilities - log_softmax read off the logits without materializing it
+//
+// log_softmax(x)[i] = x[i] - log_sum_exp(x). log_sum_exp is one pass for the
+// max and one for the sum of exponentials, both branch-free reductions that
+// vectorize, and it leaves the logits untouched: any number of
+// log-probabilities then costs one subtraction each, and a sampler can still
+// use the same row afterwards. top_k_logprobs finds the best k in a single
+// scan with a small sorted buffer instead of sorting the vocabulary.
+// ============================================================================
+
+namespace Ops {
+
+struct TokenLogprob
+{
+    int   token;
+    float logprob;
+};
+
+// log(sum(exp(x)))
+inline float log_sum_exp(const float *x, int size)
+{
+    float max_val = x[0];
+    for (int i = 1; i < size; i++) {
+        max_val = std::max(max_val, x[i]);
+    }
+
+    float sum = 0.0f;
+    for (int i = 0; i < size; i++) {
+        sum += expf(x[i] - max_val);
+    }
+    return max_val + logf(sum);
+}
+
+// The k largest entries of x as log-probabilities (lse = log_sum_exp(x)),
+// largest first and lower token first on ties. Returns min(k, size).
+inline int top_k_logprobs(TokenLogprob *top, const float *x, int size, int k, float lse)
+{
+    k = std::min(k, size);
+    if (k <= 0) {
+        return 0;
+    }
+    int n = 0;
+    for (int i = 0; i < size; i++) {
+        if (n == k && x[i] <= top[k - 1].logprob) {
+            continue;
+        }
+        int j = n < k ? n++ : k - 1;
+        while (j > 0 && top[j - 1].logprob < x[i]) {
+            top[j] = top[j - 1];
+            j--;
+        }
+        top[j] = {i, x[i]};
+    }
+    for (int j = 0; j < n; j++) {
+        top[j].logprob -= lse;
+    }
+    return n;
+}
+
+} // namespace Ops
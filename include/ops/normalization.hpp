@@ -8,15 +8,26 @@
 
 namespace Ops {
 
-// RMS Normalization
-// Normalizes input using Root Mean Square
-inline void rms_norm(float *out, const float *in, const float *weight, int size, float eps = 1e-5f)
+// Inverse RMS of the input, the per-row factor of rms_norm
+inline float rms_scale(const float *in, int size, float eps = 1e-5f)
 {
     float sum = 0.0f;
     for (int i = 0; i < size; i++) {
         sum += in[i] * in[i];
     }
-    float rms = 1.0f / sqrtf(sum / size + eps);
+    return 1.0f / sqrtf(sum / size + eps);
+}
+
+// RMS Normalization
+// Normalizes input using Root Mean Square
+// SIZE > 0 fixes size at compile time (see KernelTable)
+template <int SIZE = 0>
+inline void rms_norm(float *out, const float *in, const float *weight, int size, float eps = 1e-5f)
+{
+    if constexpr (SIZE > 0) {
+        size = SIZE;
+    }
+    float rms = rms_scale(in, size, eps);
     for (int i = 0; i < size; i++) {
         out[i] = in[i] * rms * weight[i];
     }
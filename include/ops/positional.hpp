@@ -10,8 +10,13 @@ namespace Ops {
 
 // Rotary Position Embedding (RoPE)
 // Apply rotary embeddings to query and key tensors
+// HEAD_DIM > 0 fixes head_dim at compile time (see KernelTable)
+template <int HEAD_DIM = 0>
 inline void apply_rope(float *q, float *k, int pos, int head_dim, int n_heads, int n_kv_heads, float theta)
 {
+    if constexpr (HEAD_DIM > 0) {
+        head_dim = HEAD_DIM;
+    }
     for (int i = 0; i < head_dim; i += 2) {
         float freq = 1.0f / powf(theta, (float)i / head_dim);
         float val  = pos * freq;
@@ -1,8 +1,10 @@
 #pragma once
 
 #include <chrono>
+#include <functional>
 #include <iostream>
 #include <memory>
+#include <thread>
 #include <unordered_map>
 #include <vector>
 
@@ -10,9 +12,11 @@
 #include "core/sampler.hpp"
 #include "core/tokenizer.hpp"
 #include "scheduler/benchmark.hpp"
+#include "scheduler/load_generator.hpp"
 #include "scheduler/request.hpp"
 #include "scheduler/scheduler.hpp"
 #include "utils/logger.hpp"
+#include "utils/profiler.hpp"
 
 // ============================================================================
 // Batched Runner - Scheduling Simulation
@@ -47,13 +51,7 @@ public:
 
         // Encode all prompts
         for (auto &req : requests) {
-            req.prompt_tokens = tokenizer_.encode(req.prompt, true, false);
-            // Pre-create sampler for each request (P1 fix)
-            samplers_[req.id] = std::make_unique<Sampler>(model_.config.vocab_size,
-                                                          req.sampling_params.temperature,
-                                                          req.sampling_params.top_p,
-                                                          static_cast<unsigned long long>(std::time(nullptr)) + req.id);
-            scheduler.add_request(&req);
+            admit(req, scheduler);
         }
 
         auto total_start = std::chrono::high_resolution_clock::now();
@@ -61,62 +59,256 @@ public:
         // Process requests one at a time (sequential execution)
         int iteration = 0;
         while (scheduler.has_work()) {
-            ScheduledBatch batch = scheduler.schedule();
-
-            if (batch.empty()) {
+            if (!step(scheduler, iteration)) {
                 break;
             }
+            iteration++;
+        }
 
-            LOG_INFO("Iteration ",
-                     iteration,
-                     ": ",
-                     batch.prefill_requests.size(),
-                     " prefill, ",
-                     batch.decode_requests.size(),
-                     " decode (simulated)");
+        auto total_end        = std::chrono::high_resolution_clock::now();
+        metrics.total_time_ms = std::chrono::duration<double, std::milli>(total_end - total_start).count();
 
-            // Process prefill requests completely (prefill + all decode)
-            for (auto *req : batch.prefill_requests) {
-                process_request_complete(req);
-                scheduler.finish_request(req);
+        // Collect metrics (a failed request never ran to completion)
+        for (const auto &req : requests) {
+            if (req.status == RequestStatus::FINISHED) {
+                metrics.add_request(req);
             }
+        }
 
-            // Decode requests should be empty in this simulation
-            // (we complete each request fully before moving to next)
+        // Cleanup samplers
+        samplers_.clear();
 
-            iteration++;
+        return metrics;
+    }
+
+    // Run requests open-loop: request i is submitted arrival_offsets_ms[i] after
+    // the start, whether or not the engine has caught up with earlier ones.
+    BenchmarkMetrics run_open_loop(std::vector<Request>        &requests,
+                                   const std::vector<double>   &arrival_offsets_ms,
+                                   Scheduler                   &scheduler,
+                                   const ServiceLevelObjective &slo = {})
+    {
+        BenchmarkMetrics metrics;
+        metrics.slo = slo;
+
+        std::vector<size_t> order(requests.size());
+        for (size_t i = 0; i < order.size(); i++) {
+            order[i] = i;
         }
+        std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+            return arrival_offsets_ms[a] < arrival_offsets_ms[b];
+        });
+
+        auto start        = Request::Clock::now();
+        auto arrival_time = [&](size_t idx) {
+            return start
+                 + std::chrono::duration_cast<Request::Clock::duration>(
+                       std::chrono::duration<double, std::milli>(arrival_offsets_ms[idx]));
+        };
+
+        size_t next      = 0;
+        int    iteration = 0;
+        while (next < order.size() || scheduler.has_work()) {
+            // Submit everything whose arrival time has passed, stamped with the
+            // intended arrival so queueing delay includes time spent waiting on us
+            auto now = Request::Clock::now();
+            while (next < order.size() && arrival_time(order[next]) <= now) {
+                Request &req     = requests[order[next]];
+                req.arrival_time = arrival_time(order[next]);
+                admit(req, scheduler);
+                next++;
+            }
 
-        auto total_end        = std::chrono::high_resolution_clock::now();
-        metrics.total_time_ms = std::chrono::duration<double, std::milli>(total_end - total_start).count();
+            if (!scheduler.has_work()) {
+                std::this_thread::sleep_until(arrival_time(order[next]));
+                continue;
+            }
+
+            if (!step(scheduler, iteration)) {
+                if (next == order.size()) {
+                    break;
+                }
+                std::this_thread::sleep_until(arrival_time(order[next]));
+                continue;
+            }
+            iteration++;
+        }
 
-        // Collect metrics
+        metrics.total_time_ms = std::chrono::duration<double, std::milli>(Request::Clock::now() - start).count();
         for (const auto &req : requests) {
-            metrics.add_request(req);
+            if (req.status == RequestStatus::FINISHED) {
+                metrics.add_request(req);
+            }
+        }
+        if (metrics.total_requests < static_cast<int>(requests.size())) {
+            LOG_WARNING(static_cast<int>(requests.size()) - metrics.total_requests,
+                        " of ",
+                        requests.size(),
+                        " requests failed and are left out of the metrics");
         }
 
-        // Cleanup samplers
         samplers_.clear();
+        return metrics;
+    }
+
+    // Run requests pulled from next_request (which returns false once the input
+    // is exhausted), keeping at most max_in_flight admitted but unfinished.
+    // Each request is passed to on_finish as soon as it completes and is then
+    // released, so memory stays constant however many requests go through.
+    BenchmarkMetrics run_streaming(const std::function<bool(Request &)>       &next_request,
+                                   const std::function<void(const Request &)> &on_finish,
+                                   Scheduler                                  &scheduler,
+                                   int                                         max_in_flight)
+    {
+        BenchmarkMetrics metrics;
 
+        std::unordered_map<int, std::unique_ptr<Request>> in_flight;
+        std::vector<Request *>                            finished;
+        bool                                              exhausted = false;
+
+        auto start     = std::chrono::high_resolution_clock::now();
+        int  iteration = 0;
+        while (true) {
+            // Backpressure: only read more input while there is room in flight
+            while (!exhausted && static_cast<int>(in_flight.size()) < std::max(1, max_in_flight)) {
+                auto req = std::make_unique<Request>();
+                if (!next_request(*req)) {
+                    exhausted = true;
+                    break;
+                }
+                if (!admit(*req, scheduler)) {
+                    on_finish(*req);
+                    continue;
+                }
+                int id = req->id;
+                in_flight.emplace(id, std::move(req));
+            }
+
+            if (!scheduler.has_work()) {
+                if (exhausted) {
+                    break;
+                }
+                continue;
+            }
+
+            finished.clear();
+            if (!step(scheduler, iteration, &finished)) {
+                LOG_ERROR("Scheduler made no progress with ", in_flight.size(), " requests in flight");
+                break;
+            }
+            iteration++;
+
+            for (Request *req : finished) {
+                metrics.add_request(*req);
+                on_finish(*req);
+                release(*req);
+                in_flight.erase(req->id);
+            }
+        }
+
+        auto end              = std::chrono::high_resolution_clock::now();
+        metrics.total_time_ms = std::chrono::duration<double, std::milli>(end - start).count();
         return metrics;
     }
 
+    // Echo generated tokens to stdout as they are produced (default on)
+    void set_stream_output(bool enabled) { stream_output_ = enabled; }
+
+    // Encode a request's prompt, create its sampler and queue it. A request
+    // the scheduler can never fit is marked FAILED instead and false returned;
+    // the caller then treats it as finished.
+    bool admit(Request &req, Scheduler &scheduler)
+    {
+        req.prompt_tokens = tokenizer_.encode(req.prompt, true, false);
+        if (!scheduler.fits(req)) {
+            LOG_ERROR("Request ",
+                      req.id,
+                      ": prompt of ",
+                      req.num_prompt_tokens(),
+                      " tokens exceeds the batch budget of ",
+                      scheduler.max_tokens_per_batch());
+            req.status = RequestStatus::FAILED;
+            return false;
+        }
+        // Pre-create sampler for each request (P1 fix)
+        samplers_[req.id] = std::make_unique<Sampler>(model_.config.vocab_size,
+                                                      req.sampling_params.temperature,
+                                                      req.sampling_params.top_p,
+                                                      static_cast<unsigned long long>(std::time(nullptr)) + req.id);
+        scheduler.add_request(&req);
+        return true;
+    }
+
+    // Run one scheduling iteration. Returns false if nothing could be scheduled.
+    // Requests completed in this iteration are appended to finished, if given.
+    bool step(Scheduler &scheduler, int iteration, std::vector<Request *> *finished = nullptr)
+    {
+        PROFILE_SCOPE("scheduler.step");
+        ScheduledBatch batch = scheduler.schedule();
+
+        if (batch.empty()) {
+            return false;
+        }
+        EngineMetrics::instance().batch_size.observe(batch.total_requests());
+
+        LOG_INFO("Iteration ",
+                 iteration,
+                 ": ",
+                 batch.prefill_requests.size(),
+                 " prefill, ",
+                 batch.decode_requests.size(),
+                 " decode (simulated)");
+
+        // Process prefill requests completely (prefill + all decode)
+        for (auto *req : batch.prefill_requests) {
+            // A failure (e.g. KV blocks exhausted) fails this request, not the engine
+            try {
+                process_request_complete(req);
+            }
+            catch (const std::exception &e) {
+                LOG_ERROR("Request ", req->id, " failed: ", e.what());
+                req->status = RequestStatus::FAILED;
+            }
+            scheduler.finish_request(req);
+            if (finished) {
+                finished->push_back(req);
+            }
+        }
+
+        // Decode requests should be empty in this simulation
+        // (we complete each request fully before moving to next)
+        return true;
+    }
+
+    // Drop per-request state once a finished request has been handed off
+    void release(const Request &req) { samplers_.erase(req.id); }
+
 private:
     // Process a single request completely (prefill + all decode steps)
     void process_request_complete(Request *req)
     {
         // Reset state only once per request (P0 fix)
         reset_model_state();
+        try {
+            model_.use_adapter(req->adapter);
+        }
+        catch (const std::exception &e) {
+            LOG_ERROR("Request ", req->id, ": ", e.what());
+            req->status = RequestStatus::FAILED;
+            return;
+        }
 
         // Prefill phase
         auto prefill_start = std::chrono::high_resolution_clock::now();
 
-        int pos = 0;
-        for (size_t i = 0; i < req->prompt_tokens.size() - 1; i++) {
-            model_.forward(req->prompt_tokens[i], pos);
-            pos++;
+        int prefill_len = req->num_prompt_tokens() - 1;
+        int pos         = model_.restore_prefix(req->prompt_tokens, prefill_len);
+        for (; pos < prefill_len; pos++) {
+            model_.forward(req->prompt_tokens[pos], pos);
         }
+        model_.persist_prefix(req->prompt_tokens, prefill_len);
         req->current_pos = pos;
+        EngineMetrics::instance().prompt_tokens.inc(req->num_prompt_tokens());
 
         auto prefill_end     = std::chrono::high_resolution_clock::now();
         req->prefill_time_ms = std::chrono::duration<double, std::milli>(prefill_end - prefill_start).count();
@@ -125,7 +317,10 @@ private:
 
         // Decode phase
         req->status = RequestStatus::DECODING;
-        std::cout << "\n[" << req->id << "] ";
+        if (stream_output_) {
+            Logger::flush();
+            std::cout << "\n[" << req->id << "] ";
+        }
 
         auto decode_start = std::chrono::high_resolution_clock::now();
 
@@ -135,31 +330,36 @@ private:
         while (req->can_generate_more()) {
             model_.forward(token, req->current_pos);
 
-            int next_token = sampler->second->sample(model_.state.logits.data());
-            req->generated_tokens.push_back(next_token);
+            int next_token = sample_next_token(*sampler->second, model_.state.logits.data(), *req);
+            EngineMetrics::instance().generation_tokens.inc();
 
             std::string piece = tokenizer_.decode(next_token);
             req->output_text += piece;
-            std::cout << piece;
-            std::cout.flush();
+            if (stream_output_) {
+                std::cout << piece;
+                std::cout.flush();
+            }
 
             token = next_token;
             req->current_pos++;
 
             // Check termination (P1 fix: use config instead of hardcoded 2)
-            if (next_token == 2) { // TODO: model_.config.eos_token_id when available
+            if (next_token == model_.config.eos_token_id) {
                 break;
             }
-            if (req->current_pos >= model_.config.max_seq_len) {
+            if (model_.context_full(req->current_pos)) {
                 break;
             }
         }
 
-        std::cout << "\n";
+        if (stream_output_) {
+            std::cout << "\n";
+        }
 
         auto decode_end     = std::chrono::high_resolution_clock::now();
         req->decode_time_ms = std::chrono::duration<double, std::milli>(decode_end - decode_start).count();
         req->status         = RequestStatus::FINISHED;
+        EngineMetrics::instance().observe_finished(*req);
 
         LOG_INFO("Request ", req->id, " decode: ", req->num_generated_tokens(), " tokens, ", req->decode_time_ms, "ms");
     }
@@ -177,6 +377,7 @@ private:
 
     LlamaModel &model_;
     Tokenizer  &tokenizer_;
+    bool        stream_output_ = true;
 
     // Per-request samplers (P1 fix: avoid recreation every step)
     std::unordered_map<int, std::unique_ptr<Sampler>> samplers_;
@@ -1,7 +1,16 @@
 #pragma once
 
+#include <fstream>
 #include <iomanip>
 #include <iostream>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "scheduler/load_generator.hpp"
+#include "utils/histogram.hpp"
+#include "utils/logger.hpp"
 
 // ============================================================================
 // Benchmark Metrics - Performance measurement for request processing
@@ -16,6 +25,20 @@ struct BenchmarkMetrics
     double total_decode_time_ms   = 0.0;
     double total_time_ms          = 0.0;
 
+    // Latency distributions (milliseconds)
+    LatencyHistogram ttft;                // Arrival -> first generated token
+    LatencyHistogram tpot;                // Mean time per output token after the first, per request
+    LatencyHistogram inter_token_latency; // Gap between consecutive tokens
+    LatencyHistogram queueing_delay;      // Arrival -> first scheduled
+    LatencyHistogram e2e_latency;         // Arrival -> last generated token
+
+    // Goodput: requests that met the SLO (only counted when one is set)
+    ServiceLevelObjective slo;
+    int                   slo_met_requests = 0;
+
+    double request_throughput() const { return total_time_ms > 0 ? (total_requests * 1000.0 / total_time_ms) : 0.0; }
+    double goodput() const { return total_time_ms > 0 ? (slo_met_requests * 1000.0 / total_time_ms) : 0.0; }
+
     double prefill_tokens_per_sec() const
     {
         return total_prefill_time_ms > 0 ? (total_prompt_tokens * 1000.0 / total_prefill_time_ms) : 0.0;
@@ -34,6 +57,7 @@ struct BenchmarkMetrics
 
     void print() const
     {
+        Logger::flush();
         std::cout << "\n========================================\n";
         std::cout << "         BENCHMARK RESULTS\n";
         std::cout << "========================================\n";
@@ -49,8 +73,109 @@ struct BenchmarkMetrics
         std::cout << "Prefill throughput:     " << prefill_tokens_per_sec() << " tokens/sec\n";
         std::cout << "Decode throughput:      " << decode_tokens_per_sec() << " tokens/sec\n";
         std::cout << "Overall throughput:     " << overall_tokens_per_sec() << " tokens/sec\n";
+        std::cout << "Request throughput:     " << request_throughput() << " requests/sec\n";
+        if (slo.enabled()) {
+            std::cout << "Goodput:                " << goodput() << " requests/sec (" << slo_met_requests << "/"
+                      << total_requests << " met SLO)\n";
+        }
         std::cout << "========================================\n";
+        print_latency();
+    }
+
+    void print_latency() const
+    {
+        Logger::flush();
+        std::cout << "\n" << std::left << std::setw(18) << "Latency (ms)" << std::right;
+        for (const char *col : {"mean", "p50", "p90", "p99", "p99.9", "max"}) {
+            std::cout << std::setw(10) << col;
+        }
+        std::cout << "\n" << std::string(78, '-') << "\n";
+        for (const auto &[name, hist] : latency_series()) {
+            std::cout << std::left << std::setw(18) << name << std::right << std::fixed << std::setprecision(2);
+            std::cout << std::setw(10) << hist->mean_ms();
+            for (double p : PERCENTILES) {
+                std::cout << std::setw(10) << hist->percentile_ms(p);
+            }
+            std::cout << std::setw(10) << hist->max_ms() << "\n";
+        }
+        std::cout << std::string(78, '-') << "\n";
+    }
+
+    // Machine-readable summary for regression tracking
+    std::string to_json() const
+    {
+        std::ostringstream oss;
+        oss << std::fixed << std::setprecision(4);
+        oss << "{\n";
+        oss << "  \"total_requests\": " << total_requests << ",\n";
+        oss << "  \"total_prompt_tokens\": " << total_prompt_tokens << ",\n";
+        oss << "  \"total_generated_tokens\": " << total_generated_tokens << ",\n";
+        oss << "  \"total_prefill_time_ms\": " << total_prefill_time_ms << ",\n";
+        oss << "  \"total_decode_time_ms\": " << total_decode_time_ms << ",\n";
+        oss << "  \"total_time_ms\": " << total_time_ms << ",\n";
+        oss << "  \"prefill_tokens_per_sec\": " << prefill_tokens_per_sec() << ",\n";
+        oss << "  \"decode_tokens_per_sec\": " << decode_tokens_per_sec() << ",\n";
+        oss << "  \"overall_tokens_per_sec\": " << overall_tokens_per_sec() << ",\n";
+        oss << "  \"request_throughput\": " << request_throughput() << ",\n";
+        if (slo.enabled()) {
+            oss << "  \"slo\": {\"ttft_ms\": " << slo.ttft_ms << ", \"tpot_ms\": " << slo.tpot_ms << "},\n";
+            oss << "  \"slo_met_requests\": " << slo_met_requests << ",\n";
+            oss << "  \"goodput\": " << goodput() << ",\n";
+        }
+        oss << "  \"latency_ms\": {\n";
+
+        auto series = latency_series();
+        for (size_t i = 0; i < series.size(); i++) {
+            const auto &[name, hist] = series[i];
+            oss << "    \"" << name << "\": {\"count\": " << hist->count() << ", \"mean\": " << hist->mean_ms();
+            oss << ", \"p50\": " << hist->percentile_ms(50.0) << ", \"p90\": " << hist->percentile_ms(90.0);
+            oss << ", \"p99\": " << hist->percentile_ms(99.0) << ", \"p99_9\": " << hist->percentile_ms(99.9);
+            oss << ", \"max\": " << hist->max_ms() << "}" << (i + 1 < series.size() ? "," : "") << "\n";
+        }
+        oss << "  }\n";
+        oss << "}\n";
+        return oss.str();
+    }
+
+    bool write_json(const std::string &path) const
+    {
+        std::ofstream file(path);
+        if (!file.is_open()) {
+            return false;
+        }
+        file << to_json();
+        return file.good();
     }
 
     void add_request(const struct Request &request);
+
+    // Fold in another engine's per-request totals and latencies. total_time_ms
+    // is left alone: for engines running concurrently it is the caller's wall clock.
+    void merge(const BenchmarkMetrics &other)
+    {
+        total_requests += other.total_requests;
+        total_prompt_tokens += other.total_prompt_tokens;
+        total_generated_tokens += other.total_generated_tokens;
+        total_prefill_time_ms += other.total_prefill_time_ms;
+        total_decode_time_ms += other.total_decode_time_ms;
+        slo_met_requests += other.slo_met_requests;
+
+        ttft.merge(other.ttft);
+        tpot.merge(other.tpot);
+        inter_token_latency.merge(other.inter_token_latency);
+        queueing_delay.merge(other.queueing_delay);
+        e2e_latency.merge(other.e2e_latency);
+    }
+
+private:
+    static constexpr double PERCENTILES[] = {50.0, 90.0, 99.0, 99.9};
+
+    std::vector<std::pair<const char *, const LatencyHistogram *>> latency_series() const
+    {
+        return {{"ttft", &ttft},
+                {"tpot", &tpot},
+                {"inter_token", &inter_token_latency},
+                {"queueing_delay", &queueing_delay},
+                {"e2e", &e2e_latency}};
+    }
 };
@@ -100,8 +100,7 @@ public:
         }
     }
 
-    // TODO: Expose metrics for monitoring (KV cache stats, memory pressure, etc.)
-    // Similar to vLLM's KV cache activation and hit rate logging
+    // KV cache usage is exported for monitoring by EngineMetrics (see LlamaModel)
 
     // Get number of free blocks
     int get_num_free_blocks() const { return num_free_blocks_; }
@@ -167,7 +166,7 @@ public:
             free_block_internal(block_id);
         }
         request_blocks_.erase(it);
-        LOG_INFO("Freed all blocks for request ", request_id);
+        LOG_DEBUG("Freed all blocks for request ", request_id);
     }
 
     // Get blocks allocated to a request
@@ -0,0 +1,367 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <signal.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#ifdef __linux__
+#include <sys/prctl.h>
+#endif
+
+#include "core/model.hpp"
+#include "core/sampler.hpp"
+#include "core/tokenizer.hpp"
+#include "scheduler/benchmark.hpp"
+#include "scheduler/engine_metrics.hpp"
+#include "scheduler/kv_transfer.hpp"
+#include "scheduler/request.hpp"
+#include "utils/affinity.hpp"
+#include "utils/logger.hpp"
+#include "utils/profiler.hpp"
+
+// ============================================================================
+// Disaggregated Runner - Separate prefill and decode processes
+//
+// Even with chunking, a long prefill on the engine thread stalls every
+// sequence waiting for its next token. Here the calling process only
+// decodes; prompts are prefilled by N worker processes forked from it, each
+// pinned to its own core group and running its own engine (its own RunState,
+// KV pool and, if configured, prefix KV disk store) over the same weights,
+// which fork() shares copy-on-write.
+//
+// Requests move through a KVTransferChannel with two slots per worker, so a
+// worker can prefill the next prompt while the decode process adopts the
+// previous one: the decode side allocates blocks from its own BlockManager,
+// copies the transferred KV into them and continues from the last prompt
+// token. The two pools are sized independently: --prefill-workers sets the
+// prefill side; the decode side is this process and its KV pool.
+// ============================================================================
+
+class DisaggregatedRunner
+{
+public:
+    DisaggregatedRunner(LlamaModel &model, Tokenizer &tokenizer, int num_prefill_workers)
+        : model_(model)
+        , tokenizer_(tokenizer)
+        , num_workers_(std::max(1, num_prefill_workers))
+    {
+        channel_ = std::make_unique<KVTransferChannel>(
+            2 * num_workers_, model.config.max_seq_len, model.config.block_size, model.kv_block_floats());
+
+        // Group 0 decodes, groups 1..N prefill
+        std::vector<std::vector<int>> cpu_groups = Affinity::numa_partition(num_workers_ + 1);
+
+        Logger::flush();
+        for (int w = 0; w < num_workers_; w++) {
+            pid_t pid = fork();
+            if (pid < 0) {
+                throw std::runtime_error("fork() failed for prefill worker " + std::to_string(w));
+            }
+            if (pid == 0) {
+                worker_main(w, cpu_groups[w + 1]);
+            }
+            workers_.push_back(pid);
+        }
+        if (!Affinity::pin_current_thread(cpu_groups[0])) {
+            LOG_WARNING("Decode process: could not pin to its cores");
+        }
+
+        LOG_INFO("Disaggregated serving: ",
+                 num_workers_,
+                 " prefill workers, 1 decode engine, ",
+                 channel_->num_slots(),
+                 " KV transfer slots");
+    }
+
+    ~DisaggregatedRunner()
+    {
+        channel_->close();
+        for (pid_t pid : workers_) {
+            int status = 0;
+            if (pid > 0) {
+                waitpid(pid, &status, 0);
+            }
+        }
+    }
+
+    DisaggregatedRunner(const DisaggregatedRunner &)            = delete;
+    DisaggregatedRunner &operator=(const DisaggregatedRunner &) = delete;
+
+    // Run every request next_request yields (false = input exhausted); each is
+    // passed to on_finish as soon as it completes. At most one request per
+    // transfer slot is read ahead of the one being decoded.
+    BenchmarkMetrics run(const std::function<bool(Request &)>       &next_request,
+                         const std::function<void(const Request &)> &on_finish)
+    {
+        BenchmarkMetrics                      metrics;
+        std::vector<std::unique_ptr<Request>> pending(channel_->num_slots());
+        bool                                  exhausted = false;
+        uint64_t                              ticket    = 0;
+
+        auto finish = [&](Request &req) {
+            if (req.status != RequestStatus::FAILED) {
+                metrics.add_request(req);
+            }
+            on_finish(req);
+        };
+
+        // Hand new prompts to every free slot
+        auto submit = [&] {
+            for (int i = 0; i < channel_->num_slots() && !exhausted; i++) {
+                if (pending[i] || workers_[i % num_workers_] < 0) {
+                    continue;
+                }
+                while (!exhausted) {
+                    auto req = std::make_unique<Request>();
+                    if (!next_request(*req)) {
+                        exhausted = true;
+                        break;
+                    }
+                    if (submit_to(i, *req, ticket++)) {
+                        pending[i] = std::move(req);
+                        break;
+                    }
+                    finish(*req); // Rejected before prefill; try the next one
+                }
+            }
+        };
+
+        // A worker that died (OOM kill, crash) never finishes the prompts in
+        // its slots: fail them and stop using its slots
+        auto reap_workers = [&] {
+            for (int w = 0; w < num_workers_; w++) {
+                int status = 0;
+                if (workers_[w] < 0 || waitpid(workers_[w], &status, WNOHANG) != workers_[w]) {
+                    continue;
+                }
+                LOG_ERROR("Prefill worker ", w, " exited unexpectedly");
+                workers_[w] = -1;
+                for (int i = w; i < channel_->num_slots(); i += num_workers_) {
+                    int state = channel_->slot(i).state.load(std::memory_order_acquire);
+                    if (pending[i] && state == KVTransferChannel::PREFILL) {
+                        pending[i]->status = RequestStatus::FAILED;
+                        finish(*pending[i]);
+                        pending[i].reset();
+                    }
+                }
+            }
+            if (std::all_of(workers_.begin(), workers_.end(), [](pid_t pid) { return pid < 0; })) {
+                throw std::runtime_error("All prefill workers exited");
+            }
+        };
+
+        auto start = std::chrono::high_resolution_clock::now();
+        submit();
+        for (int spins = 0;; spins++) {
+            // Oldest prefilled request first
+            int ready = -1;
+            for (int i = 0; i < channel_->num_slots(); i++) {
+                int state = channel_->slot(i).state.load(std::memory_order_acquire);
+                if (pending[i] && (state == KVTransferChannel::READY || state == KVTransferChannel::FAILED)
+                    && (ready < 0 || channel_->slot(i).ticket < channel_->slot(ready).ticket)) {
+                    ready = i;
+                }
+            }
+            if (ready < 0) {
+                if (exhausted && std::none_of(pending.begin(), pending.end(), [](const auto &p) { return !!p; })) {
+                    break;
+                }
+                if (spins % 256 == 255) {
+                    reap_workers();
+                }
+                backoff(spins);
+                continue;
+            }
+            spins = 0;
+
+            std::unique_ptr<Request> req = std::move(pending[ready]);
+            bool                     ok  = adopt(ready, *req);
+            channel_->slot(ready).state.store(KVTransferChannel::FREE, std::memory_order_release);
+            submit(); // Keep the workers busy while this request decodes
+
+            if (ok) {
+                decode(*req);
+            }
+            finish(*req);
+        }
+
+        metrics.total_time_ms =
+            std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+        return metrics;
+    }
+
+private:
+    LlamaModel                        &model_;
+    Tokenizer                         &tokenizer_;
+    int                                num_workers_;
+    std::unique_ptr<KVTransferChannel> channel_;
+    std::vector<pid_t>                 workers_; // -1 once a worker has exited
+
+    static void backoff(int spins)
+    {
+        if (spins < 256) {
+            std::this_thread::yield();
+            return;
+        }
+        std::this_thread::sleep_for(std::chrono::microseconds(50));
+    }
+
+    static double elapsed_ms(std::chrono::high_resolution_clock::time_point since)
+    {
+        return std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - since).count();
+    }
+
+    // Tokenize req into slot i and publish it to the slot's worker.
+    // Returns false (request marked FAILED) if the prompt does not fit.
+    bool submit_to(int i, Request &req, uint64_t ticket)
+    {
+        req.prompt_tokens  = tokenizer_.encode(req.prompt, true, false);
+        req.scheduled_time = Request::Clock::now();
+        if (req.arrival_time == Request::TimePoint{}) {
+            req.arrival_time = req.scheduled_time;
+        }
+        if (req.num_prompt_tokens() > channel_->max_tokens()) {
+            LOG_WARNING("Request ", req.id, ": prompt of ", req.num_prompt_tokens(), " tokens exceeds max_seq_len");
+            req.status = RequestStatus::FAILED;
+            return false;
+        }
+
+        KVTransferChannel::Slot &slot = channel_->slot(i);
+        std::copy(req.prompt_tokens.begin(), req.prompt_tokens.end(), channel_->tokens(i));
+        slot.ticket            = ticket;
+        slot.num_prompt_tokens = req.num_prompt_tokens();
+        req.status             = RequestStatus::PREFILLING;
+        slot.state.store(KVTransferChannel::PREFILL, std::memory_order_release);
+        return true;
+    }
+
+    // Move slot i's KV into this engine's cache. False if the prefill failed.
+    bool adopt(int i, Request &req)
+    {
+        PROFILE_SCOPE("kv_transfer.adopt");
+        KVTransferChannel::Slot &slot = channel_->slot(i);
+        if (slot.state.load(std::memory_order_acquire) == KVTransferChannel::FAILED) {
+            LOG_ERROR("Request ", req.id, ": prefill worker failed");
+            req.status = RequestStatus::FAILED;
+            return false;
+        }
+
+        model_.release_kv_blocks();
+        int          bs  = model_.config.block_size;
+        const float *src = channel_->kv(i);
+        for (int start = 0; start < slot.num_kv_tokens; start += bs, src += channel_->block_floats()) {
+            model_.write_kv_block(start, std::min(bs, slot.num_kv_tokens - start), src);
+        }
+
+        req.prefill_time_ms = slot.prefill_time_ms;
+        req.current_pos     = slot.num_kv_tokens;
+        EngineMetrics::instance().prompt_tokens.inc(req.num_prompt_tokens());
+        return true;
+    }
+
+    // Generate from the adopted KV until a stop condition
+    void decode(Request &req)
+    {
+        Sampler sampler(model_.config.vocab_size,
+                        req.sampling_params.temperature,
+                        req.sampling_params.top_p,
+                        static_cast<unsigned long long>(std::time(nullptr)) + req.id);
+
+        req.status        = RequestStatus::DECODING;
+        int  token        = req.prompt_tokens.back();
+        auto decode_start = std::chrono::high_resolution_clock::now();
+
+        while (req.can_generate_more()) {
+            model_.forward(token, req.current_pos);
+            int next_token = sample_next_token(sampler, model_.state.logits.data(), req);
+            req.output_text += tokenizer_.decode(next_token);
+            EngineMetrics::instance().generation_tokens.inc();
+
+            token = next_token;
+            req.current_pos++;
+            if (req.current_pos >= model_.config.max_seq_len || next_token == model_.config.eos_token_id) {
+                break;
+            }
+        }
+
+        req.decode_time_ms = elapsed_ms(decode_start);
+        req.status         = RequestStatus::FINISHED;
+        EngineMetrics::instance().observe_finished(req);
+    }
+
+    // ========================================================================
+    // Prefill worker process
+    // ========================================================================
+
+    [[noreturn]] void worker_main(int worker, const std::vector<int> &cpus)
+    {
+#ifdef __linux__
+        prctl(PR_SET_PDEATHSIG, SIGTERM); // Never outlive the decode process
+#endif
+        if (!Affinity::pin_current_thread(cpus)) {
+            LOG_WARNING("Prefill worker ", worker, ": could not pin to its cores");
+        }
+
+        std::vector<int> tokens;
+        for (int spins = 0; !channel_->closed(); spins++) {
+            // Oldest prompt among this worker's slots (i % workers == worker)
+            int next = -1;
+            for (int i = worker; i < channel_->num_slots(); i += num_workers_) {
+                if (channel_->slot(i).state.load(std::memory_order_acquire) == KVTransferChannel::PREFILL
+                    && (next < 0 || channel_->slot(i).ticket < channel_->slot(next).ticket)) {
+                    next = i;
+                }
+            }
+            if (next < 0) {
+                backoff(spins);
+                continue;
+            }
+            spins = 0;
+
+            KVTransferChannel::Slot &slot = channel_->slot(next);
+            tokens.assign(channel_->tokens(next), channel_->tokens(next) + slot.num_prompt_tokens);
+            int state = KVTransferChannel::READY;
+            try {
+                slot.num_kv_tokens = prefill(tokens, channel_->kv(next), slot.prefill_time_ms);
+            }
+            catch (const std::exception &e) {
+                LOG_ERROR("Prefill worker ", worker, ": ", e.what());
+                state = KVTransferChannel::FAILED;
+            }
+            slot.state.store(state, std::memory_order_release);
+        }
+
+        Logger::flush();
+        _exit(0); // Skip the parent's atexit handlers and static destructors
+    }
+
+    // Fill the KV of tokens[0, n - 1) (the last prompt token is the decode
+    // side's first input) and export it to dst. Returns the positions filled.
+    int prefill(const std::vector<int> &tokens, float *dst, double &elapsed)
+    {
+        auto start       = std::chrono::high_resolution_clock::now();
+        int  prefill_len = static_cast<int>(tokens.size()) - 1;
+
+        model_.release_kv_blocks();
+        int pos = model_.restore_prefix(tokens, prefill_len);
+        for (; pos < prefill_len; pos++) {
+            model_.forward(tokens[pos], pos);
+        }
+        model_.persist_prefix(tokens, prefill_len);
+
+        int bs = model_.config.block_size;
+        for (int start_pos = 0; start_pos < prefill_len; start_pos += bs, dst += channel_->block_floats()) {
+            model_.read_kv_block(start_pos, std::min(bs, prefill_len - start_pos), dst);
+        }
+        elapsed = elapsed_ms(start);
+        return prefill_len;
+    }
+};
@@ -0,0 +1,132 @@
+#pragma once
+
+#include "scheduler/request.hpp"
+#include "utils/metrics_registry.hpp"
+
+// ============================================================================
+// Engine Metrics - Serving metrics exported through the metrics registry
+//
+// Names follow vLLM's Prometheus metrics where an equivalent exists. Latency
+// histograms are in seconds, per Prometheus convention; rates such as
+// tokens/sec and prefix cache hit rate are derived from the counters at query
+// time, e.g. rate(nanovllm_generation_tokens_total[1m]).
+//
+// The registry is process-wide while replicas each run their own engine, so
+// engine state (KV blocks, queue lengths) goes through a GaugeShare: every
+// engine adds the change in its own value, and the gauge holds the pool sum.
+// ============================================================================
+
+// One engine's contribution to a gauge shared with other engines
+class GaugeShare
+{
+public:
+    explicit GaugeShare(Metrics::Gauge &gauge)
+        : gauge_(&gauge)
+    {
+    }
+
+    // A copy belongs to a new engine and starts with nothing published
+    GaugeShare(const GaugeShare &other)
+        : gauge_(other.gauge_)
+    {
+    }
+
+    GaugeShare &operator=(const GaugeShare &) = delete;
+
+    ~GaugeShare() { set(0.0); }
+
+    void set(double value)
+    {
+        gauge_->add(value - value_);
+        value_ = value;
+    }
+
+private:
+    Metrics::Gauge *gauge_;
+    double          value_ = 0.0;
+};
+
+struct EngineMetrics
+{
+    // KV cache
+    Metrics::Gauge   &kv_blocks_total;
+    Metrics::Gauge   &kv_blocks_used;
+    Metrics::Gauge   &kv_cache_usage;
+    Metrics::Counter &prefix_cache_queries;
+    Metrics::Counter &prefix_cache_hits;
+
+    // Scheduler
+    Metrics::Gauge     &num_requests_running;
+    Metrics::Gauge     &num_requests_waiting;
+    Metrics::Histogram &batch_size;
+
+    // Throughput
+    Metrics::Counter &prompt_tokens;
+    Metrics::Counter &generation_tokens;
+    Metrics::Counter &requests_finished;
+
+    // Latency
+    Metrics::Histogram &time_to_first_token;
+    Metrics::Histogram &time_per_output_token;
+    Metrics::Histogram &e2e_request_latency;
+    Metrics::Histogram &queue_time;
+
+    static EngineMetrics &instance()
+    {
+        static EngineMetrics metrics(Metrics::Registry::instance());
+        return metrics;
+    }
+
+    // Publish one engine's KV block counts; usage is over the whole pool
+    void set_kv_blocks(GaugeShare &used_share, GaugeShare &total_share, int used, int total)
+    {
+        used_share.set(used);
+        total_share.set(total);
+        double pool_total = kv_blocks_total.value();
+        kv_cache_usage.set(pool_total > 0 ? kv_blocks_used.value() / pool_total : 0.0);
+    }
+
+    // Per-request latencies, recorded once the request finishes
+    void observe_finished(const Request &request)
+    {
+        requests_finished.inc();
+        queue_time.observe(request.queueing_delay_ms() / 1000.0);
+        if (!request.token_times.empty()) {
+            time_to_first_token.observe(request.ttft_ms() / 1000.0);
+            e2e_request_latency.observe(request.e2e_latency_ms() / 1000.0);
+        }
+        if (request.token_times.size() >= 2) {
+            time_per_output_token.observe(request.tpot_ms() / 1000.0);
+        }
+    }
+
+private:
+    explicit EngineMetrics(Metrics::Registry &r)
+        : kv_blocks_total(r.gauge("nanovllm_kv_blocks_total", "Physical KV cache blocks"))
+        , kv_blocks_used(r.gauge("nanovllm_kv_blocks_used", "KV cache blocks currently allocated"))
+        , kv_cache_usage(r.gauge("nanovllm_kv_cache_usage_perc", "Fraction of KV cache blocks in use (0-1)"))
+        , prefix_cache_queries(r.counter("nanovllm_prefix_cache_queries_total", "Prompt blocks looked up"))
+        , prefix_cache_hits(r.counter("nanovllm_prefix_cache_hits_total", "Prompt blocks served from prefix cache"))
+        , num_requests_running(r.gauge("nanovllm_num_requests_running", "Requests being prefilled or decoded"))
+        , num_requests_waiting(r.gauge("nanovllm_num_requests_waiting", "Requests queued for scheduling"))
+        , batch_size(r.histogram("nanovllm_iteration_batch_size",
+                                 "Requests per scheduler iteration",
+                                 Metrics::exponential_buckets(1, 2, 9)))
+        , prompt_tokens(r.counter("nanovllm_prompt_tokens_total", "Prefilled prompt tokens"))
+        , generation_tokens(r.counter("nanovllm_generation_tokens_total", "Generated tokens"))
+        , requests_finished(r.counter("nanovllm_request_success_total", "Finished requests"))
+        , time_to_first_token(r.histogram("nanovllm_time_to_first_token_seconds",
+                                          "Arrival to first generated token",
+                                          Metrics::exponential_buckets(0.001, 2, 16)))
+        , time_per_output_token(r.histogram("nanovllm_time_per_output_token_seconds",
+                                            "Mean decode time per token after the first",
+                                            Metrics::exponential_buckets(0.0005, 2, 14)))
+        , e2e_request_latency(r.histogram("nanovllm_e2e_request_latency_seconds",
+                                          "Arrival to last generated token",
+                                          Metrics::exponential_buckets(0.01, 2, 14)))
+        , queue_time(r.histogram("nanovllm_request_queue_time_seconds",
+                                 "Arrival to first scheduled",
+                                 Metrics::exponential_buckets(0.001, 2, 16)))
+    {
+    }
+};
@@ -0,0 +1,303 @@
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+#include "utils/logger.hpp"
+
+// ============================================================================
+// KV Disk Store - Persistent, content-addressed tier for prefix KV blocks
+//
+// Every full KV block (block_size tokens, all layers, key + value) is stored
+// as one file named after the hash of its token prefix. The hash of block i
+// chains the hash of block i-1 with block i's tokens, so a hit on block i
+// implies the whole prefix [0, (i + 1) * block_size) matches. The block's own
+// token ids are stored next to the header and compared on every map(), so a
+// hash collision is a miss rather than silently wrong KV.
+//
+// Blocks live under <dir>/<model fingerprint>/, so stores written by a
+// different model (or a different checkpoint of the same shape) never match.
+// Writes go to a temp file that is renamed into place; a concurrent reader
+// either sees a complete block or no block at all.
+// ============================================================================
+
+namespace KVStore {
+
+constexpr uint64_t FNV_OFFSET = 1469598103934665603ULL;
+constexpr uint64_t FNV_PRIME  = 1099511628211ULL;
+
+// FNV-1a over raw bytes
+inline uint64_t hash_bytes(const void *data, size_t len, uint64_t seed = FNV_OFFSET)
+{
+    const auto *bytes = static_cast<const unsigned char *>(data);
+    uint64_t    h     = seed;
+    for (size_t i = 0; i < len; i++) {
+        h ^= bytes[i];
+        h *= FNV_PRIME;
+    }
+    return h;
+}
+
+// Hash of one full block of tokens, chained onto its parent block's hash
+inline uint64_t hash_block(uint64_t parent_hash, const int *tokens, int block_size)
+{
+    return hash_bytes(tokens, block_size * sizeof(int), parent_hash ^ FNV_PRIME);
+}
+
+inline std::string to_hex(uint64_t value)
+{
+    std::ostringstream oss;
+    oss << std::hex << std::setw(16) << std::setfill('0') << value;
+    return oss.str();
+}
+
+// On-disk block header, followed by the block's tokens (block_size int32)
+// and the payload: [n_layers][2 (key, value)][block_size][kv_dim] floats
+struct BlockHeader
+{
+    char     magic[8];
+    uint32_t version;
+    uint32_t block_size;
+    uint32_t n_layers;
+    uint32_t kv_dim;
+    uint64_t fingerprint;
+    uint64_t block_hash;
+};
+
+constexpr char     BLOCK_MAGIC[8] = {'N', 'V', 'K', 'V', 'B', 'L', 'K', '\0'};
+constexpr uint32_t BLOCK_VERSION  = 2;
+
+} // namespace KVStore
+
+// ============================================================================
+// Mapped Block - Read-only mmap view of one stored block (RAII)
+// ============================================================================
+
+class MappedKVBlock
+{
+public:
+    MappedKVBlock() = default;
+
+    MappedKVBlock(void *addr, size_t length, int block_size, int kv_dim)
+        : addr_(addr)
+        , length_(length)
+        , block_size_(block_size)
+        , kv_dim_(kv_dim)
+    {
+    }
+
+    MappedKVBlock(const MappedKVBlock &)            = delete;
+    MappedKVBlock &operator=(const MappedKVBlock &) = delete;
+
+    MappedKVBlock(MappedKVBlock &&other) noexcept { *this = std::move(other); }
+
+    MappedKVBlock &operator=(MappedKVBlock &&other) noexcept
+    {
+        if (this != &other) {
+            release();
+            addr_       = other.addr_;
+            length_     = other.length_;
+            block_size_ = other.block_size_;
+            kv_dim_     = other.kv_dim_;
+            other.addr_ = nullptr;
+        }
+        return *this;
+    }
+
+    ~MappedKVBlock() { release(); }
+
+    explicit operator bool() const { return addr_ != nullptr; }
+
+    // Key rows for a layer: [block_size, kv_dim]
+    const float *key(int layer) const { return payload() + (2 * layer) * layer_stride(); }
+
+    // Value rows for a layer: [block_size, kv_dim]
+    const float *value(int layer) const { return payload() + (2 * layer + 1) * layer_stride(); }
+
+private:
+    void  *addr_       = nullptr;
+    size_t length_     = 0;
+    int    block_size_ = 0;
+    int    kv_dim_     = 0;
+
+    size_t layer_stride() const { return static_cast<size_t>(block_size_) * kv_dim_; }
+
+    const float *payload() const
+    {
+        size_t offset = sizeof(KVStore::BlockHeader) + block_size_ * sizeof(int32_t);
+        return reinterpret_cast<const float *>(static_cast<const char *>(addr_) + offset);
+    }
+
+    void release()
+    {
+        if (addr_) {
+            munmap(addr_, length_);
+            addr_ = nullptr;
+        }
+    }
+};
+
+// ============================================================================
+// KV Disk Store
+// ============================================================================
+
+class KVDiskStore
+{
+public:
+    KVDiskStore(const std::string &dir, uint64_t fingerprint, int n_layers, int block_size, int kv_dim)
+        : dir_(std::filesystem::path(dir) / KVStore::to_hex(fingerprint))
+        , fingerprint_(fingerprint)
+        , n_layers_(n_layers)
+        , block_size_(block_size)
+        , kv_dim_(kv_dim)
+    {
+        std::filesystem::create_directories(dir_);
+        LOG_INFO("KV disk store: ", dir_.string(), " (", block_bytes(), " bytes per block)");
+    }
+
+    int block_size() const { return block_size_; }
+    int kv_dim() const { return kv_dim_; }
+
+    // Number of floats in one block payload (all layers, key + value)
+    size_t block_floats() const { return static_cast<size_t>(n_layers_) * 2 * block_size_ * kv_dim_; }
+
+    bool contains(uint64_t block_hash) const { return std::filesystem::exists(block_path(block_hash)); }
+
+    // Map the stored block for tokens[0, block_size) read-only. Returns an
+    // empty view on a miss, or if the file belongs to another model/shape or
+    // to different tokens.
+    MappedKVBlock map(uint64_t block_hash, const int *tokens)
+    {
+        std::string path = block_path(block_hash);
+        int         fd   = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0) {
+            misses_++;
+            return {};
+        }
+
+        struct stat st;
+        size_t      expected = block_bytes();
+        if (fstat(fd, &st) != 0 || static_cast<size_t>(st.st_size) != expected) {
+            ::close(fd);
+            LOG_WARNING("KV disk store: ignoring malformed block ", path);
+            misses_++;
+            return {};
+        }
+
+        void *addr = mmap(nullptr, expected, PROT_READ, MAP_PRIVATE, fd, 0);
+        ::close(fd);
+        if (addr == MAP_FAILED) {
+            misses_++;
+            return {};
+        }
+
+        const auto *header = static_cast<const KVStore::BlockHeader *>(addr);
+        if (!header_matches(*header, block_hash, tokens)) {
+            munmap(addr, expected);
+            LOG_WARNING("KV disk store: header mismatch for ", path);
+            misses_++;
+            return {};
+        }
+
+        hits_++;
+        return MappedKVBlock(addr, expected, block_size_, kv_dim_);
+    }
+
+    // Store the payload for tokens[0, block_size), laid out as
+    // [n_layers][2][block_size][kv_dim]
+    void put(uint64_t block_hash, const int *tokens, const std::vector<float> &payload)
+    {
+        if (payload.size() != block_floats()) {
+            throw std::runtime_error("KV disk store: payload size mismatch");
+        }
+
+        KVStore::BlockHeader header{};
+        std::memcpy(header.magic, KVStore::BLOCK_MAGIC, sizeof(header.magic));
+        header.version     = KVStore::BLOCK_VERSION;
+        header.block_size  = static_cast<uint32_t>(block_size_);
+        header.n_layers    = static_cast<uint32_t>(n_layers_);
+        header.kv_dim      = static_cast<uint32_t>(kv_dim_);
+        header.fingerprint = fingerprint_;
+        header.block_hash  = block_hash;
+
+        std::vector<int32_t> block_tokens(tokens, tokens + block_size_);
+
+        std::string path     = block_path(block_hash);
+        // Unique per process and thread: replicas in one process may write the same block
+        std::string tmp_path = path + ".tmp." + std::to_string(::getpid()) + "."
+                             + std::to_string(std::hash<std::thread::id>{}(std::this_thread::get_id()));
+        {
+            std::ofstream file(tmp_path, std::ios::binary | std::ios::trunc);
+            if (!file.is_open()) {
+                LOG_WARNING("KV disk store: failed to open ", tmp_path);
+                return;
+            }
+            file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+            file.write(reinterpret_cast<const char *>(block_tokens.data()), block_tokens.size() * sizeof(int32_t));
+            file.write(reinterpret_cast<const char *>(payload.data()), payload.size() * sizeof(float));
+            if (!file.good()) {
+                LOG_WARNING("KV disk store: failed to write ", tmp_path);
+                std::remove(tmp_path.c_str());
+                return;
+            }
+        }
+        std::filesystem::rename(tmp_path, path);
+        writes_++;
+    }
+
+    int num_hits() const { return hits_; }
+    int num_misses() const { return misses_; }
+    int num_writes() const { return writes_; }
+
+private:
+    std::filesystem::path dir_;
+    uint64_t              fingerprint_;
+    int                   n_layers_;
+    int                   block_size_;
+    int                   kv_dim_;
+
+    int hits_   = 0;
+    int misses_ = 0;
+    int writes_ = 0;
+
+    size_t block_bytes() const
+    {
+        return sizeof(KVStore::BlockHeader) + block_size_ * sizeof(int32_t) + block_floats() * sizeof(float);
+    }
+
+    std::string block_path(uint64_t block_hash) const
+    {
+        return (dir_ / (KVStore::to_hex(block_hash) + ".kv")).string();
+    }
+
+    bool header_matches(const KVStore::BlockHeader &header, uint64_t block_hash, const int *tokens) const
+    {
+        if (std::memcmp(header.magic, KVStore::BLOCK_MAGIC, sizeof(header.magic)) != 0
+            || header.version != KVStore::BLOCK_VERSION || header.block_size != static_cast<uint32_t>(block_size_)
+            || header.n_layers != static_cast<uint32_t>(n_layers_) || header.kv_dim != static_cast<uint32_t>(kv_dim_)
+            || header.fingerprint != fingerprint_ || header.block_hash != block_hash) {
+            return false;
+        }
+        const auto *stored = reinterpret_cast<const int32_t *>(&header + 1);
+        for (int i = 0; i < block_size_; i++) {
+            if (stored[i] != tokens[i]) {
+                return false;
+            }
+        }
+        return true;
+    }
+};
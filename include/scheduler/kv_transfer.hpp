@@ -0,0 +1,110 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <stdexcept>
+#include <string>
+
+#include <sys/mman.h>
+
+// ============================================================================
+// KV Transfer Channel - Shared-memory handoff of prompt KV between processes
+//
+// A fixed set of slots in one anonymous MAP_SHARED region, created before
+// fork(). The decode side claims a FREE slot, writes the prompt tokens and
+// publishes it as PREFILL; the prefill worker that owns the slot computes
+// the prompt KV, writes it as whole blocks in the KV disk store layout
+// ([n_layers][key, value][block_size][kv_dim] per block) and publishes it as
+// READY; the decode side adopts the blocks into its own pool and frees the
+// slot. Each slot has exactly one writer per state, so an acquire/release
+// state word is the only synchronisation needed.
+// ============================================================================
+
+class KVTransferChannel
+{
+public:
+    enum State : int { FREE = 0, PREFILL = 1, READY = 2, FAILED = 3 };
+
+    struct Slot
+    {
+        alignas(64) std::atomic<int> state{FREE};
+        uint64_t ticket            = 0; // Submission order, oldest first
+        int      num_prompt_tokens = 0;
+        int      num_kv_tokens     = 0; // Positions the prefill worker filled
+        double   prefill_time_ms   = 0.0;
+    };
+
+    // max_tokens bounds prompts; block_floats is LlamaModel::kv_block_floats()
+    KVTransferChannel(int num_slots, int max_tokens, int block_size, size_t block_floats)
+        : num_slots_(num_slots)
+        , max_tokens_(max_tokens)
+        , max_blocks_((max_tokens + block_size - 1) / block_size)
+        , block_floats_(block_floats)
+    {
+        static_assert(std::atomic<int>::is_always_lock_free && std::atomic<bool>::is_always_lock_free,
+                      "cross-process flags need address-free atomics");
+
+        slot_bytes_ = round_up(sizeof(Slot)) + round_up(static_cast<size_t>(max_tokens_) * sizeof(int))
+                    + static_cast<size_t>(max_blocks_) * block_floats_ * sizeof(float);
+        slot_bytes_ = round_up(slot_bytes_);
+        bytes_      = round_up(sizeof(Header)) + slot_bytes_ * num_slots_;
+
+        void *base = mmap(nullptr, bytes_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+        if (base == MAP_FAILED) {
+            throw std::runtime_error("Failed to map " + std::to_string(bytes_) + " bytes for KV transfer");
+        }
+        header_ = new (base) Header();
+        slots_  = static_cast<char *>(base) + round_up(sizeof(Header));
+        for (int i = 0; i < num_slots_; i++) {
+            new (slots_ + static_cast<size_t>(i) * slot_bytes_) Slot();
+        }
+    }
+
+    ~KVTransferChannel() { munmap(header_, bytes_); }
+
+    KVTransferChannel(const KVTransferChannel &)            = delete;
+    KVTransferChannel &operator=(const KVTransferChannel &) = delete;
+
+    int num_slots() const { return num_slots_; }
+    int max_tokens() const { return max_tokens_; }
+
+    size_t block_floats() const { return block_floats_; }
+
+    // Set by the decode side to stop the prefill workers
+    bool closed() const { return header_->closed.load(std::memory_order_acquire); }
+    void close() { header_->closed.store(true, std::memory_order_release); }
+
+    Slot &slot(int i) { return *reinterpret_cast<Slot *>(slots_ + static_cast<size_t>(i) * slot_bytes_); }
+
+    // Prompt tokens of slot i: [max_tokens]
+    int *tokens(int i)
+    {
+        return reinterpret_cast<int *>(slots_ + static_cast<size_t>(i) * slot_bytes_ + round_up(sizeof(Slot)));
+    }
+
+    // KV of slot i: [max_blocks][block_floats]
+    float *kv(int i)
+    {
+        return reinterpret_cast<float *>(slots_ + static_cast<size_t>(i) * slot_bytes_ + round_up(sizeof(Slot))
+                                         + round_up(static_cast<size_t>(max_tokens_) * sizeof(int)));
+    }
+
+private:
+    struct Header
+    {
+        std::atomic<bool> closed{false};
+    };
+
+    static size_t round_up(size_t bytes) { return (bytes + 63) & ~size_t(63); }
+
+    int     num_slots_;
+    int     max_tokens_;
+    int     max_blocks_;
+    size_t  block_floats_;
+    size_t  slot_bytes_ = 0;
+    size_t  bytes_      = 0;
+    Header *header_     = nullptr;
+    char   *slots_      = nullptr;
+};
@@ -0,0 +1,141 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <random>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "scheduler/request.hpp"
+
+// ============================================================================
+// Load Generator - Open-loop request arrival schedules
+//
+// Offline benchmarks submit every request at t=0 and measure throughput only.
+// An open-loop generator submits requests at predetermined times regardless
+// of how fast the engine drains them, so queueing delay and tail latency
+// behave like they would under real traffic.
+// ============================================================================
+
+struct LoadConfig
+{
+    std::vector<double> request_rates;    // Requests/sec to sweep (empty = offline, all at t=0)
+    double              burstiness = 1.0; // Gamma shape: 1 = Poisson, <1 burstier, >1 smoother
+    std::string         trace_path;       // Replay arrival times from a file instead
+    unsigned long long  seed = 0;
+
+    bool is_open_loop() const { return !request_rates.empty() || !trace_path.empty(); }
+};
+
+// Service level objective used to compute goodput (0 = unconstrained)
+struct ServiceLevelObjective
+{
+    double ttft_ms = 0.0;
+    double tpot_ms = 0.0;
+
+    bool enabled() const { return ttft_ms > 0.0 || tpot_ms > 0.0; }
+
+    bool met_by(const Request &request) const
+    {
+        if (request.token_times.empty()) {
+            return false;
+        }
+        if (ttft_ms > 0.0 && request.ttft_ms() > ttft_ms) {
+            return false;
+        }
+        if (tpot_ms > 0.0 && request.tpot_ms() > tpot_ms) {
+            return false;
+        }
+        return true;
+    }
+};
+
+namespace LoadGen {
+
+// Arrival offsets (ms from start) with gamma-distributed inter-arrival times.
+// Mean gap is 1/rate; shape 1 reduces to a Poisson process.
+inline std::vector<double> gamma_arrivals(int num_requests, double rate, double burstiness, unsigned long long seed)
+{
+    if (rate <= 0.0 || burstiness <= 0.0) {
+        throw std::runtime_error("Request rate and burstiness must be positive");
+    }
+
+    std::mt19937_64                 rng(seed);
+    std::gamma_distribution<double> gap_sec(burstiness, 1.0 / (rate * burstiness));
+    std::vector<double>             offsets(num_requests);
+    double                          t = 0.0;
+    for (int i = 0; i < num_requests; i++) {
+        offsets[i] = t * 1000.0;
+        t += gap_sec(rng);
+    }
+    return offsets;
+}
+
+// Arrival offsets (ms) replayed from a trace: one timestamp in seconds per
+// line, '#' starts a comment. Timestamps are shifted so the first is t=0.
+inline std::vector<double> load_arrival_trace(const std::string &path, int num_requests)
+{
+    std::ifstream file(path);
+    if (!file.is_open()) {
+        throw std::runtime_error("Failed to open arrival trace: " + path);
+    }
+
+    std::vector<double> timestamps;
+    std::string         line;
+    while (std::getline(file, line)) {
+        line = line.substr(0, line.find('#'));
+        std::istringstream iss(line);
+        double             t;
+        if (iss >> t) {
+            timestamps.push_back(t);
+        }
+    }
+
+    if (static_cast<int>(timestamps.size()) < num_requests) {
+        throw std::runtime_error("Arrival trace has " + std::to_string(timestamps.size()) + " entries for "
+                                 + std::to_string(num_requests) + " requests");
+    }
+
+    timestamps.resize(num_requests);
+    if (timestamps.empty()) {
+        return timestamps;
+    }
+    std::sort(timestamps.begin(), timestamps.end());
+    double first = timestamps.front();
+    for (double &t : timestamps) {
+        t = (t - first) * 1000.0;
+    }
+    return timestamps;
+}
+
+// Parse a comma-separated list of rates, e.g. "1,2,4.5". Every rate must be
+// a positive number.
+inline std::vector<double> parse_rates(const std::string &text)
+{
+    std::vector<double> rates;
+    std::stringstream   ss(text);
+    std::string         item;
+    while (std::getline(ss, item, ',')) {
+        if (item.empty()) {
+            continue;
+        }
+        double rate = 0.0;
+        size_t end  = 0;
+        try {
+            rate = std::stod(item, &end);
+        }
+        catch (const std::exception &) {
+            end = 0;
+        }
+        if (end != item.size() || !std::isfinite(rate) || rate <= 0.0) {
+            throw std::runtime_error("Invalid request rate '" + item + "': expected a positive number");
+        }
+        rates.push_back(rate);
+    }
+    return rates;
+}
+
+} // namespace LoadGen
@@ -0,0 +1,459 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "core/attention.hpp"
+#include "core/kernel_table.hpp"
+#include "core/model.hpp"
+#include "core/sampler.hpp"
+#include "core/tokenizer.hpp"
+#include "ops/activation.hpp"
+#include "ops/linear.hpp"
+#include "ops/normalization.hpp"
+#include "ops/positional.hpp"
+#include "scheduler/benchmark.hpp"
+#include "scheduler/engine_metrics.hpp"
+#include "scheduler/request.hpp"
+#include "utils/affinity.hpp"
+#include "utils/logger.hpp"
+#include "utils/profiler.hpp"
+#include "utils/spsc_queue.hpp"
+
+// ============================================================================
+// Pipeline Runner - Layer-pipelined execution across core groups
+//
+// weights.layers is split into contiguous stages. Each stage runs on its own
+// thread pinned to a core group that never straddles a NUMA node, and copies
+// its layers' weights (and the KV cache for those layers) from that thread,
+// so first-touch places them in the stage's local memory. Stage 0 also owns
+// the embedding table and the last stage the final norm and classifier.
+//
+// Sequences are split into micro-batches, one per stage, that circulate
+// through lock-free SPSC queues of hidden states: driver -> stage 0 -> ... ->
+// last stage -> driver. While stage s works on one micro-batch, stage s - 1
+// works on the next, so every stage stays busy once the pipeline is full.
+// The driver (calling thread) samples, retires finished sequences and
+// refills their slots from the request source.
+//
+// Prompts are fed one position per pass, like the single-sequence engine.
+// The pipeline keeps its own contiguous per-slot KV cache; PagedAttention
+// and the prefix KV disk store are not used in this mode.
+// ============================================================================
+
+class PipelineRunner
+{
+public:
+    // Starts the stage threads and moves the model's weights into
+    // stage-local memory (model.weights is replaced by the placed copy).
+    PipelineRunner(LlamaModel &model, Tokenizer &tokenizer, int num_stages, int max_sequences)
+        : model_(model)
+        , tokenizer_(tokenizer)
+        , config_(model.config)
+        , kernels_(model.kernels)
+    {
+        num_stages     = std::clamp(num_stages, 1, config_.n_layers);
+        max_sequences_ = std::max(max_sequences, num_stages);
+        group_size_    = (max_sequences_ + num_stages - 1) / num_stages;
+        num_groups_    = (max_sequences_ + group_size_ - 1) / group_size_;
+
+        queues_.reserve(num_stages + 1);
+        for (int s = 0; s <= num_stages; s++) {
+            queues_.push_back(std::make_unique<SpscQueue<MicroBatch *>>(num_groups_ + 1));
+        }
+
+        auto source = model.weights;
+        auto placed = std::make_shared<TransformerWeights>();
+        placed->layers.resize(config_.n_layers);
+        placed->weights_shared = source->weights_shared;
+
+        std::vector<std::vector<int>> cpu_groups = Affinity::numa_partition(num_stages);
+        for (int s = 0; s < num_stages; s++) {
+            auto stage         = std::make_unique<Stage>();
+            stage->index       = s;
+            stage->first_layer = s * config_.n_layers / num_stages;
+            stage->last_layer  = (s + 1) * config_.n_layers / num_stages;
+            stage->cpus        = cpu_groups[s];
+            stage->in          = queues_[s].get();
+            stage->out         = queues_[s + 1].get();
+            stages_.push_back(std::move(stage));
+        }
+        for (auto &stage : stages_) {
+            stage->thread = std::thread(
+                [this, st = stage.get(), source, placed] { stage_main(*st, *source, *placed); });
+        }
+
+        // Weights are read only after every stage has placed its share
+        {
+            std::unique_lock<std::mutex> lock(ready_mutex_);
+            ready_cv_.wait(lock, [&] { return num_ready_ == num_stages; });
+        }
+        model.weights = placed;
+
+        groups_.resize(num_groups_);
+        for (int g = 0; g < num_groups_; g++) {
+            groups_[g].group = g;
+        }
+        slots_.resize(max_sequences_);
+
+        LOG_INFO("Pipeline: ",
+                 num_stages,
+                 " stages over ",
+                 config_.n_layers,
+                 " layers, ",
+                 num_groups_,
+                 " micro-batches of up to ",
+                 group_size_,
+                 " sequences");
+    }
+
+    ~PipelineRunner()
+    {
+        queues_.front()->push_wait(nullptr); // Shutdown travels down the pipeline
+        for (auto &stage : stages_) {
+            stage->thread.join();
+        }
+    }
+
+    PipelineRunner(const PipelineRunner &)            = delete;
+    PipelineRunner &operator=(const PipelineRunner &) = delete;
+
+    // Run every request next_request yields (false = input exhausted); each is
+    // passed to on_finish as soon as it completes and then released.
+    BenchmarkMetrics run(const std::function<bool(Request &)>       &next_request,
+                         const std::function<void(const Request &)> &on_finish)
+    {
+        BenchmarkMetrics metrics;
+        bool             exhausted = false;
+
+        auto finish = [&](Slot &slot) {
+            Request &req = *slot.request;
+            if (req.status != RequestStatus::FAILED) {
+                req.decode_time_ms = elapsed_ms(slot.decode_start);
+                req.status         = RequestStatus::FINISHED;
+                metrics.add_request(req);
+                EngineMetrics::instance().observe_finished(req);
+            }
+            on_finish(req);
+            slot = Slot();
+        };
+
+        // Start the next request in slot; false once the input is exhausted
+        auto refill = [&](Slot &slot) {
+            while (!exhausted) {
+                auto req = std::make_unique<Request>();
+                if (!next_request(*req)) {
+                    exhausted = true;
+                    break;
+                }
+                if (start(slot, std::move(req))) {
+                    return true;
+                }
+                finish(slot); // Rejected (prompt too long); report it and try the next one
+            }
+            return false;
+        };
+
+        auto start_time = std::chrono::high_resolution_clock::now();
+
+        int in_flight = 0;
+        for (auto &mb : groups_) {
+            for (int s = first_slot(mb.group); s < end_slot(mb.group); s++) {
+                refill(slots_[s]);
+            }
+            if (launch(mb)) {
+                in_flight++;
+            }
+        }
+
+        while (in_flight > 0) {
+            MicroBatch *mb = queues_.back()->pop_wait();
+
+            for (int i = 0; i < mb->size; i++) {
+                Slot    &slot = slots_[mb->slots[i]];
+                Request &req  = *slot.request;
+
+                // Still feeding the prompt: the next position is the next prompt token
+                if (slot.pos < req.num_prompt_tokens() - 1) {
+                    slot.pos++;
+                    slot.token = req.prompt_tokens[slot.pos];
+                    if (slot.pos == req.num_prompt_tokens() - 1) {
+                        begin_decode(slot);
+                    }
+                    continue;
+                }
+
+                float *logits     = mb->logits.data() + static_cast<size_t>(i) * config_.vocab_size;
+                int    next_token = sample_next_token(*slot.sampler, logits, req);
+                req.output_text += tokenizer_.decode(next_token);
+                EngineMetrics::instance().generation_tokens.inc();
+
+                slot.pos++;
+                slot.token = next_token;
+                req.current_pos = slot.pos;
+
+                if (!req.can_generate_more() || next_token == config_.eos_token_id || slot.pos >= config_.max_seq_len) {
+                    finish(slot);
+                    refill(slot);
+                }
+            }
+
+            if (!launch(*mb)) {
+                in_flight--;
+            }
+        }
+
+        metrics.total_time_ms = elapsed_ms(start_time);
+        return metrics;
+    }
+
+private:
+    // One micro-batch: a token step for each active sequence of a group
+    struct MicroBatch
+    {
+        int                group = 0;
+        int                size  = 0;
+        std::vector<int>   slots;
+        std::vector<int>   tokens;
+        std::vector<int>   positions;
+        std::vector<char>  want_logits;
+        std::vector<float> x;      // [size, dim] hidden states
+        std::vector<float> logits; // [size, vocab_size], rows with want_logits only
+    };
+
+    struct Stage
+    {
+        int                      index       = 0;
+        int                      first_layer = 0;
+        int                      last_layer  = 0;
+        std::vector<int>         cpus;
+        SpscQueue<MicroBatch *> *in  = nullptr;
+        SpscQueue<MicroBatch *> *out = nullptr;
+        std::thread              thread;
+    };
+
+    struct Slot
+    {
+        std::unique_ptr<Request>                       request;
+        std::unique_ptr<Sampler>                       sampler;
+        int                                            pos   = 0;
+        int                                            token = 0;
+        std::chrono::high_resolution_clock::time_point prefill_start;
+        std::chrono::high_resolution_clock::time_point decode_start;
+    };
+
+    LlamaModel &model_;
+    Tokenizer  &tokenizer_;
+    Config      config_;
+    KernelTable kernels_;
+
+    int max_sequences_ = 0;
+    int group_size_    = 0;
+    int num_groups_    = 0;
+
+    std::vector<std::unique_ptr<SpscQueue<MicroBatch *>>> queues_; // queues_[s] feeds stage s
+    std::vector<std::unique_ptr<Stage>>                   stages_;
+    std::vector<MicroBatch>                               groups_;
+    std::vector<Slot>                                     slots_;
+
+    std::mutex              ready_mutex_;
+    std::condition_variable ready_cv_;
+    int                     num_ready_ = 0;
+
+    static double elapsed_ms(std::chrono::high_resolution_clock::time_point since)
+    {
+        return std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - since).count();
+    }
+
+    int first_slot(int group) const { return group * group_size_; }
+    int end_slot(int group) const { return std::min(max_sequences_, (group + 1) * group_size_); }
+
+    // Encode, create the sampler and set the slot at position 0.
+    // Returns false (request marked FAILED) if the prompt does not fit.
+    bool start(Slot &slot, std::unique_ptr<Request> req)
+    {
+        auto now = Request::Clock::now();
+        if (req->arrival_time == Request::TimePoint{}) {
+            req->arrival_time = now;
+        }
+        req->scheduled_time = now;
+        req->prompt_tokens  = tokenizer_.encode(req->prompt, true, false);
+        slot.request        = std::move(req);
+
+        Request &r = *slot.request;
+        if (r.num_prompt_tokens() > config_.max_seq_len) {
+            LOG_WARNING("Request ", r.id, ": prompt of ", r.num_prompt_tokens(), " tokens exceeds max_seq_len");
+            r.status = RequestStatus::FAILED;
+            return false;
+        }
+
+        r.status           = RequestStatus::PREFILLING;
+        slot.sampler       = std::make_unique<Sampler>(config_.vocab_size,
+                                                 r.sampling_params.temperature,
+                                                 r.sampling_params.top_p,
+                                                 static_cast<unsigned long long>(std::time(nullptr)) + r.id);
+        slot.pos           = 0;
+        slot.token         = r.prompt_tokens[0];
+        slot.prefill_start = std::chrono::high_resolution_clock::now();
+        EngineMetrics::instance().prompt_tokens.inc(r.num_prompt_tokens());
+        if (r.num_prompt_tokens() == 1) {
+            begin_decode(slot);
+        }
+        return true;
+    }
+
+    void begin_decode(Slot &slot)
+    {
+        slot.request->prefill_time_ms = elapsed_ms(slot.prefill_start);
+        slot.request->status          = RequestStatus::DECODING;
+        slot.decode_start             = std::chrono::high_resolution_clock::now();
+    }
+
+    // Build the group's next micro-batch and send it down the pipeline.
+    // Returns false if the group has no active sequence left.
+    bool launch(MicroBatch &mb)
+    {
+        mb.slots.clear();
+        mb.tokens.clear();
+        mb.positions.clear();
+        mb.want_logits.clear();
+        for (int s = first_slot(mb.group); s < end_slot(mb.group); s++) {
+            const Slot &slot = slots_[s];
+            if (!slot.request) {
+                continue;
+            }
+            mb.slots.push_back(s);
+            mb.tokens.push_back(slot.token);
+            mb.positions.push_back(slot.pos);
+            mb.want_logits.push_back(slot.pos >= slot.request->num_prompt_tokens() - 1);
+        }
+        mb.size = static_cast<int>(mb.slots.size());
+        if (mb.size == 0) {
+            return false;
+        }
+        mb.x.resize(static_cast<size_t>(mb.size) * config_.dim);
+        mb.logits.resize(static_cast<size_t>(mb.size) * config_.vocab_size);
+        queues_.front()->push_wait(&mb);
+        return true;
+    }
+
+    // ========================================================================
+    // Stage thread
+    // ========================================================================
+
+    void stage_main(Stage &stage, const TransformerWeights &source, TransformerWeights &placed)
+    {
+        if (!stage.cpus.empty() && !Affinity::pin_current_thread(stage.cpus)) {
+            LOG_WARNING("Pipeline stage ", stage.index, ": could not pin thread to its cores");
+        }
+        Profiler::instance().set_thread_name("stage-" + std::to_string(stage.index));
+
+        bool first = stage.index == 0;
+        bool last  = stage.index + 1 == static_cast<int>(stages_.size());
+
+        // First touch from the pinned thread places these pages on its node
+        for (int l = stage.first_layer; l < stage.last_layer; l++) {
+            placed.layers[l] = source.layers[l];
+        }
+        if (first) {
+            placed.token_embedding_table = source.token_embedding_table;
+        }
+        if (last) {
+            placed.rms_final_weight = source.rms_final_weight;
+            placed.lm_head          = source.lm_head;
+        }
+
+        int    dim         = config_.dim;
+        int    kv_dim      = config_.n_kv_heads * config_.head_dim;
+        int    num_layers  = stage.last_layer - stage.first_layer;
+        size_t slot_cache  = static_cast<size_t>(config_.max_seq_len) * kv_dim;
+        size_t layer_cache = slot_cache * max_sequences_;
+
+        // Layout: [local_layer, slot, max_seq_len, n_kv_heads, head_dim]
+        std::vector<float> key_cache(layer_cache * num_layers);
+        std::vector<float> value_cache(layer_cache * num_layers);
+        std::vector<float> xb(dim), xb2(dim), q(dim), k(kv_dim), v(kv_dim);
+        std::vector<float> hb(config_.hidden_dim), hb2(config_.hidden_dim);
+        std::vector<float> att(static_cast<size_t>(config_.n_heads) * config_.max_seq_len);
+
+        {
+            std::lock_guard<std::mutex> lock(ready_mutex_);
+            num_ready_++;
+        }
+        ready_cv_.notify_one();
+
+        while (true) {
+            MicroBatch *mb = stage.in->pop_wait();
+            if (!mb) {
+                stage.out->push_wait(nullptr);
+                return;
+            }
+            PROFILE_SCOPE("pipeline.stage");
+
+            for (int i = 0; i < mb->size; i++) {
+                float *x   = mb->x.data() + static_cast<size_t>(i) * dim;
+                int    pos = mb->positions[i];
+
+                if (first) {
+                    const float *row = placed.token_embedding_table.data() + static_cast<size_t>(mb->tokens[i]) * dim;
+                    std::memcpy(x, row, dim * sizeof(float));
+                }
+
+                for (int l = stage.first_layer; l < stage.last_layer; l++) {
+                    const auto &w      = placed.layers[l];
+                    size_t      offset = (l - stage.first_layer) * layer_cache + mb->slots[i] * slot_cache;
+                    float      *kc     = key_cache.data() + offset;
+                    float      *vc     = value_cache.data() + offset;
+
+                    kernels_.rms_norm(xb.data(), x, w.rms_att_weight.data(), dim);
+                    Ops::matmul(q.data(), xb.data(), w.wq.data(), dim, config_.n_heads * config_.head_dim);
+                    Ops::matmul(k.data(), xb.data(), w.wk.data(), dim, kv_dim);
+                    Ops::matmul(v.data(), xb.data(), w.wv.data(), dim, kv_dim);
+                    kernels_.apply_rope(q.data(),
+                                        k.data(),
+                                        pos,
+                                        config_.head_dim,
+                                        config_.n_heads,
+                                        config_.n_kv_heads,
+                                        config_.rope_theta);
+                    std::memcpy(kc + static_cast<size_t>(pos) * kv_dim, k.data(), kv_dim * sizeof(float));
+                    std::memcpy(vc + static_cast<size_t>(pos) * kv_dim, v.data(), kv_dim * sizeof(float));
+
+                    kernels_.standard_attention(xb2.data(),
+                                                q.data(),
+                                                kc,
+                                                vc,
+                                                att.data(),
+                                                pos,
+                                                config_.head_dim,
+                                                config_.n_heads,
+                                                config_.n_kv_heads,
+                                                config_.max_seq_len);
+                    Ops::matmul_residual(x, xb2.data(), w.wo.data(), config_.n_heads * config_.head_dim, dim);
+
+                    kernels_.rms_norm(xb.data(), x, w.rms_ffn_weight.data(), dim);
+                    Ops::matmul(hb.data(), xb.data(), w.w_gate.data(), dim, config_.hidden_dim);
+                    Ops::matmul(hb2.data(), xb.data(), w.w_up.data(), dim, config_.hidden_dim);
+                    Ops::swiglu(hb.data(), hb.data(), hb2.data(), config_.hidden_dim);
+                    Ops::matmul_residual(x, hb.data(), w.w_down.data(), config_.hidden_dim, dim);
+                }
+
+                if (last && mb->want_logits[i]) {
+                    float *logits = mb->logits.data() + static_cast<size_t>(i) * config_.vocab_size;
+                    kernels_.rms_norm(x, x, placed.rms_final_weight.data(), dim);
+                    Ops::matmul(logits, x, placed.lm_head.data(), dim, config_.vocab_size);
+                }
+            }
+
+            stage.out->push_wait(mb);
+        }
+    }
+};
@@ -0,0 +1,289 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "core/model.hpp"
+#include "core/tokenizer.hpp"
+#include "scheduler/batched_runner.hpp"
+#include "scheduler/benchmark.hpp"
+#include "scheduler/request.hpp"
+#include "scheduler/scheduler.hpp"
+#include "utils/affinity.hpp"
+#include "utils/logger.hpp"
+#include "utils/profiler.hpp"
+
+// ============================================================================
+// Replica Pool - Data-parallel engines sharing one copy of the weights
+//
+// A single engine runs one forward at a time on one core, which leaves most
+// of a many-core node idle for small models. The pool runs N engines in one
+// process: each replica has its own RunState, slice of the KV block pool,
+// Scheduler and BatchedRunner on a thread pinned to its own set of cores,
+// while TransformerWeights is loaded once and shared read-only.
+//
+// The calling thread is the dispatcher: it pulls requests from the source
+// and hands each to the replica with the fewest outstanding requests
+// (ties: most free KV blocks). At most max_in_flight requests are dispatched
+// but unfinished across the pool, which bounds memory for streamed inputs.
+// ============================================================================
+
+class ReplicaPool
+{
+public:
+    // model becomes replica 0; the others share its weights. The KV block
+    // pool (config.num_blocks) is divided between replicas, but each keeps
+    // at least enough blocks for one max_seq_len sequence, even if the total
+    // then exceeds config.num_blocks (logged).
+    ReplicaPool(LlamaModel     &model,
+                Tokenizer      &tokenizer,
+                int             num_replicas,
+                SchedulerConfig scheduler_config,
+                int             max_in_flight,
+                bool            pin_threads = true)
+        : scheduler_config_(scheduler_config)
+        , max_in_flight_(std::max(1, max_in_flight))
+    {
+        num_replicas = std::max(1, num_replicas);
+
+        // Every layer maps its own blocks from the one BlockManager
+        int blocks_per_layer = (model.config.max_seq_len + model.config.block_size - 1) / model.config.block_size;
+        int min_blocks       = model.config.n_layers * blocks_per_layer;
+        int slice            = std::max(min_blocks, model.config.num_blocks / num_replicas);
+        if (static_cast<long long>(slice) * num_replicas > model.config.num_blocks) {
+            LOG_WARNING("KV block pool of ",
+                        model.config.num_blocks,
+                        " blocks is too small for one max_seq_len sequence per replica: using ",
+                        static_cast<long long>(slice) * num_replicas,
+                        " KV blocks in total");
+        }
+
+        std::vector<std::vector<int>> cpu_groups = Affinity::numa_partition(num_replicas);
+
+        for (int i = 0; i < num_replicas; i++) {
+            auto replica   = std::make_unique<Replica>();
+            replica->index = i;
+            if (i == 0) {
+                model.config.num_blocks = slice;
+                model.initialize_paged_attention();
+                replica->model = &model;
+            }
+            else {
+                replica->owned = model.replicate(slice);
+                replica->model = replica->owned.get();
+            }
+            replica->runner = std::make_unique<BatchedRunner>(*replica->model, tokenizer);
+            replica->runner->set_stream_output(false);
+            replica->scheduler = std::make_unique<Scheduler>(scheduler_config_);
+            if (pin_threads) {
+                replica->cpus = cpu_groups[i];
+            }
+            replicas_.push_back(std::move(replica));
+        }
+
+        LOG_INFO("Replica pool: ",
+                 num_replicas,
+                 " engines sharing one weight copy, ",
+                 slice,
+                 " KV blocks each, max_in_flight=",
+                 max_in_flight_);
+    }
+
+    ReplicaPool(const ReplicaPool &)            = delete;
+    ReplicaPool &operator=(const ReplicaPool &) = delete;
+
+    int num_replicas() const { return static_cast<int>(replicas_.size()); }
+
+    // Run every request next_request yields (false = input exhausted). on_finish
+    // is called for each finished request, serialized across replicas.
+    BenchmarkMetrics run(const std::function<bool(Request &)>       &next_request,
+                         const std::function<void(const Request &)> &on_finish)
+    {
+        on_finish_ = &on_finish;
+        in_flight_ = 0;
+
+        auto start = std::chrono::high_resolution_clock::now();
+        for (auto &replica : replicas_) {
+            replica->closed = false;
+            replica->thread = std::thread([this, r = replica.get()] { replica_loop(*r); });
+        }
+
+        while (true) {
+            {
+                std::unique_lock<std::mutex> lock(dispatch_mutex_);
+                space_cv_.wait(lock, [&] { return in_flight_ < max_in_flight_; });
+            }
+
+            auto request = std::make_unique<Request>();
+            if (!next_request(*request)) {
+                break;
+            }
+            request->arrival_time = Request::Clock::now(); // Time in the replica inbox counts as queueing
+
+            Replica &target = pick_replica();
+            target.outstanding++;
+            {
+                std::lock_guard<std::mutex> lock(dispatch_mutex_);
+                in_flight_++;
+            }
+            {
+                std::lock_guard<std::mutex> lock(target.mutex);
+                target.inbox.push_back(std::move(request));
+            }
+            target.cv.notify_one();
+        }
+
+        for (auto &replica : replicas_) {
+            {
+                std::lock_guard<std::mutex> lock(replica->mutex);
+                replica->closed = true;
+            }
+            replica->cv.notify_one();
+        }
+
+        BenchmarkMetrics metrics;
+        for (auto &replica : replicas_) {
+            replica->thread.join();
+            LOG_INFO("Replica ", replica->index, ": ", replica->metrics.total_requests, " requests");
+            metrics.merge(replica->metrics);
+            replica->metrics = BenchmarkMetrics();
+        }
+        auto end              = std::chrono::high_resolution_clock::now();
+        metrics.total_time_ms = std::chrono::duration<double, std::milli>(end - start).count();
+
+        on_finish_ = nullptr;
+        return metrics;
+    }
+
+private:
+    struct Replica
+    {
+        int                            index = 0;
+        LlamaModel                    *model = nullptr;
+        std::unique_ptr<LlamaModel>    owned; // Null for replica 0 (the caller's model)
+        std::unique_ptr<BatchedRunner> runner;
+        std::unique_ptr<Scheduler>     scheduler;
+        std::vector<int>               cpus;
+        BenchmarkMetrics               metrics;
+        std::thread                    thread;
+
+        // Dispatcher -> replica handoff
+        std::mutex                           mutex;
+        std::condition_variable              cv;
+        std::deque<std::unique_ptr<Request>> inbox;
+        bool                                 closed = false;
+
+        // Load signals read by the dispatcher
+        std::atomic<int> outstanding{0};
+        std::atomic<int> free_blocks{0};
+    };
+
+    SchedulerConfig                       scheduler_config_;
+    int                                   max_in_flight_;
+    std::vector<std::unique_ptr<Replica>> replicas_;
+
+    std::mutex              dispatch_mutex_;
+    std::condition_variable space_cv_;
+    int                     in_flight_ = 0;
+
+    std::mutex                                  finish_mutex_;
+    const std::function<void(const Request &)> *on_finish_ = nullptr;
+
+    Replica &pick_replica()
+    {
+        Replica *best = replicas_.front().get();
+        for (auto &replica : replicas_) {
+            int outstanding = replica->outstanding.load(std::memory_order_relaxed);
+            int best_load   = best->outstanding.load(std::memory_order_relaxed);
+            if (outstanding < best_load
+                || (outstanding == best_load
+                    && replica->free_blocks.load(std::memory_order_relaxed)
+                           > best->free_blocks.load(std::memory_order_relaxed))) {
+                best = replica.get();
+            }
+        }
+        return *best;
+    }
+
+    void replica_loop(Replica &replica)
+    {
+        if (!replica.cpus.empty() && !Affinity::pin_current_thread(replica.cpus)) {
+            LOG_WARNING("Replica ", replica.index, ": could not pin thread to its cores");
+        }
+        Profiler::instance().set_thread_name("replica-" + std::to_string(replica.index));
+
+        std::unordered_map<int, std::unique_ptr<Request>> running;
+        std::vector<Request *>                            finished;
+        int                                               iteration = 0;
+
+        while (true) {
+            std::deque<std::unique_ptr<Request>> arrived;
+            {
+                std::unique_lock<std::mutex> lock(replica.mutex);
+                if (!replica.scheduler->has_work()) {
+                    replica.cv.wait(lock, [&] { return !replica.inbox.empty() || replica.closed; });
+                }
+                if (replica.inbox.empty() && replica.closed && !replica.scheduler->has_work()) {
+                    break;
+                }
+                arrived.swap(replica.inbox);
+            }
+
+            finished.clear();
+            for (auto &request : arrived) {
+                Request *admitted = request.get();
+                running.emplace(admitted->id, std::move(request));
+                if (!replica.runner->admit(*admitted, *replica.scheduler)) {
+                    finished.push_back(admitted);
+                }
+            }
+
+            if (replica.scheduler->has_work() && !replica.runner->step(*replica.scheduler, iteration++, &finished)) {
+                // Nothing fits the batch token budget: fail what is queued and start over
+                LOG_ERROR("Replica ",
+                          replica.index,
+                          ": scheduler made no progress, failing ",
+                          running.size(),
+                          " requests");
+                for (auto &[id, request] : running) {
+                    if (request->status != RequestStatus::FAILED) {
+                        request->status = RequestStatus::FAILED;
+                        finished.push_back(request.get());
+                    }
+                }
+                replica.scheduler = std::make_unique<Scheduler>(scheduler_config_);
+            }
+
+            for (Request *request : finished) {
+                if (request->status != RequestStatus::FAILED) {
+                    replica.metrics.add_request(*request);
+                }
+                {
+                    std::lock_guard<std::mutex> lock(finish_mutex_);
+                    (*on_finish_)(*request);
+                }
+                replica.runner->release(*request);
+                running.erase(request->id);
+                replica.outstanding--;
+                {
+                    std::lock_guard<std::mutex> lock(dispatch_mutex_);
+                    in_flight_--;
+                }
+                space_cv_.notify_one();
+            }
+
+            BlockManager *blocks = replica.model->block_manager.get();
+            replica.free_blocks.store(blocks ? blocks->get_num_free_blocks() : 0, std::memory_order_relaxed);
+        }
+    }
+};
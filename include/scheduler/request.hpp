@@ -1,8 +1,13 @@
 #pragma once
 
+#include <chrono>
 #include <string>
+#include <utility>
 #include <vector>
 
+#include "core/sampler.hpp"
+#include "ops/logprobs.hpp"
+
 // ============================================================================
 // Request Status - Lifecycle states for request processing
 // ============================================================================
@@ -39,9 +44,13 @@ inline const char *request_status_to_string(RequestStatus status)
 
 struct SamplingParams
 {
-    float temperature = 1.0f;
-    float top_p       = 0.9f;
-    int   max_tokens  = 256;
+    float temperature  = 1.0f;
+    float top_p        = 0.9f;
+    int   max_tokens   = 256;
+    bool  logprobs     = false; // Report each generated token's log-probability
+    int   top_logprobs = 0;     // ... and this many most likely alternatives
+
+    static constexpr int MAX_TOP_LOGPROBS = 20; // Larger requests are rejected
 
     SamplingParams() = default;
     SamplingParams(float temp, float topp, int max_tok)
@@ -64,6 +73,7 @@ struct Request
     std::string      prompt;
     std::vector<int> prompt_tokens;
     SamplingParams   sampling_params;
+    std::string      adapter; // LoRA adapter name (empty = base model)
 
     // State
     RequestStatus    status      = RequestStatus::PENDING;
@@ -76,10 +86,22 @@ struct Request
     // Output
     std::string output_text;
 
+    // Per generated token, only with sampling_params.logprobs
+    std::vector<float>                          token_logprobs;
+    std::vector<std::vector<Ops::TokenLogprob>> top_logprobs;
+
     // Metrics
     double prefill_time_ms = 0.0;
     double decode_time_ms  = 0.0;
-    int    num_prompt_tokens() const { return static_cast<int>(prompt_tokens.size()); }
+
+    // Timeline (for latency percentiles)
+    using Clock     = std::chrono::steady_clock;
+    using TimePoint = Clock::time_point;
+    TimePoint              arrival_time;   // Submitted to the engine
+    TimePoint              scheduled_time; // Left the pending queue
+    std::vector<TimePoint> token_times;    // Emission time of each generated token
+
+    int num_prompt_tokens() const { return static_cast<int>(prompt_tokens.size()); }
     int    num_generated_tokens() const { return static_cast<int>(generated_tokens.size()); }
     int    total_tokens() const { return num_prompt_tokens() + num_generated_tokens(); }
 
@@ -94,8 +116,57 @@ struct Request
     bool is_finished() const { return status == RequestStatus::FINISHED || status == RequestStatus::FAILED; }
 
     bool can_generate_more() const { return num_generated_tokens() < sampling_params.max_tokens; }
+
+    // Record a generated token together with its emission time
+    void add_token(int token)
+    {
+        generated_tokens.push_back(token);
+        token_times.push_back(Clock::now());
+    }
+
+    // Latency breakdown (milliseconds); 0 when the event has not happened yet
+    double queueing_delay_ms() const { return elapsed_ms(arrival_time, scheduled_time); }
+    double ttft_ms() const { return token_times.empty() ? 0.0 : elapsed_ms(arrival_time, token_times.front()); }
+    double e2e_latency_ms() const { return token_times.empty() ? 0.0 : elapsed_ms(arrival_time, token_times.back()); }
+
+    // Time per output token after the first
+    double tpot_ms() const
+    {
+        if (token_times.size() < 2) {
+            return 0.0;
+        }
+        return elapsed_ms(token_times.front(), token_times.back()) / static_cast<double>(token_times.size() - 1);
+    }
+
+    static double elapsed_ms(TimePoint from, TimePoint to)
+    {
+        if (from == TimePoint{} || to == TimePoint{}) {
+            return 0.0;
+        }
+        return std::chrono::duration<double, std::milli>(to - from).count();
+    }
 };
 
+// Sample the request's next token from logits and record it, together with
+// its log-probabilities when the request asked for them
+inline int sample_next_token(Sampler &sampler, float *logits, Request &request)
+{
+    const SamplingParams &params = request.sampling_params;
+    if (!params.logprobs) {
+        int token = sampler.sample(logits);
+        request.add_token(token);
+        return token;
+    }
+
+    float                          logprob;
+    std::vector<Ops::TokenLogprob> top;
+    int                            token = sampler.sample(logits, logprob, top, params.top_logprobs);
+    request.add_token(token);
+    request.token_logprobs.push_back(logprob);
+    request.top_logprobs.push_back(std::move(top));
+    return token;
+}
+
 // ============================================================================
 // Request Batch - Collection of requests for batch processing
 // ============================================================================
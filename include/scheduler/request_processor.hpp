@@ -7,6 +7,7 @@
 #include "core/sampler.hpp"
 #include "core/tokenizer.hpp"
 #include "scheduler/benchmark.hpp"
+#include "scheduler/engine_metrics.hpp"
 #include "scheduler/request.hpp"
 #include "utils/logger.hpp"
 
@@ -26,7 +27,21 @@ public:
     void process(Request &request, bool stream_output = true)
     {
         request.prompt_tokens = tokenizer_.encode(request.prompt, true, false);
-        request.status        = RequestStatus::PREFILLING;
+        try {
+            model_.use_adapter(request.adapter);
+        }
+        catch (const std::exception &e) {
+            LOG_ERROR("Request ", request.id, ": ", e.what());
+            request.status = RequestStatus::FAILED;
+            return;
+        }
+        request.status = RequestStatus::PREFILLING;
+
+        // Without a scheduler the request leaves the queue as soon as we start on it
+        request.scheduled_time = Request::Clock::now();
+        if (request.arrival_time == Request::TimePoint{}) {
+            request.arrival_time = request.scheduled_time;
+        }
 
         Sampler sampler(model_.config.vocab_size,
                         request.sampling_params.temperature,
@@ -36,11 +51,13 @@ public:
         // Prefill phase
         auto prefill_start = std::chrono::high_resolution_clock::now();
 
-        int pos = 0;
-        for (size_t i = 0; i < request.prompt_tokens.size() - 1; i++) {
-            model_.forward(request.prompt_tokens[i], pos);
-            pos++;
+        int prefill_len = request.num_prompt_tokens() - 1;
+        int pos         = model_.restore_prefix(request.prompt_tokens, prefill_len);
+        for (; pos < prefill_len; pos++) {
+            model_.forward(request.prompt_tokens[pos], pos);
         }
+        model_.persist_prefix(request.prompt_tokens, prefill_len);
+        EngineMetrics::instance().prompt_tokens.inc(request.num_prompt_tokens());
 
         auto prefill_end        = std::chrono::high_resolution_clock::now();
         request.prefill_time_ms = std::chrono::duration<double, std::milli>(prefill_end - prefill_start).count();
@@ -50,13 +67,16 @@ public:
         int token           = request.prompt_tokens.back();
         request.current_pos = pos;
 
+        if (stream_output) {
+            Logger::flush();
+        }
         auto decode_start = std::chrono::high_resolution_clock::now();
 
         while (request.can_generate_more()) {
             model_.forward(token, request.current_pos);
 
-            int next_token = sampler.sample(model_.state.logits.data());
-            request.generated_tokens.push_back(next_token);
+            int next_token = sample_next_token(sampler, model_.state.logits.data(), request);
+            EngineMetrics::instance().generation_tokens.inc();
 
             std::string piece = tokenizer_.decode(next_token);
             request.output_text += piece;
@@ -69,11 +89,11 @@ public:
             token = next_token;
             request.current_pos++;
 
-            if (request.current_pos >= model_.config.max_seq_len)
+            if (model_.context_full(request.current_pos))
                 break;
 
-            // Check for EOS (token 2 for Llama models)
-            if (next_token == 2)
+            // Check for EOS
+            if (next_token == model_.config.eos_token_id)
                 break;
         }
 
@@ -81,6 +101,7 @@ public:
         request.decode_time_ms = std::chrono::duration<double, std::milli>(decode_end - decode_start).count();
 
         request.status = RequestStatus::FINISHED;
+        EngineMetrics::instance().observe_finished(request);
 
         if (model_.config.use_paged_attention && model_.block_manager) {
             model_.block_manager->free_request(request.id);
@@ -109,9 +130,28 @@ private:
 
 inline void BenchmarkMetrics::add_request(const Request &request)
 {
+    if (request.status == RequestStatus::FAILED) {
+        return;
+    }
     total_requests++;
     total_prompt_tokens += request.num_prompt_tokens();
     total_generated_tokens += request.num_generated_tokens();
     total_prefill_time_ms += request.prefill_time_ms;
     total_decode_time_ms += request.decode_time_ms;
+
+    if (slo.enabled() && slo.met_by(request)) {
+        slo_met_requests++;
+    }
+
+    queueing_delay.record_ms(request.queueing_delay_ms());
+    if (!request.token_times.empty()) {
+        ttft.record_ms(request.ttft_ms());
+        e2e_latency.record_ms(request.e2e_latency_ms());
+    }
+    if (request.token_times.size() >= 2) {
+        tpot.record_ms(request.tpot_ms());
+    }
+    for (size_t i = 1; i < request.token_times.size(); i++) {
+        inter_token_latency.record_ms(Request::elapsed_ms(request.token_times[i - 1], request.token_times[i]));
+    }
 }
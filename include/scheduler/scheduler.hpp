@@ -4,8 +4,10 @@
 #include <queue>
 #include <vector>
 
+#include "scheduler/engine_metrics.hpp"
 #include "scheduler/request.hpp"
 #include "utils/logger.hpp"
+#include "utils/profiler.hpp"
 
 // ============================================================================
 // Scheduler Configuration
@@ -58,13 +60,18 @@ public:
     void add_request(Request *request)
     {
         request->status = RequestStatus::PENDING;
+        if (request->arrival_time == Request::TimePoint{}) {
+            request->arrival_time = Request::Clock::now();
+        }
         pending_queue_.push(request);
-        LOG_INFO("Scheduler: Added request ", request->id, " to queue");
+        publish_queue_metrics();
+        LOG_DEBUG("Scheduler: Added request ", request->id, " to queue");
     }
 
     // Schedule next batch for execution
     ScheduledBatch schedule()
     {
+        PROFILE_SCOPE("scheduler.schedule");
         ScheduledBatch batch;
 
         // First, add decode requests (they have priority - shorter)
@@ -91,7 +98,8 @@ public:
             }
 
             pending_queue_.pop();
-            req->status = RequestStatus::PREFILLING;
+            req->status         = RequestStatus::PREFILLING;
+            req->scheduled_time = Request::Clock::now();
             running_requests_.push_back(req);
             batch.prefill_requests.push_back(req);
 
@@ -99,21 +107,31 @@ public:
             remaining_slots--;
         }
 
+        publish_queue_metrics();
         return batch;
     }
 
     // Update request status after batch execution
     void update_after_prefill(Request *request) { request->status = RequestStatus::DECODING; }
 
-    // Mark request as finished and remove from running
+    // Mark request as finished (unless it failed) and remove from running
     void finish_request(Request *request)
     {
-        request->status = RequestStatus::FINISHED;
+        if (request->status != RequestStatus::FAILED) {
+            request->status = RequestStatus::FINISHED;
+        }
         running_requests_.erase(std::remove(running_requests_.begin(), running_requests_.end(), request),
                                 running_requests_.end());
-        LOG_INFO("Scheduler: Request ", request->id, " finished");
+        publish_queue_metrics();
+        LOG_DEBUG("Scheduler: Request ", request->id, " finished");
     }
 
+    // Whether a request could ever be scheduled: a prompt longer than the
+    // batch token budget would block the head of the queue forever
+    bool fits(const Request &request) const { return request.num_prompt_tokens() <= config_.max_tokens_per_batch; }
+
+    int max_tokens_per_batch() const { return config_.max_tokens_per_batch; }
+
     // Check if there's more work to do
     bool has_pending() const { return !pending_queue_.empty(); }
     bool has_running() const { return !running_requests_.empty(); }
@@ -127,4 +145,13 @@ private:
     SchedulerConfig        config_;
     std::queue<Request *>  pending_queue_;
     std::vector<Request *> running_requests_;
+
+    GaugeShare waiting_gauge_{EngineMetrics::instance().num_requests_waiting};
+    GaugeShare running_gauge_{EngineMetrics::instance().num_requests_running};
+
+    void publish_queue_metrics()
+    {
+        waiting_gauge_.set(num_pending());
+        running_gauge_.set(num_running());
+    }
 };
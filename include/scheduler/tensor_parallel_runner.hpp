@@ -0,0 +1,403 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <signal.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#ifdef __linux__
+#include <sys/prctl.h>
+#endif
+
+#include "core/attention.hpp"
+#include "core/kernel_table.hpp"
+#include "core/model.hpp"
+#include "core/sampler.hpp"
+#include "core/tokenizer.hpp"
+#include "ops/activation.hpp"
+#include "ops/linear.hpp"
+#include "ops/normalization.hpp"
+#include "ops/positional.hpp"
+#include "scheduler/benchmark.hpp"
+#include "scheduler/engine_metrics.hpp"
+#include "scheduler/request.hpp"
+#include "utils/affinity.hpp"
+#include "utils/logger.hpp"
+#include "utils/profiler.hpp"
+#include "utils/shm_communicator.hpp"
+
+// ============================================================================
+// Tensor Parallel Runner - Megatron-style sharding across local processes
+//
+// Rank 0 is the calling process; ranks 1..N-1 are forked from it and each is
+// pinned to its own core group (one NUMA node where the machine has several).
+// Every rank keeps only its shard, built after the fork from the pinned
+// process so first-touch places it in local memory:
+//   - wq/wk/wv and w_gate/w_up: split by output rows (heads / hidden units)
+//   - wo and w_down: split by input columns, producing partial sums
+//   - lm_head: split by vocabulary rows
+//   - embedding and norm weights: replicated (small next to the layers)
+// The KV cache of a rank holds only its own KV heads.
+//
+// Per token, rank 0 broadcasts (token, pos) and all ranks run the layers in
+// lockstep, with a shared-memory all-reduce after the attention output
+// projection and after the FFN down projection. Logits are gathered into a
+// shared row from which rank 0 samples.
+//
+// Sequences run one at a time (the parallelism is within each token), with
+// a contiguous per-rank KV cache; PagedAttention and the prefix KV disk
+// store are not used in this mode.
+// ============================================================================
+
+class TensorParallelRunner
+{
+public:
+    // Forks the worker ranks. The model's full weights are released once
+    // rank 0 has built its shard (model.weights is null afterwards).
+    TensorParallelRunner(LlamaModel &model, Tokenizer &tokenizer, int world_size)
+        : tokenizer_(tokenizer)
+        , config_(model.config)
+        , kernels_(model.kernels)
+        , world_(std::max(1, world_size))
+    {
+        if (config_.n_kv_heads % world_ != 0) {
+            throw std::runtime_error("--tensor-parallel " + std::to_string(world_) + " does not divide "
+                                     + std::to_string(config_.n_kv_heads) + " KV heads");
+        }
+
+        comm_ = std::make_unique<ShmCommunicator>(world_, config_.dim, config_.vocab_size);
+        std::vector<std::vector<int>> cpu_groups = Affinity::numa_partition(world_);
+
+        Logger::flush();
+        for (int rank = 1; rank < world_; rank++) {
+            pid_t pid = fork();
+            if (pid < 0) {
+                throw std::runtime_error("fork() failed for tensor-parallel rank " + std::to_string(rank));
+            }
+            if (pid == 0) {
+                worker_main(rank, cpu_groups[rank], *model.weights);
+            }
+            workers_.push_back(pid);
+        }
+        comm_->watch(workers_);
+
+        if (world_ > 1 && !Affinity::pin_current_thread(cpu_groups[0])) {
+            LOG_WARNING("Tensor-parallel rank 0: could not pin to its cores");
+        }
+        init_rank(0, *model.weights);
+        model.weights.reset();
+
+        LOG_INFO("Tensor parallel: ",
+                 world_,
+                 " processes, ",
+                 config_.n_heads / world_,
+                 " query heads and ",
+                 config_.n_kv_heads / world_,
+                 " KV heads per rank");
+    }
+
+    ~TensorParallelRunner()
+    {
+        if (workers_.empty()) {
+            return;
+        }
+        try {
+            comm_->command().op = OP_STOP;
+            comm_->barrier();
+        }
+        catch (const std::exception &) {
+            // A rank died; handled below
+        }
+        // After a failure the surviving ranks may never reach a barrier again
+        for (pid_t pid : workers_) {
+            if (comm_->aborted()) {
+                kill(pid, SIGKILL);
+            }
+        }
+        for (pid_t pid : workers_) {
+            int status = 0;
+            waitpid(pid, &status, 0);
+        }
+    }
+
+    TensorParallelRunner(const TensorParallelRunner &)            = delete;
+    TensorParallelRunner &operator=(const TensorParallelRunner &) = delete;
+
+    // Logits for token at pos, computed by all ranks. Valid until the next call.
+    float *forward(int token, int pos)
+    {
+        PROFILE_SCOPE("tp.forward");
+        ShmCommunicator::Command &cmd = comm_->command();
+        cmd.op                        = OP_FORWARD;
+        cmd.token                     = token;
+        cmd.pos                       = pos;
+        comm_->barrier();
+        compute(token, pos);
+        return comm_->gather_buffer();
+    }
+
+    // Run every request next_request yields (false = input exhausted), one at
+    // a time; each is passed to on_finish as soon as it completes.
+    BenchmarkMetrics run(const std::function<bool(Request &)>       &next_request,
+                         const std::function<void(const Request &)> &on_finish)
+    {
+        BenchmarkMetrics metrics;
+        auto             start = std::chrono::high_resolution_clock::now();
+
+        Request request;
+        while (next_request(request)) {
+            generate(request);
+            if (request.status != RequestStatus::FAILED) {
+                metrics.add_request(request);
+            }
+            on_finish(request);
+            request = Request();
+        }
+
+        metrics.total_time_ms = elapsed_ms(start);
+        return metrics;
+    }
+
+private:
+    enum : int { OP_FORWARD = 1, OP_STOP = 2 };
+
+    Tokenizer                       &tokenizer_;
+    Config                           config_;
+    KernelTable                      kernels_;
+    int                              world_;
+    int                              rank_ = 0;
+    std::unique_ptr<ShmCommunicator> comm_;
+    std::vector<pid_t>               workers_;
+
+    // This rank's shard; matrices keep the [out, in] layout of TransformerWeights
+    TransformerWeights shard_;
+    int                q_dim_       = 0; // Local query heads * head_dim
+    int                kv_dim_      = 0; // Local KV heads * head_dim
+    int                hidden_dim_  = 0; // Local FFN hidden units
+    int                vocab_begin_ = 0;
+    int                vocab_end_   = 0;
+
+    // Activations and KV cache [n_layers, max_seq_len, kv_dim_] of this rank
+    std::vector<float> x_, xb_, xb2_, q_, k_, v_, hb_, hb2_, att_;
+    std::vector<float> key_cache_, value_cache_;
+
+    static double elapsed_ms(std::chrono::high_resolution_clock::time_point since)
+    {
+        return std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - since).count();
+    }
+
+    // Rows [begin, end) of a row-major [rows, cols] matrix
+    static std::vector<float> slice_rows(const Tensor &m, int cols, int begin, int end)
+    {
+        return std::vector<float>(m.begin() + static_cast<size_t>(begin) * cols,
+                                  m.begin() + static_cast<size_t>(end) * cols);
+    }
+
+    // Columns [begin, end) of a row-major [rows, cols] matrix
+    static std::vector<float> slice_cols(const Tensor &m, int rows, int cols, int begin, int end)
+    {
+        std::vector<float> out(static_cast<size_t>(rows) * (end - begin));
+        for (int r = 0; r < rows; r++) {
+            std::memcpy(out.data() + static_cast<size_t>(r) * (end - begin),
+                        m.data() + static_cast<size_t>(r) * cols + begin,
+                        (end - begin) * sizeof(float));
+        }
+        return out;
+    }
+
+    // Copy this rank's shard out of the full weights and allocate its state.
+    // Replicated tensors that are mapped from the model file are shared.
+    void init_rank(int rank, const TransformerWeights &full)
+    {
+        rank_        = rank;
+        int dim      = config_.dim;
+        int head_dim = config_.head_dim;
+        q_dim_       = config_.n_heads / world_ * head_dim;
+        kv_dim_      = config_.n_kv_heads / world_ * head_dim;
+
+        int hidden_begin = static_cast<int>(static_cast<int64_t>(config_.hidden_dim) * rank / world_);
+        int hidden_end   = static_cast<int>(static_cast<int64_t>(config_.hidden_dim) * (rank + 1) / world_);
+        hidden_dim_      = hidden_end - hidden_begin;
+        vocab_begin_     = static_cast<int>(static_cast<int64_t>(config_.vocab_size) * rank / world_);
+        vocab_end_       = static_cast<int>(static_cast<int64_t>(config_.vocab_size) * (rank + 1) / world_);
+
+        shard_.token_embedding_table = full.token_embedding_table.share();
+        shard_.rms_final_weight      = full.rms_final_weight.share();
+        shard_.lm_head               = slice_rows(full.lm_head, dim, vocab_begin_, vocab_end_);
+        shard_.layers.resize(config_.n_layers);
+        for (int l = 0; l < config_.n_layers; l++) {
+            const auto &src = full.layers[l];
+            auto       &dst = shard_.layers[l];
+            dst.rms_att_weight = src.rms_att_weight.share();
+            dst.rms_ffn_weight = src.rms_ffn_weight.share();
+            dst.wq             = slice_rows(src.wq, dim, rank * q_dim_, (rank + 1) * q_dim_);
+            dst.wk             = slice_rows(src.wk, dim, rank * kv_dim_, (rank + 1) * kv_dim_);
+            dst.wv             = slice_rows(src.wv, dim, rank * kv_dim_, (rank + 1) * kv_dim_);
+            dst.wo             = slice_cols(src.wo, dim, q_dim_ * world_, rank * q_dim_, (rank + 1) * q_dim_);
+            dst.w_gate         = slice_rows(src.w_gate, dim, hidden_begin, hidden_end);
+            dst.w_up           = slice_rows(src.w_up, dim, hidden_begin, hidden_end);
+            dst.w_down         = slice_cols(src.w_down, dim, config_.hidden_dim, hidden_begin, hidden_end);
+        }
+
+        x_.resize(dim);
+        xb_.resize(dim);
+        xb2_.resize(q_dim_);
+        q_.resize(q_dim_);
+        k_.resize(kv_dim_);
+        v_.resize(kv_dim_);
+        hb_.resize(hidden_dim_);
+        hb2_.resize(hidden_dim_);
+        att_.resize(static_cast<size_t>(config_.n_heads / world_) * config_.max_seq_len);
+        key_cache_.resize(static_cast<size_t>(config_.n_layers) * config_.max_seq_len * kv_dim_);
+        value_cache_.resize(key_cache_.size());
+    }
+
+    [[noreturn]] void worker_main(int rank, const std::vector<int> &cpus, const TransformerWeights &full)
+    {
+#ifdef __linux__
+        prctl(PR_SET_PDEATHSIG, SIGTERM); // Never outlive rank 0
+#endif
+        int code = 0;
+        try {
+            if (!Affinity::pin_current_thread(cpus)) {
+                LOG_WARNING("Tensor-parallel rank ", rank, ": could not pin to its cores");
+            }
+            init_rank(rank, full);
+            while (true) {
+                comm_->barrier();
+                const ShmCommunicator::Command &cmd = comm_->command();
+                if (cmd.op == OP_STOP) {
+                    break;
+                }
+                compute(cmd.token, cmd.pos);
+            }
+        }
+        catch (const std::exception &e) {
+            LOG_ERROR("Tensor-parallel rank ", rank, ": ", e.what());
+            comm_->abort();
+            code = 1;
+        }
+        Logger::flush();
+        _exit(code); // Skip the parent's atexit handlers and static destructors
+    }
+
+    // One token through this rank's shard; every rank runs this in lockstep
+    void compute(int token, int pos)
+    {
+        int    dim      = config_.dim;
+        int    head_dim = config_.head_dim;
+        float *x        = x_.data();
+
+        std::memcpy(x, shard_.token_embedding_table.data() + static_cast<size_t>(token) * dim, dim * sizeof(float));
+
+        for (int l = 0; l < config_.n_layers; l++) {
+            const auto &w      = shard_.layers[l];
+            size_t      offset = static_cast<size_t>(l) * config_.max_seq_len * kv_dim_;
+            float      *kc     = key_cache_.data() + offset;
+            float      *vc     = value_cache_.data() + offset;
+
+            kernels_.rms_norm(xb_.data(), x, w.rms_att_weight.data(), dim);
+            Ops::matmul(q_.data(), xb_.data(), w.wq.data(), dim, q_dim_);
+            Ops::matmul(k_.data(), xb_.data(), w.wk.data(), dim, kv_dim_);
+            Ops::matmul(v_.data(), xb_.data(), w.wv.data(), dim, kv_dim_);
+            kernels_.apply_rope(q_.data(),
+                                k_.data(),
+                                pos,
+                                head_dim,
+                                config_.n_heads / world_,
+                                config_.n_kv_heads / world_,
+                                config_.rope_theta);
+            std::memcpy(kc + static_cast<size_t>(pos) * kv_dim_, k_.data(), kv_dim_ * sizeof(float));
+            std::memcpy(vc + static_cast<size_t>(pos) * kv_dim_, v_.data(), kv_dim_ * sizeof(float));
+
+            kernels_.standard_attention(xb2_.data(),
+                                        q_.data(),
+                                        kc,
+                                        vc,
+                                        att_.data(),
+                                        pos,
+                                        head_dim,
+                                        config_.n_heads / world_,
+                                        config_.n_kv_heads / world_,
+                                        config_.max_seq_len);
+            Ops::matmul(xb_.data(), xb2_.data(), w.wo.data(), q_dim_, dim);
+            comm_->all_reduce(rank_, xb_.data(), dim);
+            for (int j = 0; j < dim; j++)
+                x[j] += xb_[j];
+
+            kernels_.rms_norm(xb_.data(), x, w.rms_ffn_weight.data(), dim);
+            Ops::matmul(hb_.data(), xb_.data(), w.w_gate.data(), dim, hidden_dim_);
+            Ops::matmul(hb2_.data(), xb_.data(), w.w_up.data(), dim, hidden_dim_);
+            Ops::swiglu(hb_.data(), hb_.data(), hb2_.data(), hidden_dim_);
+            Ops::matmul(xb_.data(), hb_.data(), w.w_down.data(), hidden_dim_, dim);
+            comm_->all_reduce(rank_, xb_.data(), dim);
+            for (int j = 0; j < dim; j++)
+                x[j] += xb_[j];
+        }
+
+        kernels_.rms_norm(x, x, shard_.rms_final_weight.data(), dim);
+        Ops::matmul(comm_->gather_buffer() + vocab_begin_, x, shard_.lm_head.data(), dim, vocab_end_ - vocab_begin_);
+        comm_->barrier(); // Every slice of the logits is written
+    }
+
+    // Same flow as RequestProcessor::process, over the sharded forward
+    void generate(Request &request)
+    {
+        request.prompt_tokens  = tokenizer_.encode(request.prompt, true, false);
+        request.scheduled_time = Request::Clock::now();
+        if (request.arrival_time == Request::TimePoint{}) {
+            request.arrival_time = request.scheduled_time;
+        }
+        if (request.num_prompt_tokens() > config_.max_seq_len) {
+            LOG_WARNING("Request ",
+                        request.id,
+                        ": prompt of ",
+                        request.num_prompt_tokens(),
+                        " tokens exceeds max_seq_len");
+            request.status = RequestStatus::FAILED;
+            return;
+        }
+
+        request.status = RequestStatus::PREFILLING;
+        Sampler sampler(config_.vocab_size,
+                        request.sampling_params.temperature,
+                        request.sampling_params.top_p,
+                        std::time(nullptr) + request.id);
+
+        auto prefill_start = std::chrono::high_resolution_clock::now();
+        int  prefill_len   = request.num_prompt_tokens() - 1;
+        for (int pos = 0; pos < prefill_len; pos++) {
+            forward(request.prompt_tokens[pos], pos);
+        }
+        EngineMetrics::instance().prompt_tokens.inc(request.num_prompt_tokens());
+        request.prefill_time_ms = elapsed_ms(prefill_start);
+
+        request.status      = RequestStatus::DECODING;
+        request.current_pos = prefill_len;
+        int  token          = request.prompt_tokens.back();
+        auto decode_start   = std::chrono::high_resolution_clock::now();
+
+        while (request.can_generate_more()) {
+            int next_token = sample_next_token(sampler, forward(token, request.current_pos), request);
+            request.output_text += tokenizer_.decode(next_token);
+            EngineMetrics::instance().generation_tokens.inc();
+
+            token = next_token;
+            request.current_pos++;
+            if (request.current_pos >= config_.max_seq_len || next_token == config_.eos_token_id) {
+                break;
+            }
+        }
+
+        request.decode_time_ms = elapsed_ms(decode_start);
+        request.status         = RequestStatus::FINISHED;
+        EngineMetrics::instance().observe_finished(request);
+    }
+};
@@ -0,0 +1,153 @@
+#pragma once
+
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+// ============================================================================
+// CPU Affinity - Core groups and thread pinning for data/pipeline parallelism
+// ============================================================================
+
+namespace Affinity {
+
+// CPUs this process may run on, in ascending order
+inline std::vector<int> available_cpus()
+{
+    std::vector<int> cpus;
+#ifdef __linux__
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    if (sched_getaffinity(0, sizeof(set), &set) == 0) {
+        for (int cpu = 0; cpu < CPU_SETSIZE; cpu++) {
+            if (CPU_ISSET(cpu, &set)) {
+                cpus.push_back(cpu);
+            }
+        }
+    }
+#endif
+    if (cpus.empty()) {
+        for (int cpu = 0; cpu < static_cast<int>(std::max(1u, std::thread::hardware_concurrency())); cpu++) {
+            cpus.push_back(cpu);
+        }
+    }
+    return cpus;
+}
+
+// Parse a sysfs cpulist such as "0-3,8-11"
+inline std::vector<int> parse_cpu_list(const std::string &text)
+{
+    std::vector<int>  cpus;
+    std::stringstream ss(text);
+    std::string       range;
+    while (std::getline(ss, range, ',')) {
+        if (range.empty() || range == "\n") {
+            continue;
+        }
+        size_t dash  = range.find('-');
+        int    first = std::stoi(range.substr(0, dash));
+        int    last  = dash == std::string::npos ? first : std::stoi(range.substr(dash + 1));
+        for (int cpu = first; cpu <= last; cpu++) {
+            cpus.push_back(cpu);
+        }
+    }
+    return cpus;
+}
+
+// Usable CPUs grouped by NUMA node; a single group when the topology is
+// unknown (non-Linux, no sysfs) or the machine has one node
+inline std::vector<std::vector<int>> numa_nodes()
+{
+    std::vector<int>              usable = available_cpus();
+    std::vector<std::vector<int>> nodes;
+#ifdef __linux__
+    for (int node = 0;; node++) {
+        std::ifstream file("/sys/devices/system/node/node" + std::to_string(node) + "/cpulist");
+        if (!file.is_open()) {
+            break;
+        }
+        std::string list;
+        std::getline(file, list);
+        std::vector<int> cpus;
+        for (int cpu : parse_cpu_list(list)) {
+            if (std::find(usable.begin(), usable.end(), cpu) != usable.end()) {
+                cpus.push_back(cpu);
+            }
+        }
+        if (!cpus.empty()) {
+            nodes.push_back(std::move(cpus));
+        }
+    }
+#endif
+    if (nodes.empty()) {
+        nodes.push_back(std::move(usable));
+    }
+    return nodes;
+}
+
+// Split cpus into `parts` contiguous groups (adjacent ids usually share a
+// core complex). With fewer cpus than parts, groups wrap around and overlap.
+inline std::vector<std::vector<int>> partition_cpus(const std::vector<int> &cpus, int parts)
+{
+    std::vector<std::vector<int>> groups(parts);
+    int                           n = static_cast<int>(cpus.size());
+    for (int p = 0; p < parts; p++) {
+        int begin = n >= parts ? p * n / parts : p % n;
+        int end   = n >= parts ? (p + 1) * n / parts : begin + 1;
+        groups[p].assign(cpus.begin() + begin, cpus.begin() + end);
+    }
+    return groups;
+}
+
+// Split the machine into `parts` core groups that never straddle a NUMA
+// node: consecutive parts are spread evenly over nodes, then each node's
+// CPUs are divided between the parts placed on it.
+inline std::vector<std::vector<int>> numa_partition(int parts)
+{
+    std::vector<std::vector<int>> nodes = numa_nodes();
+    int                           n     = static_cast<int>(nodes.size());
+    std::vector<std::vector<int>> groups(parts);
+
+    for (int node = 0; node < n; node++) {
+        // Parts p with p * n / parts == node live on this node
+        std::vector<int> members;
+        for (int p = 0; p < parts; p++) {
+            if (p * n / parts == node) {
+                members.push_back(p);
+            }
+        }
+        if (members.empty()) {
+            continue;
+        }
+        auto split = partition_cpus(nodes[node], static_cast<int>(members.size()));
+        for (size_t i = 0; i < members.size(); i++) {
+            groups[members[i]] = std::move(split[i]);
+        }
+    }
+    return groups;
+}
+
+// Restrict the calling thread to cpus. Returns false where unsupported.
+inline bool pin_current_thread(const std::vector<int> &cpus)
+{
+#ifdef __linux__
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    for (int cpu : cpus) {
+        CPU_SET(cpu, &set);
+    }
+    return pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+#else
+    (void)cpus;
+    return false;
+#endif
+}
+
+} // namespace Affinity
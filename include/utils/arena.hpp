@@ -0,0 +1,95 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdlib>
+#include <cstring>
+#include <initializer_list>
+#include <memory>
+#include <new>
+#include <span>
+#include <stdexcept>
+#include <string>
+
+// ============================================================================
+// Arena - One aligned allocation carved into activation buffers
+//
+// reserve() allocates (and zero-fills) the whole block up front, sized from
+// the worst-case shapes; alloc() then hands out cache-line aligned spans by
+// bumping an offset, so steady-state steps never touch the heap. A step that
+// needs scratch takes a mark() and release()s it when done, and the buffers
+// it carved are reused by the next step. peak() is the high-water mark, i.e.
+// the activation memory a run actually needed.
+// ============================================================================
+
+class Arena
+{
+public:
+    static constexpr size_t ALIGNMENT = 64;
+
+    Arena() = default;
+
+    Arena(const Arena &)            = delete;
+    Arena &operator=(const Arena &) = delete;
+    Arena(Arena &&)                 = default;
+    Arena &operator=(Arena &&)      = default;
+
+    static size_t align_up(size_t bytes) { return (bytes + ALIGNMENT - 1) / ALIGNMENT * ALIGNMENT; }
+
+    // Bytes needed to alloc() float buffers of these element counts
+    static size_t footprint(std::initializer_list<size_t> counts)
+    {
+        size_t bytes = 0;
+        for (size_t count : counts) {
+            bytes += align_up(count * sizeof(float));
+        }
+        return bytes;
+    }
+
+    // Replace the block with a zeroed one of at least bytes; spans handed out
+    // before are invalidated
+    void reserve(size_t bytes)
+    {
+        capacity_ = align_up(bytes);
+        used_     = 0;
+        base_.reset();
+        if (capacity_ > 0) {
+            base_.reset(static_cast<unsigned char *>(std::aligned_alloc(ALIGNMENT, capacity_)));
+            if (!base_) {
+                throw std::bad_alloc();
+            }
+            std::memset(base_.get(), 0, capacity_);
+        }
+    }
+
+    std::span<float> alloc(size_t count)
+    {
+        size_t bytes = align_up(count * sizeof(float));
+        if (used_ + bytes > capacity_) {
+            throw std::runtime_error("Activation arena exhausted: " + std::to_string(used_ + bytes) + " of "
+                                     + std::to_string(capacity_) + " bytes");
+        }
+        float *data = reinterpret_cast<float *>(base_.get() + used_);
+        used_ += bytes;
+        peak_ = std::max(peak_, used_);
+        return {data, count};
+    }
+
+    size_t mark() const { return used_; }
+    void   release(size_t mark) { used_ = mark; }
+
+    size_t capacity() const { return capacity_; }
+    size_t used() const { return used_; }
+    size_t peak() const { return peak_; }
+
+private:
+    struct Free
+    {
+        void operator()(unsigned char *p) const { std::free(p); }
+    };
+
+    std::unique_ptr<unsigned char[], Free> base_;
+    size_t                                 capacity_ = 0;
+    size_t                                 used_     = 0;
+    size_t                                 peak_     = 0;
+};
@@ -320,7 +320,7 @@ public:
         }
 
         // Parse optional arguments and flags
-        for (int i = 2; i < argc; i++) {
+        for (int i = positional_name_.empty() ? 1 : 2; i < argc; i++) {
             std::string arg = argv[i];
 
             // Check if it's a flag
@@ -439,6 +439,7 @@ public:
     // Print usage information
     void print_usage() const
     {
+        Logger::flush();
         std::cout << "Usage: " << program_name_;
 
         if (!positional_name_.empty()) {
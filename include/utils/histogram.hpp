@@ -0,0 +1,119 @@
+#pragma once
+
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+// ============================================================================
+// Latency Histogram - HDR-style log-linear buckets
+//
+// Values (microseconds) below 2^SUB_BUCKET_BITS are counted exactly. Above
+// that, every power-of-two range is split into 2^(SUB_BUCKET_BITS - 1) equal
+// buckets, bounding the relative error of any reported percentile to
+// 2^-(SUB_BUCKET_BITS - 1) (< 1% here). Recording is a handful of integer ops
+// and one increment, so it is cheap enough to do per token.
+// ============================================================================
+
+class LatencyHistogram
+{
+public:
+    static constexpr int      SUB_BUCKET_BITS  = 8;
+    static constexpr uint64_t SUB_BUCKET_COUNT = 1ULL << SUB_BUCKET_BITS;
+    static constexpr uint64_t HALF_COUNT       = SUB_BUCKET_COUNT / 2;
+    static constexpr int      MAX_EXPONENT     = 40; // ~12 days in microseconds
+
+    LatencyHistogram()
+        : counts_(SUB_BUCKET_COUNT + MAX_EXPONENT * HALF_COUNT, 0)
+    {
+    }
+
+    void record_us(uint64_t value)
+    {
+        counts_[bucket_index(value)]++;
+        count_++;
+        sum_ += static_cast<double>(value);
+        min_ = std::min(min_, value);
+        max_ = std::max(max_, value);
+    }
+
+    void record_ms(double ms) { record_us(static_cast<uint64_t>(std::llround(std::max(0.0, ms) * 1000.0))); }
+
+    void merge(const LatencyHistogram &other)
+    {
+        for (size_t i = 0; i < counts_.size(); i++) {
+            counts_[i] += other.counts_[i];
+        }
+        count_ += other.count_;
+        sum_ += other.sum_;
+        min_ = std::min(min_, other.min_);
+        max_ = std::max(max_, other.max_);
+    }
+
+    void reset()
+    {
+        std::fill(counts_.begin(), counts_.end(), 0);
+        count_ = 0;
+        sum_   = 0.0;
+        min_   = UINT64_MAX;
+        max_   = 0;
+    }
+
+    uint64_t count() const { return count_; }
+    double   mean_ms() const { return count_ > 0 ? sum_ / count_ / 1000.0 : 0.0; }
+    double   min_ms() const { return count_ > 0 ? min_ / 1000.0 : 0.0; }
+    double   max_ms() const { return max_ / 1000.0; }
+
+    // Value at percentile p in [0, 100], in milliseconds
+    double percentile_ms(double p) const
+    {
+        if (count_ == 0) {
+            return 0.0;
+        }
+
+        uint64_t target = static_cast<uint64_t>(std::ceil(p / 100.0 * static_cast<double>(count_)));
+        target          = std::clamp<uint64_t>(target, 1, count_);
+
+        uint64_t seen = 0;
+        for (size_t i = 0; i < counts_.size(); i++) {
+            seen += counts_[i];
+            if (seen >= target) {
+                uint64_t value = std::clamp(bucket_midpoint(i), min_, max_);
+                return value / 1000.0;
+            }
+        }
+        return max_ms();
+    }
+
+    // Index of a value's bucket
+    static size_t bucket_index(uint64_t value)
+    {
+        if (value < SUB_BUCKET_COUNT) {
+            return static_cast<size_t>(value);
+        }
+        int exponent = std::bit_width(value) - SUB_BUCKET_BITS; // >= 1
+        exponent     = std::min(exponent, MAX_EXPONENT);
+        uint64_t sub = std::min<uint64_t>(value >> exponent, SUB_BUCKET_COUNT - 1) - HALF_COUNT;
+        return SUB_BUCKET_COUNT + (exponent - 1) * HALF_COUNT + sub;
+    }
+
+private:
+    std::vector<uint64_t> counts_;
+    uint64_t              count_ = 0;
+    double                sum_   = 0.0;
+    uint64_t              min_   = UINT64_MAX;
+    uint64_t              max_   = 0;
+
+    // Representative value of a bucket: the middle of its [lower, upper) range
+    static uint64_t bucket_midpoint(size_t index)
+    {
+        if (index < SUB_BUCKET_COUNT) {
+            return index;
+        }
+        size_t   rel      = index - SUB_BUCKET_COUNT;
+        int      exponent = static_cast<int>(rel / HALF_COUNT) + 1;
+        uint64_t lower    = (HALF_COUNT + rel % HALF_COUNT) << exponent;
+        return lower + ((1ULL << exponent) >> 1);
+    }
+};
@@ -1,6 +1,9 @@
 #pragma once
 
+#include <algorithm>
 #include <cctype>
+#include <climits>
+#include <cstdio>
 #include <fstream>
 #include <sstream>
 #include <stdexcept>
@@ -17,9 +20,15 @@
 
 namespace json {
 
-// JSON value types
-using JsonValue =
-    std::variant<std::nullptr_t, bool, double, std::string, std::vector<struct JsonObject>, struct JsonObject>;
+// JSON value types. Arrays hold objects, numbers or strings, not a mix.
+using JsonValue = std::variant<std::nullptr_t,
+                               bool,
+                               double,
+                               std::string,
+                               std::vector<struct JsonObject>,
+                               struct JsonObject,
+                               std::vector<double>,
+                               std::vector<std::string>>;
 using JsonArray = std::vector<struct JsonObject>;
 
 struct JsonObject
@@ -48,9 +57,14 @@ struct JsonObject
         return default_val;
     }
 
+    // Throws if the value does not fit in an int
     int get_int(const std::string &key, int default_val = 0) const
     {
-        return static_cast<int>(get_number(key, static_cast<double>(default_val)));
+        double value = get_number(key, static_cast<double>(default_val));
+        if (!(value > INT_MIN - 1.0 && value < INT_MAX + 1.0)) {
+            throw std::runtime_error("Value of '" + key + "' is out of range for an integer");
+        }
+        return static_cast<int>(value);
     }
 
     float get_float(const std::string &key, float default_val = 0.0f) const
@@ -79,6 +93,29 @@ struct JsonObject
         return empty;
     }
 
+    // A number array; a single number is returned as a one-element array
+    std::vector<double> get_numbers(const std::string &key) const
+    {
+        auto it = data.find(key);
+        if (it == data.end())
+            return {};
+        if (auto *val = std::get_if<std::vector<double>>(&it->second))
+            return *val;
+        if (auto *val = std::get_if<double>(&it->second))
+            return {*val};
+        return {};
+    }
+
+    std::vector<std::string> get_strings(const std::string &key) const
+    {
+        auto it = data.find(key);
+        if (it == data.end())
+            return {};
+        if (auto *val = std::get_if<std::vector<std::string>>(&it->second))
+            return *val;
+        return {};
+    }
+
     const JsonObject &get_object(const std::string &key) const
     {
         static JsonObject empty;
@@ -240,26 +277,34 @@ private:
         return obj;
     }
 
-    JsonArray parse_array()
+    JsonValue parse_array()
     {
-        JsonArray arr;
         expect('[');
         skip_whitespace();
 
-        if (current() == ']') {
+        // The first element decides the array type
+        char first = current();
+        if (first == ']') {
             advance();
-            return arr;
+            return JsonArray{};
+        }
+        if (first == '"') {
+            return parse_elements<std::string>([this] { return parse_string(); });
+        }
+        if (std::isdigit(first) || first == '-') {
+            return parse_elements<double>([this] { return parse_number(); });
         }
+        if (first == '{') {
+            return parse_elements<JsonObject>([this] { return parse_object(); });
+        }
+        throw std::runtime_error("Only arrays of objects, numbers or strings are supported");
+    }
 
+    template <typename T, typename ParseElement> std::vector<T> parse_elements(ParseElement parse_element)
+    {
+        std::vector<T> arr;
         while (true) {
-            skip_whitespace();
-            if (current() == '{') {
-                arr.push_back(parse_object());
-            }
-            else {
-                // For simplicity, we only support arrays of objects
-                throw std::runtime_error("Only arrays of objects are supported");
-            }
+            arr.push_back(parse_element());
 
             skip_whitespace();
             if (current() == ']') {
@@ -300,6 +345,32 @@ private:
 // Benchmark Input Parser - Parse requests from JSON file
 // ============================================================================
 
+// Build a request from one {"prompt", "temperature", "top_p", "max_tokens", "adapter", "logprobs",
+// "top_logprobs"} object; top_logprobs > 0 implies logprobs and is capped at
+// SamplingParams::MAX_TOP_LOGPROBS
+inline Request request_from_object(const JsonObject &req_obj, int request_id)
+{
+    std::string prompt      = req_obj.get_string("prompt", "");
+    float       temperature = req_obj.get_float("temperature", 1.0f);
+    float       top_p       = req_obj.get_float("top_p", 0.9f);
+    int         max_tokens  = req_obj.get_int("max_tokens", 256);
+
+    if (prompt.empty()) {
+        throw std::runtime_error("Request " + std::to_string(request_id) + " has empty prompt");
+    }
+
+    Request request(request_id, prompt, SamplingParams(temperature, top_p, max_tokens));
+    SamplingParams &params = request.sampling_params;
+    request.adapter        = req_obj.get_string("adapter", "");
+    params.top_logprobs    = std::max(req_obj.get_int("top_logprobs", 0), 0);
+    params.logprobs        = req_obj.get_bool("logprobs", false) || params.top_logprobs > 0;
+    if (params.top_logprobs > SamplingParams::MAX_TOP_LOGPROBS) {
+        throw std::runtime_error("Request " + std::to_string(request_id) + " asks for more than "
+                                 + std::to_string(SamplingParams::MAX_TOP_LOGPROBS) + " top_logprobs");
+    }
+    return request;
+}
+
 inline std::vector<Request> parse_benchmark_input(const std::string &filepath)
 {
     JsonParser           parser;
@@ -309,20 +380,46 @@ inline std::vector<Request> parse_benchmark_input(const std::string &filepath)
 
     int request_id = 0;
     for (const auto &req_obj : requests) {
-        std::string prompt      = req_obj.get_string("prompt", "");
-        float       temperature = req_obj.get_float("temperature", 1.0f);
-        float       top_p       = req_obj.get_float("top_p", 0.9f);
-        int         max_tokens  = req_obj.get_int("max_tokens", 256);
-
-        if (prompt.empty()) {
-            throw std::runtime_error("Request " + std::to_string(request_id) + " has empty prompt");
-        }
-
-        SamplingParams params(temperature, top_p, max_tokens);
-        result.emplace_back(request_id++, prompt, params);
+        result.push_back(request_from_object(req_obj, request_id++));
     }
 
     return result;
 }
 
+// Escape a string for embedding in JSON output
+inline std::string escape(const std::string &text)
+{
+    std::string out;
+    out.reserve(text.size() + 2);
+    for (unsigned char c : text) {
+        switch (c) {
+        case '"':
+            out += "\\\"";
+            break;
+        case '\\':
+            out += "\\\\";
+            break;
+        case '\n':
+            out += "\\n";
+            break;
+        case '\t':
+            out += "\\t";
+            break;
+        case '\r':
+            out += "\\r";
+            break;
+        default:
+            if (c < 0x20) {
+                char buf[8];
+                std::snprintf(buf, sizeof(buf), "\\u%04x", c);
+                out += buf;
+            }
+            else {
+                out += static_cast<char>(c);
+            }
+        }
+    }
+    return out;
+}
+
 } // namespace json
@@ -0,0 +1,435 @@
+#pragma once
+
+#include <algorithm>
+#include <bit>
+#include <climits>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+#include "scheduler/request.hpp"
+
+// ============================================================================
+// Request Scanner - On-demand JSON parsing for request ingestion
+//
+// JsonParser builds a DOM of variants and allocates for every key and value.
+// For one request object we only need a few fields, so the scanner walks the
+// buffer once: recognised keys are decoded in place, everything else is
+// skipped structurally without being materialised. String values without
+// escapes are returned as views into the input; escaped ones are decoded into
+// a scratch buffer reused across calls. Finding the end of a string (the hot
+// loop for long prompts) checks 16 bytes at a time with SSE2 or NEON.
+//
+// Views in the returned RequestFields are valid until the next scan() or
+// until the input buffer goes away.
+// ============================================================================
+
+namespace json {
+
+struct RequestFields
+{
+    std::string_view prompt;
+    std::string_view adapter;
+    float            temperature  = 1.0f;
+    float            top_p        = 0.9f;
+    int              max_tokens   = 256;
+    bool             logprobs     = false;
+    int              top_logprobs = 0;
+};
+
+namespace detail {
+
+// Position of the first '"' or '\\' at or after pos (text.size() if none)
+inline size_t find_quote_or_backslash(std::string_view text, size_t pos)
+{
+    const char *data = text.data();
+    size_t      size = text.size();
+#if defined(__SSE2__)
+    const __m128i quote     = _mm_set1_epi8('"');
+    const __m128i backslash = _mm_set1_epi8('\\');
+    for (; pos + 16 <= size; pos += 16) {
+        __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i *>(data + pos));
+        int     mask  = _mm_movemask_epi8(_mm_or_si128(_mm_cmpeq_epi8(chunk, quote), _mm_cmpeq_epi8(chunk, backslash)));
+        if (mask != 0) {
+            return pos + std::countr_zero(static_cast<unsigned>(mask));
+        }
+    }
+#elif defined(__ARM_NEON)
+    const uint8x16_t quote     = vdupq_n_u8('"');
+    const uint8x16_t backslash = vdupq_n_u8('\\');
+    for (; pos + 16 <= size; pos += 16) {
+        uint8x16_t chunk = vld1q_u8(reinterpret_cast<const uint8_t *>(data + pos));
+        uint8x16_t hit   = vorrq_u8(vceqq_u8(chunk, quote), vceqq_u8(chunk, backslash));
+        if (vmaxvq_u8(hit) != 0) {
+            break; // Locate it within this block below
+        }
+    }
+#endif
+    for (; pos < size; pos++) {
+        if (data[pos] == '"' || data[pos] == '\\') {
+            return pos;
+        }
+    }
+    return size;
+}
+
+// Encode a code point as UTF-8 at out; returns the end of what was written
+inline char *write_utf8(char *out, uint32_t cp)
+{
+    if (cp < 0x80) {
+        *out++ = static_cast<char>(cp);
+    }
+    else if (cp < 0x800) {
+        *out++ = static_cast<char>(0xC0 | (cp >> 6));
+        *out++ = static_cast<char>(0x80 | (cp & 0x3F));
+    }
+    else if (cp < 0x10000) {
+        *out++ = static_cast<char>(0xE0 | (cp >> 12));
+        *out++ = static_cast<char>(0x80 | ((cp >> 6) & 0x3F));
+        *out++ = static_cast<char>(0x80 | (cp & 0x3F));
+    }
+    else {
+        *out++ = static_cast<char>(0xF0 | (cp >> 18));
+        *out++ = static_cast<char>(0x80 | ((cp >> 12) & 0x3F));
+        *out++ = static_cast<char>(0x80 | ((cp >> 6) & 0x3F));
+        *out++ = static_cast<char>(0x80 | (cp & 0x3F));
+    }
+    return out;
+}
+
+} // namespace detail
+
+class RequestScanner
+{
+public:
+    // Extract the request fields from one JSON object. Unknown keys are
+    // skipped; fields of the wrong type keep their defaults, as with
+    // JsonObject::get_*. Throws std::runtime_error on malformed input.
+    RequestFields scan(std::string_view json)
+    {
+        text_ = json;
+        pos_  = 0;
+
+        RequestFields fields;
+        expect('{');
+        if (peek() == '}') {
+            pos_++;
+            return fields;
+        }
+
+        while (true) {
+            std::string_view key = parse_string(key_scratch_);
+            expect(':');
+            char c = peek();
+
+            if (key == "prompt" && c == '"') {
+                fields.prompt = parse_string(value_scratch_);
+            }
+            else if (key == "adapter" && c == '"') {
+                fields.adapter = parse_string(adapter_scratch_);
+            }
+            else if (key == "temperature" && is_number_start(c)) {
+                fields.temperature = static_cast<float>(parse_number());
+            }
+            else if (key == "top_p" && is_number_start(c)) {
+                fields.top_p = static_cast<float>(parse_number());
+            }
+            else if (key == "max_tokens" && is_number_start(c)) {
+                fields.max_tokens = parse_int();
+            }
+            else if (key == "logprobs" && (c == 't' || c == 'f')) {
+                fields.logprobs = c == 't';
+                skip_value();
+            }
+            else if (key == "top_logprobs" && is_number_start(c)) {
+                fields.top_logprobs = parse_int();
+            }
+            else {
+                skip_value();
+            }
+
+            char next = peek();
+            pos_++;
+            if (next == '}') {
+                break;
+            }
+            if (next != ',') {
+                fail("Expected ',' or '}'");
+            }
+        }
+        return fields;
+    }
+
+    // Same defaults and validation as request_from_object
+    Request scan_request(std::string_view json, int request_id)
+    {
+        RequestFields fields = scan(json);
+        if (fields.prompt.empty()) {
+            throw std::runtime_error("Request " + std::to_string(request_id) + " has empty prompt");
+        }
+        Request request(request_id,
+                        std::string(fields.prompt),
+                        SamplingParams(fields.temperature, fields.top_p, fields.max_tokens));
+        SamplingParams &params = request.sampling_params;
+        request.adapter        = fields.adapter;
+        params.top_logprobs    = std::max(fields.top_logprobs, 0);
+        params.logprobs        = fields.logprobs || params.top_logprobs > 0;
+        if (params.top_logprobs > SamplingParams::MAX_TOP_LOGPROBS) {
+            throw std::runtime_error("Request " + std::to_string(request_id) + " asks for more than "
+                                     + std::to_string(SamplingParams::MAX_TOP_LOGPROBS) + " top_logprobs");
+        }
+        return request;
+    }
+
+private:
+    std::string_view text_;
+    size_t           pos_ = 0;
+    std::string      key_scratch_;
+    std::string      value_scratch_;
+    std::string      adapter_scratch_;
+
+    [[noreturn]] void fail(const char *what) const
+    {
+        throw std::runtime_error(std::string(what) + " at offset " + std::to_string(pos_));
+    }
+
+    // Next non-whitespace character ('\0' at end of input)
+    char peek()
+    {
+        while (pos_ < text_.size()
+               && (text_[pos_] == ' ' || text_[pos_] == '\t' || text_[pos_] == '\n' || text_[pos_] == '\r')) {
+            pos_++;
+        }
+        return pos_ < text_.size() ? text_[pos_] : '\0';
+    }
+
+    void expect(char c)
+    {
+        if (peek() != c) {
+            fail((std::string("Expected '") + c + "'").c_str());
+        }
+        pos_++;
+    }
+
+    static bool is_number_start(char c) { return c == '-' || (c >= '0' && c <= '9'); }
+
+    // View of the string at pos_; decoded into scratch only if it has escapes
+    std::string_view parse_string(std::string &scratch)
+    {
+        expect('"');
+        size_t start = pos_;
+        size_t end   = detail::find_quote_or_backslash(text_, pos_);
+        if (end >= text_.size()) {
+            fail("Unterminated string");
+        }
+        if (text_[end] == '"') {
+            pos_ = end + 1;
+            return text_.substr(start, end - start);
+        }
+
+        // Slow path: decode through a raw pointer. The decoded string is never
+        // longer than its escaped form, so size scratch for the rest of the input.
+        scratch.resize(text_.size() - start);
+        char *out = scratch.data();
+        std::memcpy(out, text_.data() + start, end - start);
+        out += end - start;
+        pos_ = end;
+        while (true) {
+            if (pos_ >= text_.size()) {
+                fail("Unterminated string");
+            }
+            if (text_[pos_] == '"') {
+                pos_++;
+                scratch.resize(out - scratch.data());
+                return scratch;
+            }
+            // At a backslash
+            if (++pos_ >= text_.size()) {
+                fail("Unterminated escape");
+            }
+            char esc = text_[pos_++];
+            switch (esc) {
+            case 'n':
+                *out++ = '\n';
+                break;
+            case 't':
+                *out++ = '\t';
+                break;
+            case 'r':
+                *out++ = '\r';
+                break;
+            case 'b':
+                *out++ = '\b';
+                break;
+            case 'f':
+                *out++ = '\f';
+                break;
+            case 'u':
+                out = detail::write_utf8(out, parse_unicode_escape());
+                break;
+            default: // '"', '\\', '/'
+                *out++ = esc;
+            }
+            size_t next = detail::find_quote_or_backslash(text_, pos_);
+            std::memcpy(out, text_.data() + pos_, next - pos_);
+            out += next - pos_;
+            pos_ = next;
+        }
+    }
+
+    // After "\u": four hex digits, combining a UTF-16 surrogate pair if present
+    uint32_t parse_unicode_escape()
+    {
+        uint32_t cp = parse_hex4();
+        if (cp >= 0xD800 && cp <= 0xDBFF && text_.substr(pos_, 2) == "\\u") {
+            pos_ += 2;
+            uint32_t low = parse_hex4();
+            if (low < 0xDC00 || low > 0xDFFF) {
+                fail("Invalid surrogate pair");
+            }
+            cp = 0x10000 + ((cp - 0xD800) << 10) + (low - 0xDC00);
+        }
+        return cp;
+    }
+
+    uint32_t parse_hex4()
+    {
+        if (pos_ + 4 > text_.size()) {
+            fail("Truncated \\u escape");
+        }
+        uint32_t value = 0;
+        for (int i = 0; i < 4; i++) {
+            char c = text_[pos_++];
+            value <<= 4;
+            if (c >= '0' && c <= '9')
+                value |= c - '0';
+            else if (c >= 'a' && c <= 'f')
+                value |= c - 'a' + 10;
+            else if (c >= 'A' && c <= 'F')
+                value |= c - 'A' + 10;
+            else
+                fail("Invalid \\u escape");
+        }
+        return value;
+    }
+
+    double parse_number()
+    {
+        size_t start = pos_;
+        while (pos_ < text_.size()) {
+            char c = text_[pos_];
+            if (!(is_number_start(c) || c == '.' || c == 'e' || c == 'E' || c == '+')) {
+                break;
+            }
+            pos_++;
+        }
+        // strtod needs a terminator; numbers are short so a stack copy is enough
+        char   buf[64];
+        size_t len = std::min(pos_ - start, sizeof(buf) - 1);
+        text_.copy(buf, len, start);
+        buf[len]  = '\0';
+        char *end = nullptr;
+        double v  = std::strtod(buf, &end);
+        if (end == buf) {
+            fail("Invalid number");
+        }
+        return v;
+    }
+
+    // A number that must fit in an int (truncated toward zero like get_int)
+    int parse_int()
+    {
+        double v = parse_number();
+        if (!(v > INT_MIN - 1.0 && v < INT_MAX + 1.0)) {
+            fail("Integer out of range");
+        }
+        return static_cast<int>(v);
+    }
+
+    void skip_literal(std::string_view literal)
+    {
+        if (text_.substr(pos_, literal.size()) != literal) {
+            fail("Invalid literal");
+        }
+        pos_ += literal.size();
+    }
+
+    // Skip any value without materialising it
+    void skip_value()
+    {
+        char c = peek();
+        switch (c) {
+        case '"':
+            skip_string();
+            break;
+        case '{':
+        case '[':
+            skip_container();
+            break;
+        case 't':
+            skip_literal("true");
+            break;
+        case 'f':
+            skip_literal("false");
+            break;
+        case 'n':
+            skip_literal("null");
+            break;
+        default:
+            if (!is_number_start(c)) {
+                fail("Unexpected character");
+            }
+            parse_number();
+        }
+    }
+
+    void skip_string()
+    {
+        pos_++; // Opening quote
+        while (true) {
+            pos_ = detail::find_quote_or_backslash(text_, pos_);
+            if (pos_ >= text_.size()) {
+                fail("Unterminated string");
+            }
+            if (text_[pos_] == '"') {
+                pos_++;
+                return;
+            }
+            pos_ += 2; // Backslash and the escaped character
+        }
+    }
+
+    // Skip a nested object/array by bracket depth, stepping over strings
+    void skip_container()
+    {
+        int depth = 0;
+        while (pos_ < text_.size()) {
+            char c = text_[pos_];
+            if (c == '"') {
+                skip_string();
+                continue;
+            }
+            pos_++;
+            if (c == '{' || c == '[') {
+                depth++;
+            }
+            else if (c == '}' || c == ']') {
+                if (--depth == 0) {
+                    return;
+                }
+            }
+        }
+        fail("Unterminated object or array");
+    }
+};
+
+} // namespace json
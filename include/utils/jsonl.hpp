@@ -0,0 +1,155 @@
+#pragma once
+
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+
+#include "scheduler/request.hpp"
+#include "utils/json_parser.hpp"
+#include "utils/json_scanner.hpp"
+#include "utils/logger.hpp"
+
+// ============================================================================
+// JSONL Streams - One request / completion per line for offline batch jobs
+//
+// Unlike parse_benchmark_input, nothing here holds more than the current line:
+// the reader scans lines on demand (RequestScanner, no DOM) as the engine
+// pulls requests, and the writer emits each completion as soon as it
+// finishes. Memory therefore stays bounded by the number of requests in
+// flight, not by the size of the input.
+// A path of "-" means stdin / stdout.
+// ============================================================================
+
+namespace json {
+
+class JsonlReader
+{
+public:
+    explicit JsonlReader(const std::string &path)
+    {
+        if (path == "-") {
+            in_ = &std::cin;
+            return;
+        }
+        file_.open(path);
+        if (!file_.is_open()) {
+            throw std::runtime_error("Failed to open JSONL file: " + path);
+        }
+        in_ = &file_;
+    }
+
+    // Read the next request. Blank lines are ignored; malformed lines are
+    // skipped with a warning so one bad record does not abort a long job.
+    // Returns false at end of input.
+    bool next(Request &request)
+    {
+        while (std::getline(*in_, line_)) {
+            line_number_++;
+            if (line_.find_first_not_of(" \t\r") == std::string::npos) {
+                continue;
+            }
+            try {
+                request = scanner_.scan_request(line_, next_id_);
+                next_id_++;
+                return true;
+            }
+            catch (const std::exception &e) {
+                LOG_WARNING("Skipping JSONL line ", line_number_, ": ", e.what());
+                num_skipped_++;
+            }
+        }
+        return false;
+    }
+
+    int num_read() const { return next_id_; }
+    int num_skipped() const { return num_skipped_; }
+
+private:
+    std::ifstream  file_;
+    std::istream  *in_ = nullptr;
+    std::string    line_;
+    RequestScanner scanner_;
+    int            line_number_ = 0;
+    int            next_id_     = 0; // Requests are numbered by their order in the input
+    int            num_skipped_ = 0;
+};
+
+class JsonlWriter
+{
+public:
+    // Generations ending in eos_token_id are reported as "stop"
+    explicit JsonlWriter(const std::string &path, int eos_token_id = 2)
+        : eos_token_id_(eos_token_id)
+    {
+        if (path == "-") {
+            out_ = &std::cout;
+            return;
+        }
+        file_.open(path);
+        if (!file_.is_open()) {
+            throw std::runtime_error("Failed to open JSONL output: " + path);
+        }
+        out_ = &file_;
+    }
+
+    // {"id", "text", "finish_reason", "usage": {...}, "timing_ms": {...}, "logprobs"?: [...]}
+    void write(const Request &request)
+    {
+        bool        stopped = !request.generated_tokens.empty() && request.generated_tokens.back() == eos_token_id_;
+        const char *finish_reason =
+            request.status == RequestStatus::FAILED ? "error" : (stopped ? "stop" : "length");
+
+        line_.str("");
+        line_ << std::fixed << std::setprecision(3);
+        line_ << "{\"id\": " << request.id << ", \"text\": \"" << escape(request.output_text) << "\"";
+        line_ << ", \"finish_reason\": \"" << finish_reason << "\"";
+        line_ << ", \"usage\": {\"prompt_tokens\": " << request.num_prompt_tokens()
+              << ", \"completion_tokens\": " << request.num_generated_tokens() << "}";
+        line_ << ", \"timing_ms\": {\"queue\": " << request.queueing_delay_ms() << ", \"ttft\": " << request.ttft_ms()
+              << ", \"tpot\": " << request.tpot_ms() << ", \"e2e\": " << request.e2e_latency_ms()
+              << ", \"prefill\": " << request.prefill_time_ms << ", \"decode\": " << request.decode_time_ms << "}";
+        if (request.sampling_params.logprobs) {
+            write_logprobs(request);
+        }
+        line_ << "}\n";
+
+        *out_ << line_.str();
+        num_written_++;
+    }
+
+    void flush() { out_->flush(); }
+    bool good() const { return out_->good(); }
+    int  num_written() const { return num_written_; }
+
+private:
+    // "logprobs": [{"token", "logprob", "top_logprobs"?: [{"token", "logprob"}, ...]}, ...], one per generated token
+    void write_logprobs(const Request &request)
+    {
+        line_ << std::setprecision(6) << ", \"logprobs\": [";
+        for (size_t i = 0; i < request.token_logprobs.size(); i++) {
+            line_ << (i ? ", " : "") << "{\"token\": " << request.generated_tokens[i]
+                  << ", \"logprob\": " << request.token_logprobs[i];
+            if (request.sampling_params.top_logprobs > 0) {
+                line_ << ", \"top_logprobs\": [";
+                for (size_t j = 0; j < request.top_logprobs[i].size(); j++) {
+                    const auto &alt = request.top_logprobs[i][j];
+                    line_ << (j ? ", " : "") << "{\"token\": " << alt.token << ", \"logprob\": " << alt.logprob << "}";
+                }
+                line_ << "]";
+            }
+            line_ << "}";
+        }
+        line_ << "]";
+    }
+
+    std::ofstream      file_;
+    std::ostream      *out_ = nullptr;
+    std::ostringstream line_;
+    int                eos_token_id_;
+    int                num_written_ = 0;
+};
+
+} // namespace json
@@ -1,10 +1,18 @@
 #pragma once
 
+#include <atomic>
 #include <chrono>
+#include <cstddef>
+#include <cstdlib>
+#include <cstring>
 #include <iomanip>
 #include <iostream>
+#include <memory>
+#include <mutex>
+#include <pthread.h>
 #include <sstream>
 #include <string>
+#include <thread>
 #include <type_traits>
 
 #define RESET   "\033[0m"
@@ -17,20 +25,238 @@
 #define WHITE   "\033[37m"
 #define GRAY    "\033[90m"
 
-// TODO: VLLM_LOGGER_LEVEL
+// ============================================================================
+// Logger - Level-filtered, asynchronous
+//
+// Filtering happens in the LOG_* macros before any argument is formatted:
+//   - compile time: -DNANO_VLLM_LOG_LEVEL=<n> removes lower levels entirely
+//   - run time: VLLM_LOGGER_LEVEL=debug|info|warning|error|off (default info)
+//
+// Enabled messages are formatted on the calling thread and pushed into a
+// bounded lock-free MPSC ring; a background thread adds the timestamp and
+// file prefix and writes them out. Errors first drain the ring and are then
+// written synchronously, so they are never lost or reordered before a crash;
+// both writers hold write_mutex_, which also guards the cached timestamp.
+// If the ring is full, debug/info messages are dropped (and counted) rather
+// than stalling the caller; warnings wait for space.
+// ============================================================================
+
+enum class LogLevel : int { Debug = 0, Info = 1, Warning = 2, Error = 3, Off = 4 };
+
+#ifndef NANO_VLLM_LOG_LEVEL
+#define NANO_VLLM_LOG_LEVEL 0 // Compile everything in; runtime level decides
+#endif
+
 class Logger
 {
 private:
-    static std::string getCurrentTime()
+    static constexpr size_t RING_CAPACITY = 8192; // Power of two
+
+    struct Record
+    {
+        LogLevel                              level;
+        const char                           *emoji;
+        const char                           *color;
+        const char                           *file;
+        int                                   line;
+        std::chrono::system_clock::time_point time;
+        std::string                           message;
+    };
+
+    struct Slot
+    {
+        std::atomic<size_t> seq;
+        Record              record;
+    };
+
+    // Bounded MPSC ring (Vyukov): a slot is writable when seq == pos and
+    // readable when seq == pos + 1
+    std::unique_ptr<Slot[]> ring_;
+    alignas(64) std::atomic<size_t> tail_{0}; // Next position to claim (producers)
+    alignas(64) std::atomic<size_t> head_{0}; // Next position to drain (consumer)
+    std::atomic<uint64_t> dropped_{0};
+
+    std::atomic<bool> running_{false};
+    std::thread      *drainer_ = nullptr; // Leaked in a forked child, whose copy has no thread behind it
+
+    // Held while writing records, by the drainer and by synchronous errors
+    std::mutex write_mutex_;
+
+    // Formatted "%Y-%m-%d %H:%M:%S" for the last second written
+    time_t      cached_second_ = 0;
+    std::string cached_time_;
+
+    Logger()
+        : ring_(new Slot[RING_CAPACITY])
+    {
+        for (size_t i = 0; i < RING_CAPACITY; i++) {
+            ring_[i].seq.store(i, std::memory_order_relaxed);
+        }
+        start();
+        // Hold write_mutex_ across fork so the child never inherits it locked
+        // by a thread that no longer exists
+        pthread_atfork(
+            [] {
+                instance().flush();
+                instance().write_mutex_.lock();
+            },
+            [] { instance().write_mutex_.unlock(); },
+            [] {
+                instance().write_mutex_.unlock();
+                instance().restart_after_fork();
+            });
+    }
+
+    ~Logger()
+    {
+        shut_down() = true;
+        running_    = false;
+        if (drainer_ && drainer_->joinable()) {
+            drainer_->join();
+        }
+        drain(); // Anything logged after the drainer saw running_ = false
+        delete drainer_;
+    }
+
+    static Logger &instance()
+    {
+        static Logger logger;
+        return logger;
+    }
+
+    // Set once the singleton is destroyed; later messages (from other static
+    // destructors) are written synchronously
+    static bool &shut_down()
+    {
+        static bool flag = false;
+        return flag;
+    }
+
+    static std::atomic<int> &runtime_level()
+    {
+        static std::atomic<int> level{parse_level(std::getenv("VLLM_LOGGER_LEVEL"))};
+        return level;
+    }
+
+    static int parse_level(const char *text)
+    {
+        if (!text || !*text) {
+            return static_cast<int>(LogLevel::Info);
+        }
+        std::string value(text);
+        for (auto &c : value) {
+            c = static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+        }
+        if (value == "debug")
+            return static_cast<int>(LogLevel::Debug);
+        if (value == "info")
+            return static_cast<int>(LogLevel::Info);
+        if (value == "warning" || value == "warn")
+            return static_cast<int>(LogLevel::Warning);
+        if (value == "error")
+            return static_cast<int>(LogLevel::Error);
+        if (value == "off" || value == "none")
+            return static_cast<int>(LogLevel::Off);
+        return static_cast<int>(LogLevel::Info);
+    }
+
+    void start()
+    {
+        running_ = true;
+        drainer_ = new std::thread([this] { drain_loop(); });
+    }
+
+    void restart_after_fork()
+    {
+        // Only the forking thread survives: the ring is empty (flushed in
+        // prepare) and the drainer is gone, so start a fresh one
+        drainer_ = nullptr;
+        start();
+    }
+
+    bool try_push(Record &record)
+    {
+        size_t pos = tail_.load(std::memory_order_relaxed);
+        for (;;) {
+            Slot     &slot = ring_[pos & (RING_CAPACITY - 1)];
+            size_t    seq  = slot.seq.load(std::memory_order_acquire);
+            ptrdiff_t diff = static_cast<ptrdiff_t>(seq) - static_cast<ptrdiff_t>(pos);
+            if (diff == 0) {
+                if (tail_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    slot.record = std::move(record);
+                    slot.seq.store(pos + 1, std::memory_order_release);
+                    return true;
+                }
+            }
+            else if (diff < 0) {
+                return false; // Full
+            }
+            else {
+                pos = tail_.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    // Write out every published record; only the drainer (or the destructor
+    // after joining it) calls this
+    bool drain()
     {
-        auto now    = std::chrono::system_clock::now();
-        auto time_t = std::chrono::system_clock::to_time_t(now);
+        std::lock_guard<std::mutex> lock(write_mutex_);
+
+        bool   wrote = false;
+        size_t pos   = head_.load(std::memory_order_relaxed);
+        for (;;) {
+            Slot &slot = ring_[pos & (RING_CAPACITY - 1)];
+            if (slot.seq.load(std::memory_order_acquire) != pos + 1) {
+                break;
+            }
+            write(slot.record);
+            slot.record.message.clear();
+            slot.seq.store(pos + RING_CAPACITY, std::memory_order_release);
+            head_.store(++pos, std::memory_order_release);
+            wrote = true;
+        }
+
+        uint64_t dropped = dropped_.exchange(0, std::memory_order_relaxed);
+        if (dropped > 0) {
+            std::cout << YELLOW << "[logger] dropped " << dropped << " messages (ring full)" << RESET << "\n";
+        }
+        if (wrote) {
+            std::cout.flush();
+        }
+        return wrote;
+    }
+
+    void drain_loop()
+    {
+        while (running_.load(std::memory_order_relaxed)) {
+            if (!drain()) {
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            }
+        }
+        drain();
+    }
+
+    static std::string getCurrentTime(time_t seconds)
+    {
+        std::tm local;
+        localtime_r(&seconds, &local);
 
         std::stringstream ss;
-        ss << std::put_time(localtime(&time_t), "%Y-%m-%d %H:%M:%S");
+        ss << std::put_time(&local, "%Y-%m-%d %H:%M:%S");
         return ss.str();
     }
 
+    const std::string &format_time(std::chrono::system_clock::time_point time)
+    {
+        time_t seconds = std::chrono::system_clock::to_time_t(time);
+        if (seconds != cached_second_ || cached_time_.empty()) {
+            cached_time_   = getCurrentTime(seconds);
+            cached_second_ = seconds;
+        }
+        return cached_time_;
+    }
+
     static std::string getFilename(const char *file)
     {
         std::string fullPath(file);
@@ -50,16 +276,42 @@ private:
         return fullPath;
     }
 
-    static void log(std::ostream      &stream,
-                    const std::string &level,
-                    const std::string &color,
-                    const std::string &message,
-                    const char        *file,
-                    int                line)
+    static void emit(const Record &r, const std::string &time)
     {
-        stream << WHITE << "[" << BLUE << getCurrentTime() << WHITE << "] [" << GREEN << getFilename(file) << ":"
-               << std::to_string(line) << WHITE << "] " << RESET << level << " " << color << message << RESET
-               << std::endl;
+        std::ostream &stream = r.level == LogLevel::Error ? std::cerr : std::cout;
+        stream << WHITE << "[" << BLUE << time << WHITE << "] [" << GREEN << getFilename(r.file) << ":"
+               << std::to_string(r.line) << WHITE << "] " << RESET << r.emoji << " " << r.color << r.message << RESET
+               << "\n";
+    }
+
+    void write(const Record &r) { emit(r, format_time(r.time)); }
+
+    static void
+    log(LogLevel level, const char *emoji, const char *color, std::string message, const char *file, int line)
+    {
+        Record record{level, emoji, color, file, line, std::chrono::system_clock::now(), std::move(message)};
+        if (shut_down()) {
+            emit(record, getCurrentTime(std::chrono::system_clock::to_time_t(record.time)));
+            return;
+        }
+
+        Logger &logger = instance();
+
+        if (level == LogLevel::Error) {
+            logger.flush();
+            std::lock_guard<std::mutex> lock(logger.write_mutex_);
+            logger.write(record);
+            std::cerr.flush();
+            return;
+        }
+
+        while (!logger.try_push(record)) {
+            if (level < LogLevel::Warning) {
+                logger.dropped_.fetch_add(1, std::memory_order_relaxed);
+                return;
+            }
+            std::this_thread::yield();
+        }
     }
 
     template <typename T> static void addToStream(std::stringstream &ss, T &&value)
@@ -98,29 +350,72 @@ private:
     }
 
 public:
+    static bool enabled(LogLevel level)
+    {
+        return static_cast<int>(level) >= runtime_level().load(std::memory_order_relaxed);
+    }
+
+    static void set_level(LogLevel level) { runtime_level().store(static_cast<int>(level)); }
+
+    // Block until everything logged so far has been written. Call before
+    // writing to stdout directly so log lines and program output stay ordered.
+    static void flush()
+    {
+        Logger &logger = instance();
+        size_t  target = logger.tail_.load(std::memory_order_acquire);
+        while (logger.head_.load(std::memory_order_acquire) < target && logger.running_) {
+            std::this_thread::yield();
+        }
+    }
+
+    template <typename... Args> static void debug(const char *file, int line, Args &&...args)
+    {
+        if (enabled(LogLevel::Debug)) {
+            log(LogLevel::Debug, "🔍", GRAY, buildMessage(std::forward<Args>(args)...), file, line);
+        }
+    }
+
     template <typename... Args> static void info(const char *file, int line, Args &&...args)
     {
-        log(std::cout, "ℹ️", CYAN, buildMessage(std::forward<Args>(args)...), file, line);
+        if (enabled(LogLevel::Info)) {
+            log(LogLevel::Info, "ℹ️", CYAN, buildMessage(std::forward<Args>(args)...), file, line);
+        }
     }
 
     template <typename... Args> static void success(const char *file, int line, Args &&...args)
     {
-        log(std::cout, "✅", GREEN, buildMessage(std::forward<Args>(args)...), file, line);
+        if (enabled(LogLevel::Info)) {
+            log(LogLevel::Info, "✅", GREEN, buildMessage(std::forward<Args>(args)...), file, line);
+        }
     }
 
     template <typename... Args> static void warning(const char *file, int line, Args &&...args)
     {
-        log(std::cout, "⚠️", YELLOW, buildMessage(std::forward<Args>(args)...), file, line);
+        if (enabled(LogLevel::Warning)) {
+            log(LogLevel::Warning, "⚠️", YELLOW, buildMessage(std::forward<Args>(args)...), file, line);
+        }
     }
 
     template <typename... Args> static void error(const char *file, int line, Args &&...args)
     {
-        log(std::cerr, "❌", RED, buildMessage(std::forward<Args>(args)...), file, line);
+        if (enabled(LogLevel::Error)) {
+            log(LogLevel::Error, "❌", RED, buildMessage(std::forward<Args>(args)...), file, line);
+        }
     }
 };
 
-// CPU Logger macros
-#define LOG_INFO(...)    Logger::info(__FILE__, __LINE__, __VA_ARGS__)
-#define LOG_SUCCESS(...) Logger::success(__FILE__, __LINE__, __VA_ARGS__)
-#define LOG_WARNING(...) Logger::warning(__FILE__, __LINE__, __VA_ARGS__)
-#define LOG_ERROR(...)   Logger::error(__FILE__, __LINE__, __VA_ARGS__)
+// CPU Logger macros: arguments are only evaluated if the level is enabled
+#define LOG_AT_LEVEL(level, fn, ...)                                    \
+    do {                                                                \
+        if constexpr (static_cast<int>(level) >= NANO_VLLM_LOG_LEVEL) { \
+            if (Logger::enabled(level)) {                               \
+                Logger::fn(__FILE__, __LINE__, __VA_ARGS__);            \
+            }                                                           \
+        }                                                               \
+    } while (0)
+
+#define LOG_DEBUG(...)   LOG_AT_LEVEL(LogLevel::Debug, debug, __VA_ARGS__)
+#define LOG_INFO(...)    LOG_AT_LEVEL(LogLevel::Info, info, __VA_ARGS__)
+#define LOG_SUCCESS(...) LOG_AT_LEVEL(LogLevel::Info, success, __VA_ARGS__)
+#define LOG_WARNING(...) LOG_AT_LEVEL(LogLevel::Warning, warning, __VA_ARGS__)
+#define LOG_ERROR(...)   LOG_AT_LEVEL(LogLevel::Error, error, __VA_ARGS__)
@@ -6,6 +6,8 @@
 #include <sstream>
 #include <string>
 
+#include "utils/logger.hpp"
+
 // Forward declaration
 struct Config;
 
@@ -63,6 +65,7 @@ public:
         double savings_percent = (static_cast<double>(savings_bytes) / static_cast<double>(standard_memory)) * 100.0;
 
         // Print formatted comparison
+        Logger::flush();
         std::cout << "\n";
         std::cout << "┌─────────────────────────────────────────────────────────────────┐\n";
         std::cout << "│                  KV Cache Memory Comparison                     │\n";
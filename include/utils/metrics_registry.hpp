@@ -0,0 +1,200 @@
+#pragma once
+
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+// ============================================================================
+// Metrics Registry - Prometheus-style counters, gauges and histograms
+//
+// Metrics are registered once (under a lock, at startup) and then updated
+// from the engine loop with relaxed atomics only. render() produces the
+// Prometheus text exposition format for a scrape; it reads the atomics
+// without stopping writers, so a scrape is a near-consistent snapshot.
+// ============================================================================
+
+namespace Metrics {
+
+// Lock-free add on an atomic double (fetch_add for floating point is not
+// available in every standard library we build with)
+inline void atomic_add(std::atomic<double> &target, double value)
+{
+    double current = target.load(std::memory_order_relaxed);
+    while (!target.compare_exchange_weak(current, current + value, std::memory_order_relaxed)) {
+    }
+}
+
+// Monotonically increasing value
+class Counter
+{
+public:
+    void   inc(double value = 1.0) { atomic_add(value_, value); }
+    double value() const { return value_.load(std::memory_order_relaxed); }
+
+private:
+    std::atomic<double> value_{0.0};
+};
+
+// Value that can go up and down
+class Gauge
+{
+public:
+    void   set(double value) { value_.store(value, std::memory_order_relaxed); }
+    void   add(double value) { atomic_add(value_, value); }
+    double value() const { return value_.load(std::memory_order_relaxed); }
+
+private:
+    std::atomic<double> value_{0.0};
+};
+
+// Fixed upper-bound buckets; counts are stored per bucket and made
+// cumulative at render time
+class Histogram
+{
+public:
+    explicit Histogram(std::vector<double> bounds)
+        : bounds_(std::move(bounds))
+        , counts_(bounds_.size() + 1)
+    {
+    }
+
+    void observe(double value)
+    {
+        size_t i = 0;
+        while (i < bounds_.size() && value > bounds_[i]) {
+            i++;
+        }
+        counts_[i].fetch_add(1, std::memory_order_relaxed);
+        atomic_add(sum_, value);
+    }
+
+    const std::vector<double> &bounds() const { return bounds_; }
+    uint64_t bucket_count(size_t i) const { return counts_[i].load(std::memory_order_relaxed); }
+    double   sum() const { return sum_.load(std::memory_order_relaxed); }
+
+private:
+    std::vector<double>                bounds_;
+    std::vector<std::atomic<uint64_t>> counts_; // Last bucket is +Inf
+    std::atomic<double>                sum_{0.0};
+};
+
+// Bucket bounds start, start*factor, ... (count values)
+inline std::vector<double> exponential_buckets(double start, double factor, int count)
+{
+    std::vector<double> bounds(count);
+    for (int i = 0; i < count; i++) {
+        bounds[i] = start * std::pow(factor, i);
+    }
+    return bounds;
+}
+
+inline std::vector<double> linear_buckets(double start, double width, int count)
+{
+    std::vector<double> bounds(count);
+    for (int i = 0; i < count; i++) {
+        bounds[i] = start + width * i;
+    }
+    return bounds;
+}
+
+class Registry
+{
+public:
+    static Registry &instance()
+    {
+        static Registry registry;
+        return registry;
+    }
+
+    // Registration returns a reference that stays valid for the process lifetime
+    Counter &counter(const std::string &name, const std::string &help)
+    {
+        return add<Counter>(name, help, "counter", std::make_unique<Counter>());
+    }
+
+    Gauge &gauge(const std::string &name, const std::string &help)
+    {
+        return add<Gauge>(name, help, "gauge", std::make_unique<Gauge>());
+    }
+
+    Histogram &histogram(const std::string &name, const std::string &help, std::vector<double> bounds)
+    {
+        return add<Histogram>(name, help, "histogram", std::make_unique<Histogram>(std::move(bounds)));
+    }
+
+    // Prometheus text exposition format (version 0.0.4)
+    std::string render() const
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        std::ostringstream          out;
+        out.precision(17);
+
+        for (const auto &entry : entries_) {
+            out << "# HELP " << entry.name << " " << entry.help << "\n";
+            out << "# TYPE " << entry.name << " " << entry.type << "\n";
+
+            if (entry.counter) {
+                out << entry.name << " " << entry.counter->value() << "\n";
+            }
+            else if (entry.gauge) {
+                out << entry.name << " " << entry.gauge->value() << "\n";
+            }
+            else if (entry.histogram) {
+                const Histogram &h          = *entry.histogram;
+                uint64_t         cumulative = 0;
+                for (size_t i = 0; i < h.bounds().size(); i++) {
+                    cumulative += h.bucket_count(i);
+                    out << entry.name << "_bucket{le=\"" << h.bounds()[i] << "\"} " << cumulative << "\n";
+                }
+                cumulative += h.bucket_count(h.bounds().size());
+                out << entry.name << "_bucket{le=\"+Inf\"} " << cumulative << "\n";
+                out << entry.name << "_sum " << h.sum() << "\n";
+                out << entry.name << "_count " << cumulative << "\n";
+            }
+        }
+        return out.str();
+    }
+
+private:
+    struct Entry
+    {
+        std::string                name;
+        std::string                help;
+        const char                *type;
+        std::unique_ptr<Counter>   counter;
+        std::unique_ptr<Gauge>     gauge;
+        std::unique_ptr<Histogram> histogram;
+    };
+
+    Registry() = default;
+
+    mutable std::mutex mutex_;
+    std::vector<Entry> entries_;
+
+    template <typename T>
+    T &add(const std::string &name, const std::string &help, const char *type, std::unique_ptr<T> metric)
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        T                          &ref = *metric;
+        Entry                       entry{name, help, type, nullptr, nullptr, nullptr};
+        if constexpr (std::is_same_v<T, Counter>) {
+            entry.counter = std::move(metric);
+        }
+        else if constexpr (std::is_same_v<T, Gauge>) {
+            entry.gauge = std::move(metric);
+        }
+        else {
+            entry.histogram = std::move(metric);
+        }
+        entries_.push_back(std::move(entry));
+        return ref;
+    }
+};
+
+} // namespace Metrics
@@ -0,0 +1,135 @@
+#pragma once
+
+#include <arpa/inet.h>
+#include <atomic>
+#include <cstring>
+#include <netinet/in.h>
+#include <poll.h>
+#include <stdexcept>
+#include <string>
+#include <sys/socket.h>
+#include <thread>
+#include <unistd.h>
+
+#include "utils/logger.hpp"
+#include "utils/metrics_registry.hpp"
+
+#ifndef MSG_NOSIGNAL
+#define MSG_NOSIGNAL 0 // macOS: SIGPIPE is disabled per socket instead
+#endif
+
+// ============================================================================
+// Metrics Server - Minimal HTTP endpoint serving GET /metrics
+//
+// A single background thread accepts one connection at a time on
+// 127.0.0.1:port, answers with Registry::render() and closes the connection.
+// That is all a Prometheus scraper needs; it never touches the engine loop.
+// ============================================================================
+
+class MetricsServer
+{
+public:
+    explicit MetricsServer(int port)
+    {
+        listen_fd_ = ::socket(AF_INET, SOCK_STREAM, 0);
+        if (listen_fd_ < 0) {
+            throw std::runtime_error("Failed to create metrics socket");
+        }
+        int reuse = 1;
+        setsockopt(listen_fd_, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+#ifdef SO_NOSIGPIPE
+        setsockopt(listen_fd_, SOL_SOCKET, SO_NOSIGPIPE, &reuse, sizeof(reuse));
+#endif
+
+        sockaddr_in addr{};
+        addr.sin_family      = AF_INET;
+        addr.sin_port        = htons(static_cast<uint16_t>(port));
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        if (::bind(listen_fd_, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) < 0 || ::listen(listen_fd_, 8) < 0) {
+            ::close(listen_fd_);
+            throw std::runtime_error("Failed to listen on metrics port " + std::to_string(port));
+        }
+
+        running_ = true;
+        thread_  = std::thread([this] { serve(); });
+        LOG_INFO("Serving metrics on http://127.0.0.1:", port, "/metrics");
+    }
+
+    ~MetricsServer() { stop(); }
+
+    MetricsServer(const MetricsServer &)            = delete;
+    MetricsServer &operator=(const MetricsServer &) = delete;
+
+    void stop()
+    {
+        if (!running_.exchange(false)) {
+            return;
+        }
+        if (thread_.joinable()) {
+            thread_.join();
+        }
+        ::close(listen_fd_);
+    }
+
+private:
+    int               listen_fd_ = -1;
+    std::atomic<bool> running_{false};
+    std::thread       thread_;
+
+    void serve()
+    {
+        while (running_) {
+            // Poll with a timeout so stop() is noticed without closing the fd under us
+            pollfd pfd{listen_fd_, POLLIN, 0};
+            if (::poll(&pfd, 1, 200) <= 0) {
+                continue;
+            }
+            int client = ::accept(listen_fd_, nullptr, nullptr);
+            if (client < 0) {
+                continue;
+            }
+            handle(client);
+            ::close(client);
+        }
+    }
+
+    void handle(int client)
+    {
+        // Only the request line matters; read until the end of headers or 4 KB
+        std::string request;
+        char        buf[1024];
+        while (request.find("\r\n\r\n") == std::string::npos && request.size() < 4096) {
+            pollfd pfd{client, POLLIN, 0};
+            if (::poll(&pfd, 1, 1000) <= 0) {
+                return;
+            }
+            ssize_t n = ::recv(client, buf, sizeof(buf), 0);
+            if (n <= 0) {
+                return;
+            }
+            request.append(buf, static_cast<size_t>(n));
+        }
+
+        std::string status = "200 OK";
+        std::string body;
+        if (request.rfind("GET /metrics ", 0) == 0 || request.rfind("GET /metrics?", 0) == 0) {
+            body = Metrics::Registry::instance().render();
+        }
+        else {
+            status = "404 Not Found";
+            body   = "Not Found\n";
+        }
+
+        std::string response = "HTTP/1.1 " + status
+                             + "\r\nContent-Type: text/plain; version=0.0.4; charset=utf-8\r\nContent-Length: "
+                             + std::to_string(body.size()) + "\r\nConnection: close\r\n\r\n" + body;
+        size_t sent = 0;
+        while (sent < response.size()) {
+            ssize_t n = ::send(client, response.data() + sent, response.size() - sent, MSG_NOSIGNAL);
+            if (n <= 0) {
+                return;
+            }
+            sent += static_cast<size_t>(n);
+        }
+    }
+};
@@ -1,8 +1,10 @@
 #pragma once
 
+#include <algorithm>
 #include <filesystem>
 #include <string>
 #include <utility>
+#include <vector>
 
 #include "logger.hpp"
 
@@ -12,9 +14,26 @@ namespace fs = std::filesystem;
 // Path Resolution Functions
 // ============================================================================
 
+// First file in dir with the given extension (sorted by name), or empty
+inline fs::path find_with_extension(const fs::path &dir, const std::string &extension)
+{
+    std::vector<fs::path> matches;
+    for (const auto &entry : fs::directory_iterator(dir)) {
+        if (entry.is_regular_file() && entry.path().extension() == extension) {
+            matches.push_back(entry.path());
+        }
+    }
+    std::sort(matches.begin(), matches.end());
+    return matches.empty() ? fs::path() : matches.front();
+}
+
 // Resolve model and tokenizer paths from user input
-// If path is a directory, look for model.bin and tokenizer.bin inside
+// If path is a directory, look for model.pack (see `pack`), model.bin
+// (llama2.c), a .gguf file, then .safetensors shards (the directory itself is
+// the model path), plus tokenizer.bin inside
 // If path is a file, use it as model and look for tokenizer.bin in same directory
+// An empty tokenizer path means the vocabulary embedded in a GGUF or packed
+// model is used
 inline std::pair<std::string, std::string> resolve_model_paths(const std::string &input_path)
 {
     fs::path    p(input_path);
@@ -22,22 +41,42 @@ inline std::pair<std::string, std::string> resolve_model_paths(const std::string
     std::string tokenizer_path;
 
     if (fs::is_directory(p)) {
-        // TODO: json, safetensors, ...
-
         // Input is a directory
         model_path     = (p / "model.bin").string();
         tokenizer_path = (p / "tokenizer.bin").string();
+        bool embedded  = false; // Model file carries its own vocabulary
 
-        if (!fs::exists(model_path)) {
-            LOG_ERROR("model.bin not found in directory: ", input_path);
-            throw std::runtime_error("model.bin not found in: " + input_path);
+        if (fs::exists(p / "model.pack")) {
+            model_path = (p / "model.pack").string();
+            embedded   = true;
+        }
+        else if (!fs::exists(model_path)) {
+            fs::path gguf_file = find_with_extension(p, ".gguf");
+            if (!gguf_file.empty()) {
+                model_path = gguf_file.string();
+                embedded   = true;
+            }
+            else if (!find_with_extension(p, ".safetensors").empty()) {
+                model_path = p.string();
+            }
+            else {
+                LOG_ERROR("No model.pack, model.bin, .gguf or .safetensors found in directory: ", input_path);
+                throw std::runtime_error("No model found in: " + input_path);
+            }
         }
         if (!fs::exists(tokenizer_path)) {
-            LOG_ERROR("tokenizer.bin not found in directory: ", input_path);
-            throw std::runtime_error("tokenizer.bin not found in: " + input_path);
+            if (!embedded) {
+                LOG_ERROR("tokenizer.bin not found in directory: ", input_path);
+                throw std::runtime_error("tokenizer.bin not found in: " + input_path);
+            }
+            tokenizer_path.clear();
         }
 
-        LOG_INFO("Found model.bin and tokenizer.bin in: ", input_path);
+        LOG_INFO("Found ",
+                 fs::path(model_path).filename().string(),
+                 tokenizer_path.empty() ? "" : " and tokenizer.bin",
+                 " in: ",
+                 input_path);
     }
     else if (fs::exists(p) && fs::is_regular_file(p)) {
         // Input is a file
@@ -52,8 +91,13 @@ inline std::pair<std::string, std::string> resolve_model_paths(const std::string
         tokenizer_path = tokenizer_bin.string();
 
         if (!fs::exists(tokenizer_path)) {
-            LOG_WARNING("tokenizer.bin not found in: ", parent.string(), ", trying current directory");
-            tokenizer_path = "tokenizer.bin";
+            if (p.extension() == ".gguf" || p.extension() == ".pack") {
+                tokenizer_path.clear();
+            }
+            else {
+                LOG_WARNING("tokenizer.bin not found in: ", parent.string(), ", trying current directory");
+                tokenizer_path = "tokenizer.bin";
+            }
         }
     }
     else {
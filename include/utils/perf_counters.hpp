@@ -0,0 +1,179 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <cstring>
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+// ============================================================================
+// Perf Counters - Per-thread hardware counters via perf_event_open
+//
+// Opens one counter group for the calling thread (user-space only, so it works
+// at perf_event_paranoid <= 2). Events the PMU or hypervisor does not expose
+// are skipped and reported as unavailable. The whole group is read with a
+// single read() and scaled for multiplexing, so a sample costs one syscall.
+// On non-Linux builds open() always fails and the profiler runs without them.
+// ============================================================================
+
+class PerfCounters
+{
+public:
+    enum Event { CYCLES, INSTRUCTIONS, LLC_REFERENCES, LLC_MISSES, L1D_READ_MISSES, DTLB_READ_MISSES, NUM_EVENTS };
+
+    static constexpr const char *EVENT_NAMES[NUM_EVENTS] = {
+        "cycles", "instructions", "llc_references", "llc_misses", "l1d_read_misses", "dtlb_read_misses"};
+
+    // Counter values at one point in time (or a delta between two)
+    struct Sample
+    {
+        std::array<uint64_t, NUM_EVENTS> values{};
+        uint64_t                         time_enabled = 0;
+        uint64_t                         time_running = 0;
+
+        uint64_t operator[](Event e) const { return values[e]; }
+    };
+
+    PerfCounters() = default;
+    ~PerfCounters() { close(); }
+
+    PerfCounters(const PerfCounters &)            = delete;
+    PerfCounters &operator=(const PerfCounters &) = delete;
+
+    // Open and start counting for the calling thread. Returns false when no
+    // event could be opened (no PMU, seccomp, perf_event_paranoid > 2, ...).
+    bool open()
+    {
+#ifdef __linux__
+        for (int e = 0; e < NUM_EVENTS; e++) {
+            int fd = open_event(static_cast<Event>(e), leader_fd_);
+            if (fd < 0) {
+                continue;
+            }
+            if (leader_fd_ < 0) {
+                leader_fd_ = fd;
+            }
+            fds_[e]               = fd;
+            slots_[num_opened_++] = e;
+            available_[e]         = true;
+        }
+        if (leader_fd_ < 0) {
+            return false;
+        }
+        ioctl(leader_fd_, PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+        ioctl(leader_fd_, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+        return true;
+#else
+        return false;
+#endif
+    }
+
+    bool is_open() const { return leader_fd_ >= 0; }
+    bool available(Event e) const { return available_[e]; }
+
+    // Raw (unscaled) counter values; zero for unavailable events
+    Sample read() const
+    {
+        Sample sample;
+#ifdef __linux__
+        // Layout for PERF_FORMAT_GROUP | TOTAL_TIME_ENABLED | TOTAL_TIME_RUNNING
+        uint64_t buf[3 + NUM_EVENTS];
+        if (leader_fd_ < 0 || ::read(leader_fd_, buf, sizeof(buf)) <= 0) {
+            return sample;
+        }
+        sample.time_enabled = buf[1];
+        sample.time_running = buf[2];
+        for (uint64_t i = 0; i < buf[0] && i < static_cast<uint64_t>(num_opened_); i++) {
+            sample.values[slots_[i]] = buf[3 + i];
+        }
+#endif
+        return sample;
+    }
+
+    // end - start, scaled up when the group was multiplexed off the PMU
+    static Sample delta(const Sample &start, const Sample &end)
+    {
+        Sample d;
+        d.time_enabled = end.time_enabled - start.time_enabled;
+        d.time_running = end.time_running - start.time_running;
+        double scale   = d.time_running > 0 ? static_cast<double>(d.time_enabled) / d.time_running : 1.0;
+        for (int e = 0; e < NUM_EVENTS; e++) {
+            d.values[e] = static_cast<uint64_t>((end.values[e] - start.values[e]) * scale);
+        }
+        return d;
+    }
+
+private:
+    std::array<int, NUM_EVENTS>  fds_        = {-1, -1, -1, -1, -1, -1};
+    std::array<int, NUM_EVENTS>  slots_      = {}; // Group read order -> Event
+    std::array<bool, NUM_EVENTS> available_  = {};
+    int                          num_opened_ = 0;
+    int                          leader_fd_  = -1;
+
+    void close()
+    {
+#ifdef __linux__
+        for (int &fd : fds_) {
+            if (fd >= 0) {
+                ::close(fd);
+                fd = -1;
+            }
+        }
+#endif
+        leader_fd_ = -1;
+    }
+
+#ifdef __linux__
+    static int open_event(Event e, int group_fd)
+    {
+        perf_event_attr attr;
+        std::memset(&attr, 0, sizeof(attr));
+        attr.size           = sizeof(attr);
+        attr.disabled       = group_fd < 0 ? 1 : 0; // Leader starts the whole group
+        attr.exclude_kernel = 1;
+        attr.exclude_hv     = 1;
+        attr.read_format    = PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+
+        auto hw_cache_miss = [](uint64_t cache) {
+            return cache | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+        };
+
+        switch (e) {
+        case CYCLES:
+            attr.type   = PERF_TYPE_HARDWARE;
+            attr.config = PERF_COUNT_HW_CPU_CYCLES;
+            break;
+        case INSTRUCTIONS:
+            attr.type   = PERF_TYPE_HARDWARE;
+            attr.config = PERF_COUNT_HW_INSTRUCTIONS;
+            break;
+        case LLC_REFERENCES:
+            attr.type   = PERF_TYPE_HARDWARE;
+            attr.config = PERF_COUNT_HW_CACHE_REFERENCES;
+            break;
+        case LLC_MISSES:
+            attr.type   = PERF_TYPE_HARDWARE;
+            attr.config = PERF_COUNT_HW_CACHE_MISSES;
+            break;
+        case L1D_READ_MISSES:
+            attr.type   = PERF_TYPE_HW_CACHE;
+            attr.config = hw_cache_miss(PERF_COUNT_HW_CACHE_L1D);
+            break;
+        case DTLB_READ_MISSES:
+            attr.type   = PERF_TYPE_HW_CACHE;
+            attr.config = hw_cache_miss(PERF_COUNT_HW_CACHE_DTLB);
+            break;
+        default:
+            return -1;
+        }
+
+        // pid = 0, cpu = -1: the calling thread on whichever CPU it runs
+        return static_cast<int>(syscall(SYS_perf_event_open, &attr, 0, -1, group_fd, 0));
+    }
+#endif
+};
@@ -0,0 +1,346 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "utils/logger.hpp"
+#include "utils/perf_counters.hpp"
+
+// ============================================================================
+// Profiler - Scoped hot-path timers with Chrome/Perfetto trace export
+//
+// PROFILE_SCOPE("name") records the enclosing scope's duration into a
+// per-thread event buffer. Names must be string literals (stored by pointer).
+// Scopes compile to nothing unless NANO_VLLM_PROFILE is defined (CMake option
+// USE_PROFILER), and are a single branch when compiled in but not enabled.
+//
+// Recording never takes a lock: each thread appends to its own buffer, which
+// is registered once on the thread's first event. Buffers are only read by
+// report functions, which must run after profiled threads are done.
+//
+// With enable_counters(), each thread also opens its own PerfCounters group
+// and every scope accumulates counter deltas under its name. Counts are
+// inclusive of nested scopes, and each scope edge costs one read() syscall.
+// ============================================================================
+
+class Profiler
+{
+public:
+    using Clock = std::chrono::steady_clock;
+
+    struct Event
+    {
+        const char *name;
+        int64_t     start_ns; // Relative to enable()
+        int64_t     dur_ns;
+    };
+
+    // Hardware counter totals for one scope name on one thread
+    struct CounterTotals
+    {
+        int64_t              calls   = 0;
+        int64_t              wall_ns = 0;
+        PerfCounters::Sample sum;
+    };
+
+    struct ThreadBuffer
+    {
+        int                tid;
+        std::string        name;
+        std::vector<Event> events;
+
+        std::unique_ptr<PerfCounters>                   counters;
+        bool                                            counters_failed = false;
+        std::unordered_map<const char *, CounterTotals> counter_totals;
+    };
+
+    static Profiler &instance()
+    {
+        static Profiler profiler;
+        return profiler;
+    }
+
+    void enable()
+    {
+        origin_  = Clock::now();
+        enabled_ = true;
+    }
+
+    void disable() { enabled_ = false; }
+    bool enabled() const { return enabled_; }
+
+    // Attribute hardware counters to scopes (takes effect with enable())
+    void enable_counters() { counters_enabled_ = true; }
+    bool counters_enabled() const { return counters_enabled_; }
+
+    int64_t now_ns() const
+    {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - origin_).count();
+    }
+
+    void record(const char *name, int64_t start_ns, int64_t end_ns)
+    {
+        thread_buffer().events.push_back({name, start_ns, end_ns - start_ns});
+    }
+
+    void record_counters(const char *name, int64_t wall_ns, const PerfCounters::Sample &delta)
+    {
+        auto &totals = thread_buffer().counter_totals[name];
+        totals.calls++;
+        totals.wall_ns += wall_ns;
+        for (int e = 0; e < PerfCounters::NUM_EVENTS; e++) {
+            totals.sum.values[e] += delta.values[e];
+        }
+    }
+
+    // Calling thread's counter group, opened on first use; nullptr if unavailable
+    PerfCounters *thread_counters()
+    {
+        ThreadBuffer &buffer = thread_buffer();
+        if (!buffer.counters && !buffer.counters_failed) {
+            auto counters = std::make_unique<PerfCounters>();
+            if (counters->open()) {
+                buffer.counters = std::move(counters);
+            }
+            else {
+                buffer.counters_failed = true;
+                LOG_WARNING("perf_event_open failed on thread ",
+                            buffer.tid,
+                            "; hardware counters unavailable (check kernel.perf_event_paranoid)");
+            }
+        }
+        return buffer.counters.get();
+    }
+
+    // Label the calling thread's track in the trace
+    void set_thread_name(const std::string &name) { thread_buffer().name = name; }
+
+    // Aggregate table: calls, total, mean and share of profiled wall time per scope
+    void print_summary(std::ostream &os = std::cout) const
+    {
+        struct Stat
+        {
+            int64_t calls    = 0;
+            int64_t total_ns = 0;
+            int64_t max_ns   = 0;
+        };
+        std::map<std::string, Stat> stats;
+        int64_t                     wall_ns = 1;
+
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (const auto &buffer : buffers_) {
+            for (const auto &e : buffer->events) {
+                auto &s = stats[e.name];
+                s.calls++;
+                s.total_ns += e.dur_ns;
+                s.max_ns = std::max(s.max_ns, e.dur_ns);
+                wall_ns  = std::max(wall_ns, e.start_ns + e.dur_ns);
+            }
+        }
+
+        Logger::flush();
+        std::vector<std::pair<std::string, Stat>> rows(stats.begin(), stats.end());
+        std::sort(rows.begin(), rows.end(), [](const auto &a, const auto &b) {
+            return a.second.total_ns > b.second.total_ns;
+        });
+
+        os << "\n" << std::left << std::setw(24) << "Scope" << std::right << std::setw(10) << "calls" << std::setw(12)
+           << "total ms" << std::setw(12) << "mean us" << std::setw(12) << "max us" << std::setw(10) << "% wall"
+           << "\n";
+        os << std::string(80, '-') << "\n";
+        os << std::fixed;
+        for (const auto &[name, s] : rows) {
+            os << std::left << std::setw(24) << name << std::right << std::setw(10) << s.calls << std::setprecision(3)
+               << std::setw(12) << s.total_ns / 1e6 << std::setw(12) << s.total_ns / 1e3 / s.calls << std::setw(12)
+               << s.max_ns / 1e3 << std::setprecision(1) << std::setw(10) << 100.0 * s.total_ns / wall_ns << "\n";
+        }
+        os << std::string(80, '-') << "\n";
+    }
+
+    // Per-scope hardware counter table: IPC, L1D and dTLB misses per 1k
+    // instructions, LLC miss ratio and LLC fill bandwidth (misses x 64 B / wall)
+    void print_counter_summary(std::ostream &os = std::cout) const
+    {
+        std::map<std::string, CounterTotals>       totals;
+        std::array<bool, PerfCounters::NUM_EVENTS> available{};
+
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (const auto &buffer : buffers_) {
+            if (buffer->counters) {
+                for (int e = 0; e < PerfCounters::NUM_EVENTS; e++) {
+                    available[e] = available[e] || buffer->counters->available(static_cast<PerfCounters::Event>(e));
+                }
+            }
+            for (const auto &[name, t] : buffer->counter_totals) {
+                auto &total = totals[name];
+                total.calls += t.calls;
+                total.wall_ns += t.wall_ns;
+                for (int e = 0; e < PerfCounters::NUM_EVENTS; e++) {
+                    total.sum.values[e] += t.sum.values[e];
+                }
+            }
+        }
+        if (totals.empty()) {
+            return;
+        }
+
+        Logger::flush();
+        std::vector<std::pair<std::string, CounterTotals>> rows(totals.begin(), totals.end());
+        std::sort(rows.begin(), rows.end(), [](const auto &a, const auto &b) {
+            return a.second.wall_ns > b.second.wall_ns;
+        });
+
+        using E = PerfCounters;
+        // Ratio of two counters, or "-" if either is not exposed by this PMU
+        auto cell = [&](const CounterTotals &t, E::Event num, E::Event den, double scale, int width) {
+            os << std::setw(width);
+            if (!available[num] || !available[den] || t.sum[den] == 0) {
+                os << "-";
+            }
+            else {
+                os << scale * static_cast<double>(t.sum[num]) / static_cast<double>(t.sum[den]);
+            }
+        };
+
+        os << "\n" << std::left << std::setw(24) << "Scope" << std::right << std::setw(12) << "Minstr" << std::setw(8)
+           << "IPC" << std::setw(12) << "L1D/kinstr" << std::setw(10) << "LLC miss%" << std::setw(10) << "LLC GB/s"
+           << std::setw(13) << "dTLB/kinstr"
+           << "\n";
+        os << std::string(89, '-') << "\n";
+        os << std::fixed << std::setprecision(2);
+        for (const auto &[name, t] : rows) {
+            os << std::left << std::setw(24) << name << std::right << std::setw(12);
+            if (available[E::INSTRUCTIONS]) {
+                os << t.sum[E::INSTRUCTIONS] / 1e6;
+            }
+            else {
+                os << "-";
+            }
+            cell(t, E::INSTRUCTIONS, E::CYCLES, 1.0, 8);
+            cell(t, E::L1D_READ_MISSES, E::INSTRUCTIONS, 1000.0, 12);
+            cell(t, E::LLC_MISSES, E::LLC_REFERENCES, 100.0, 10);
+            os << std::setw(10);
+            if (available[E::LLC_MISSES] && t.wall_ns > 0) {
+                os << t.sum[E::LLC_MISSES] * 64.0 / t.wall_ns;
+            }
+            else {
+                os << "-";
+            }
+            cell(t, E::DTLB_READ_MISSES, E::INSTRUCTIONS, 1000.0, 13);
+            os << "\n";
+        }
+        os << std::string(89, '-') << "\n";
+    }
+
+    // Chrome trace event format (chrome://tracing, ui.perfetto.dev); one track per thread
+    bool write_chrome_trace(const std::string &path) const
+    {
+        std::ofstream file(path);
+        if (!file.is_open()) {
+            return false;
+        }
+
+        std::lock_guard<std::mutex> lock(mutex_);
+        file << "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [\n";
+        bool first = true;
+        for (const auto &buffer : buffers_) {
+            if (!buffer->name.empty()) {
+                file << (first ? "" : ",\n") << "{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, \"tid\": "
+                     << buffer->tid << ", \"args\": {\"name\": \"" << buffer->name << "\"}}";
+                first = false;
+            }
+            for (const auto &e : buffer->events) {
+                file << (first ? "" : ",\n") << "{\"name\": \"" << e.name << "\", \"ph\": \"X\", \"pid\": 1, \"tid\": "
+                     << buffer->tid << std::fixed << std::setprecision(3) << ", \"ts\": " << e.start_ns / 1e3
+                     << ", \"dur\": " << e.dur_ns / 1e3 << "}";
+                first = false;
+            }
+        }
+        file << "\n]}\n";
+        return file.good();
+    }
+
+    // RAII timer behind PROFILE_SCOPE
+    class Scope
+    {
+    public:
+        // Counters are read outside the timed window so the syscall is not
+        // charged to the scope's wall time
+        explicit Scope(const char *name)
+            : name_(name)
+        {
+            Profiler &p = Profiler::instance();
+            if (p.enabled_) {
+                if (p.counters_enabled_ && (counters_ = p.thread_counters())) {
+                    start_counters_ = counters_->read();
+                }
+                start_ns_ = p.now_ns();
+            }
+        }
+
+        ~Scope()
+        {
+            Profiler &p = Profiler::instance();
+            if (start_ns_ >= 0 && p.enabled_) {
+                int64_t end_ns = p.now_ns();
+                p.record(name_, start_ns_, end_ns);
+                if (counters_) {
+                    auto delta = PerfCounters::delta(start_counters_, counters_->read());
+                    p.record_counters(name_, end_ns - start_ns_, delta);
+                }
+            }
+        }
+
+        Scope(const Scope &)            = delete;
+        Scope &operator=(const Scope &) = delete;
+
+    private:
+        const char          *name_;
+        int64_t              start_ns_ = -1;
+        PerfCounters        *counters_ = nullptr;
+        PerfCounters::Sample start_counters_;
+    };
+
+private:
+    Profiler() = default;
+
+    bool              enabled_          = false;
+    bool              counters_enabled_ = false;
+    Clock::time_point origin_           = Clock::now();
+
+    mutable std::mutex                         mutex_;
+    std::vector<std::unique_ptr<ThreadBuffer>> buffers_;
+
+    ThreadBuffer &thread_buffer()
+    {
+        thread_local ThreadBuffer *buffer = nullptr;
+        if (!buffer) {
+            std::lock_guard<std::mutex> lock(mutex_);
+            auto owned = std::make_unique<ThreadBuffer>();
+            owned->tid = static_cast<int>(buffers_.size()) + 1;
+            owned->events.reserve(1 << 16);
+            buffer = owned.get();
+            buffers_.push_back(std::move(owned));
+        }
+        return *buffer;
+    }
+};
+
+#define PROFILE_CONCAT_INNER(a, b) a##b
+#define PROFILE_CONCAT(a, b)       PROFILE_CONCAT_INNER(a, b)
+
+#ifdef NANO_VLLM_PROFILE
+#define PROFILE_SCOPE(name) Profiler::Scope PROFILE_CONCAT(profile_scope_, __LINE__)(name)
+#else
+#define PROFILE_SCOPE(name) ((void)0)
+#endif
@@ -0,0 +1,183 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include <sys/mman.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+
+// ============================================================================
+// Shared-Memory Communicator - Barrier and all-reduce between local processes
+//
+// One anonymous MAP_SHARED region is created before fork(), so every rank
+// sees it at the same address. It holds a generation-counting barrier, a
+// small command block the leader writes before a barrier, one staging row per
+// rank and a result row.
+//
+// all_reduce is a reduce-scatter + all-gather over the staging rows: each
+// rank publishes its partial, sums its own 1/world slice across all ranks
+// (always in rank order, so every rank gets bit-identical results) and then
+// copies the full result back. That is two barriers per call, and the
+// summing work is split evenly instead of repeated on every rank.
+//
+// A rank that fails calls abort() before exiting, and a rank watching the
+// processes it forked (watch()) notices one that died without the chance to;
+// either way every rank waiting in barrier() throws instead of spinning
+// forever.
+// ============================================================================
+
+class ShmCommunicator
+{
+public:
+    // Written by rank 0 before barrier(), read by the others after it
+    struct Command
+    {
+        int op    = 0;
+        int token = 0;
+        int pos   = 0;
+    };
+
+    // max_floats bounds all_reduce sizes; gather_floats sizes the gather row
+    ShmCommunicator(int world_size, int max_floats, int gather_floats)
+        : world_(world_size)
+        , max_floats_(max_floats)
+    {
+        static_assert(std::atomic<uint32_t>::is_always_lock_free, "barrier needs address-free atomics");
+
+        size_t staging_bytes = static_cast<size_t>(world_) * max_floats_ * sizeof(float);
+        bytes_               = round_up(sizeof(Control)) + round_up(staging_bytes)
+                + round_up(static_cast<size_t>(max_floats_) * sizeof(float))
+                + round_up(static_cast<size_t>(gather_floats) * sizeof(float));
+
+        void *base = mmap(nullptr, bytes_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+        if (base == MAP_FAILED) {
+            throw std::runtime_error("Failed to map " + std::to_string(bytes_) + " bytes of shared memory");
+        }
+        base_ = static_cast<char *>(base);
+
+        char *p  = base_;
+        control_ = new (p) Control();
+        p += round_up(sizeof(Control));
+        staging_ = reinterpret_cast<float *>(p);
+        p += round_up(staging_bytes);
+        result_ = reinterpret_cast<float *>(p);
+        p += round_up(static_cast<size_t>(max_floats_) * sizeof(float));
+        gather_ = reinterpret_cast<float *>(p);
+    }
+
+    ~ShmCommunicator() { munmap(base_, bytes_); }
+
+    ShmCommunicator(const ShmCommunicator &)            = delete;
+    ShmCommunicator &operator=(const ShmCommunicator &) = delete;
+
+    int world_size() const { return world_; }
+
+    Command &command() { return control_->command; }
+
+    // Shared row every rank can write a disjoint slice of (e.g. logits)
+    float *gather_buffer() { return gather_; }
+
+    // Mark the run as failed; every rank in (or entering) barrier() throws
+    void abort() { control_->aborted.store(1, std::memory_order_release); }
+    bool aborted() const { return control_->aborted.load(std::memory_order_acquire) != 0; }
+
+    // Processes whose exit aborts the run (the leader passes the ranks it forked)
+    void watch(std::vector<pid_t> pids) { peers_ = std::move(pids); }
+
+    void barrier()
+    {
+        uint32_t generation = control_->generation.load(std::memory_order_acquire);
+        if (control_->arrived.fetch_add(1, std::memory_order_acq_rel) + 1 == static_cast<uint32_t>(world_)) {
+            control_->arrived.store(0, std::memory_order_relaxed);
+            control_->generation.fetch_add(1, std::memory_order_release);
+            return;
+        }
+        for (int spins = 0; control_->generation.load(std::memory_order_acquire) == generation; spins++) {
+            backoff(spins);
+            if (spins % 1024 == 1023) {
+                check_peers();
+            }
+        }
+    }
+
+    // Sum data[0, n) across ranks in place
+    void all_reduce(int rank, float *data, int n)
+    {
+        if (world_ == 1) {
+            return;
+        }
+        std::memcpy(staging_ + static_cast<size_t>(rank) * max_floats_, data, n * sizeof(float));
+        barrier();
+
+        int begin = static_cast<int>(static_cast<int64_t>(n) * rank / world_);
+        int end   = static_cast<int>(static_cast<int64_t>(n) * (rank + 1) / world_);
+        for (int i = begin; i < end; i++) {
+            float sum = 0.0f;
+            for (int r = 0; r < world_; r++) {
+                sum += staging_[static_cast<size_t>(r) * max_floats_ + i];
+            }
+            result_[i] = sum;
+        }
+        barrier();
+
+        std::memcpy(data, result_, n * sizeof(float));
+    }
+
+private:
+    struct Control
+    {
+        alignas(64) std::atomic<uint32_t> arrived{0};
+        alignas(64) std::atomic<uint32_t> generation{0};
+        alignas(64) std::atomic<uint32_t> aborted{0};
+        alignas(64) Command command;
+    };
+
+    static size_t round_up(size_t bytes) { return (bytes + 63) & ~size_t(63); }
+
+    void check_peers()
+    {
+        for (pid_t pid : peers_) {
+            int status = 0;
+            if (waitpid(pid, &status, WNOHANG) == pid) {
+                abort();
+            }
+        }
+        if (aborted()) {
+            throw std::runtime_error("A peer rank failed or exited; aborting the run");
+        }
+    }
+
+    // Ranks normally sit on their own cores, so spin first; sleep when idle
+    // (e.g. workers waiting for the next request)
+    static void backoff(int spins)
+    {
+        if (spins < 1024) {
+            return;
+        }
+        if (spins < 4096) {
+            std::this_thread::yield();
+            return;
+        }
+        std::this_thread::sleep_for(std::chrono::microseconds(50));
+    }
+
+    int      world_;
+    int      max_floats_;
+    size_t   bytes_   = 0;
+    char    *base_    = nullptr;
+    Control *control_ = nullptr;
+    float   *staging_ = nullptr;
+    float   *result_  = nullptr;
+    float   *gather_  = nullptr;
+
+    std::vector<pid_t> peers_;
+};
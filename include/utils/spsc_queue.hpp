@@ -0,0 +1,99 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <memory>
+#include <thread>
+
+// ============================================================================
+// SPSC Queue - Bounded lock-free single-producer/single-consumer ring
+//
+// One thread pushes, one thread pops. Head and tail live on separate cache
+// lines, and each side caches the other's index so the common case touches
+// only its own line. pop_wait/push_wait spin briefly and then yield, which
+// suits pipeline stages that run on dedicated cores.
+// ============================================================================
+
+template <typename T> class SpscQueue
+{
+public:
+    // capacity is rounded up to a power of two
+    explicit SpscQueue(size_t capacity)
+    {
+        size_t size = 2;
+        while (size < capacity) {
+            size <<= 1;
+        }
+        mask_  = size - 1;
+        slots_ = std::make_unique<T[]>(size);
+    }
+
+    SpscQueue(const SpscQueue &)            = delete;
+    SpscQueue &operator=(const SpscQueue &) = delete;
+
+    bool try_push(const T &value)
+    {
+        size_t tail = tail_.load(std::memory_order_relaxed);
+        if (tail - cached_head_ > mask_) {
+            cached_head_ = head_.load(std::memory_order_acquire);
+            if (tail - cached_head_ > mask_) {
+                return false;
+            }
+        }
+        slots_[tail & mask_] = value;
+        tail_.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    bool try_pop(T &value)
+    {
+        size_t head = head_.load(std::memory_order_relaxed);
+        if (head == cached_tail_) {
+            cached_tail_ = tail_.load(std::memory_order_acquire);
+            if (head == cached_tail_) {
+                return false;
+            }
+        }
+        value = slots_[head & mask_];
+        head_.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+    void push_wait(const T &value)
+    {
+        for (int spins = 0; !try_push(value); spins++) {
+            backoff(spins);
+        }
+    }
+
+    T pop_wait()
+    {
+        T value;
+        for (int spins = 0; !try_pop(value); spins++) {
+            backoff(spins);
+        }
+        return value;
+    }
+
+private:
+    static void backoff(int spins)
+    {
+        if (spins < 64) {
+            return; // Busy-spin: the other side is usually mid-operation
+        }
+        if (spins < 256) {
+            std::this_thread::yield();
+            return;
+        }
+        std::this_thread::sleep_for(std::chrono::microseconds(50));
+    }
+
+    size_t               mask_ = 0;
+    std::unique_ptr<T[]> slots_;
+
+    alignas(64) std::atomic<size_t> head_{0}; // Consumer
+    size_t cached_tail_ = 0;                  // Consumer's view of tail_
+    alignas(64) std::atomic<size_t> tail_{0}; // Producer
+    size_t cached_head_ = 0;                  // Producer's view of head_
+};
@@ -5,25 +5,53 @@
 #include "core/tokenizer.hpp"
 #include "utils/argparser.hpp"
 #include "utils/logger.hpp"
+#include "utils/metrics_server.hpp"
 #include "utils/path.hpp"
+#include "utils/profiler.hpp"
 
 // ============================================================================
 // Program Arguments Configuration
 // ============================================================================
 
-#define ARGS_LIST path, prompt, input_json, max_batch_size, temperature, topp, steps, without_paged_attn
+#define ARGS_LIST                                                                                          \
+    path, prompt, input_json, input_jsonl, output_jsonl, max_in_flight, max_batch_size, temperature, topp, \
+    steps, without_paged_attn, sliding_window, attention_sinks, kv_cache_dir, lora_dir, max_loras,         \
+    max_lora_rank, metrics_json, request_rate, burstiness, arrival_trace, slo_ttft_ms, slo_tpot_ms,        \
+    profile_trace, perf_counters, metrics_port, replicas, pipeline_stages, tensor_parallel, prefill_workers
 
 class Arguments : public ArgConfig<Arguments>
 {
 public:
-    Arg<std::string> path{"path", "Path to model directory or model.bin file"};
+    Arg<std::string> path{"path", "Model directory, or a model.bin, .gguf or .safetensors file"};
     Arg<std::string> prompt{{"-i", "--prompt"}, "Input prompt", ""};
     Arg<std::string> input_json{"--input-json", "Path to JSON file with benchmark requests", ""};
+    Arg<std::string> input_jsonl{"--input-jsonl", "Stream requests from a JSONL file (- = stdin)", ""};
+    Arg<std::string> output_jsonl{"--output-jsonl", "Write completions as JSONL (- = stdout)", ""};
+    Arg<int>         max_in_flight{"--max-in-flight", "Requests read ahead of completion in JSONL mode", 64};
     Arg<int>         max_batch_size{{"-b", "--max-batch-size"}, "Maximum batch size for continuous batching", 1};
     Arg<float>       temperature{{"-t", "--temperature"}, "Temperature for sampling", 1.0f};
     Arg<float>       topp{{"-p", "--top-p"}, "Top-p (nucleus) sampling parameter", 0.9f};
     Arg<int>         steps{{"-n", "--steps"}, "Number of steps to generate", 256};
     Arg<bool>        without_paged_attn{"--without-paged-attn", "Disable PagedAttention", false};
+    Arg<int>         sliding_window{"--sliding-window", "Attend to the last N tokens (0 = all, -1 = per model)", -1};
+    Arg<int>         attention_sinks{"--attention-sinks", "Keep the first N tokens attended next to the window", 0};
+    Arg<std::string> kv_cache_dir{"--kv-cache-dir", "Persistent prefix KV cache directory (empty = disabled)", ""};
+    Arg<std::string> lora_dir{"--lora-dir", "Serve LoRA adapters from DIR/<name> (request field \"adapter\")", ""};
+    Arg<int>         max_loras{"--max-loras", "LoRA adapters kept loaded (least recently used evicted)", 8};
+    Arg<int>         max_lora_rank{"--max-lora-rank", "Largest LoRA adapter rank accepted", 64};
+    Arg<std::string> metrics_json{"--metrics-json", "Write benchmark metrics as JSON to this path", ""};
+    Arg<std::string> request_rate{"--request-rate", "Open-loop arrival rate(s) in req/s, comma-separated to sweep", ""};
+    Arg<float>       burstiness{"--burstiness", "Gamma shape of inter-arrival times (1 = Poisson)", 1.0f};
+    Arg<std::string> arrival_trace{"--arrival-trace", "Replay arrival times (seconds, one per line)", ""};
+    Arg<float>       slo_ttft_ms{"--slo-ttft-ms", "TTFT SLO for goodput (0 = none)", 0.0f};
+    Arg<float>       slo_tpot_ms{"--slo-tpot-ms", "TPOT SLO for goodput (0 = none)", 0.0f};
+    Arg<std::string> profile_trace{"--profile-trace", "Write a Chrome trace of profiler scopes to this path", ""};
+    Arg<bool>        perf_counters{"--perf-counters", "Attribute hardware perf counters to profiler scopes", false};
+    Arg<int>         metrics_port{"--metrics-port", "Serve Prometheus metrics on 127.0.0.1:PORT/metrics (0 = off)", 0};
+    Arg<int>         replicas{"--replicas", "Engines sharing one weight copy, each on its own cores", 1};
+    Arg<int>         pipeline_stages{"--pipeline-stages", "Split the layers into stages on separate core groups", 1};
+    Arg<int>         tensor_parallel{"--tensor-parallel", "Shard every layer across this many local processes", 1};
+    Arg<int>         prefill_workers{"--prefill-workers", "Prefill in separate processes, decode here (0 = off)", 0};
 
     decltype(std::tie(ARGS_LIST)) args_tuple = std::tie(ARGS_LIST);
 };
@@ -39,21 +67,57 @@ int main(int argc, char **argv)
     Arguments args;
     ArgParser parser("nano-vllm: A minimal vLLM implementation in C++");
 
+    // Completions on stdout: only errors (which go to stderr) may be logged.
+    // Checked before parsing, which itself logs the parsed arguments.
+    for (int i = 1; i + 1 < argc; i++) {
+        if (std::string(argv[i]) == "--output-jsonl" && std::string(argv[i + 1]) == "-") {
+            Logger::set_level(LogLevel::Error);
+        }
+    }
+
     if (!args.parse(parser, argc, argv)) {
         return 1;
     }
 
-    bool has_prompt     = !args.prompt.value.empty();
-    bool has_input_json = !args.input_json.value.empty();
+    bool has_prompt      = !args.prompt.value.empty();
+    bool has_input_json  = !args.input_json.value.empty();
+    bool has_input_jsonl = !args.input_jsonl.value.empty();
 
-    if (!has_prompt && !has_input_json) {
-        LOG_ERROR("Either --prompt or --input-json must be provided");
+    if (!has_prompt && !has_input_json && !has_input_jsonl) {
+        LOG_ERROR("One of --prompt, --input-json or --input-jsonl must be provided");
         parser.print_usage();
         return 1;
     }
 
-    if (has_prompt && has_input_json) {
-        LOG_ERROR("Cannot use both --prompt and --input-json");
+    if (has_prompt + has_input_json + has_input_jsonl > 1) {
+        LOG_ERROR("Only one of --prompt, --input-json and --input-jsonl can be used");
+        return 1;
+    }
+
+    ParallelConfig parallel{args.replicas, args.pipeline_stages, args.tensor_parallel, args.prefill_workers};
+    if (std::string error = parallel.validate(); !error.empty()) {
+        LOG_ERROR(error);
+        return 1;
+    }
+    if (has_prompt && parallel.is_parallel()) {
+        LOG_WARNING("Parallel and disaggregated modes only apply to JSON/JSONL input");
+    }
+
+    std::vector<double> request_rates;
+    try {
+        request_rates = LoadGen::parse_rates(args.request_rate);
+    }
+    catch (const std::exception &e) {
+        LOG_ERROR(e.what());
+        return 1;
+    }
+    if (args.burstiness <= 0.0f) {
+        LOG_ERROR("--burstiness must be positive");
+        return 1;
+    }
+
+    if (has_input_jsonl && args.output_jsonl.value.empty()) {
+        LOG_ERROR("--input-jsonl requires --output-jsonl (use - for stdout)");
         return 1;
     }
 
@@ -72,6 +136,17 @@ int main(int argc, char **argv)
     try {
         model.load(model_path);
         model.config.use_paged_attention = !args.without_paged_attn;
+        if (args.sliding_window >= 0) {
+            model.set_sliding_window(args.sliding_window);
+        }
+        if (args.attention_sinks > 0) {
+            model.set_attention_sinks(args.attention_sinks);
+        }
+        if (model.config.sliding_window > 0
+            && (parallel.pipeline_stages > 1 || parallel.tensor_parallel > 1 || parallel.prefill_workers > 0)) {
+            throw std::runtime_error(
+                "Sliding-window attention is not supported with pipeline, tensor-parallel or disaggregated runs");
+        }
 
         if (model.config.use_paged_attention) {
             LOG_INFO("Using PagedAttention (block_size=", model.config.block_size, ")");
@@ -81,6 +156,18 @@ int main(int argc, char **argv)
             LOG_INFO("Using Standard Attention");
         }
 
+        if (!args.kv_cache_dir.value.empty()) {
+            model.initialize_kv_store(args.kv_cache_dir);
+        }
+
+        if (!args.lora_dir.value.empty()) {
+            if (parallel.pipeline_stages > 1 || parallel.tensor_parallel > 1 || parallel.prefill_workers > 0) {
+                throw std::runtime_error(
+                    "LoRA adapters are not supported with pipeline, tensor-parallel or disaggregated runs");
+            }
+            model.initialize_lora(args.lora_dir, args.max_loras, args.max_lora_rank);
+        }
+
         LOG_SUCCESS("Model loaded successfully");
     }
     catch (const std::exception &e) {
@@ -88,26 +175,79 @@ int main(int argc, char **argv)
         return 1;
     }
 
-    Tokenizer tokenizer(tokenizer_path, model.config.vocab_size);
+    if (tokenizer_path.empty() && model.vocab.empty()) {
+        LOG_ERROR("No tokenizer.bin found and the model embeds no supported vocabulary");
+        return 1;
+    }
+    Tokenizer tokenizer = tokenizer_path.empty() ? Tokenizer(model.vocab, model.vocab_scores)
+                                                 : Tokenizer(tokenizer_path, model.config.vocab_size);
     LOG_SUCCESS("Tokenizer loaded successfully");
 
-    if (has_input_json) {
-        return run_json_benchmark(model, tokenizer, args.input_json, args.max_batch_size);
+    if (!args.profile_trace.value.empty() || args.perf_counters) {
+#ifdef NANO_VLLM_PROFILE
+        Profiler::instance().set_thread_name("engine");
+        if (args.perf_counters) {
+            Profiler::instance().enable_counters();
+        }
+        Profiler::instance().enable();
+#else
+        LOG_WARNING("--profile-trace/--perf-counters ignored: rebuild with -DUSE_PROFILER=ON");
+#endif
     }
-    else {
-        return run_single_prompt(model, tokenizer, args.prompt, args.temperature, args.topp, args.steps);
+
+    std::unique_ptr<MetricsServer> metrics_server;
+    if (args.metrics_port > 0) {
+        try {
+            metrics_server = std::make_unique<MetricsServer>(args.metrics_port);
+        }
+        catch (const std::exception &e) {
+            LOG_ERROR("Error starting metrics server: ", e.what());
+            return 1;
+        }
     }
 
-    long end_time =
-        std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::system_clock::now().time_since_epoch())
-            .count();
+    int result;
+    if (has_input_jsonl) {
+        result = run_jsonl_batch(model,
+                                 tokenizer,
+                                 args.input_jsonl,
+                                 args.output_jsonl,
+                                 args.max_batch_size,
+                                 args.max_in_flight,
+                                 args.metrics_json,
+                                 parallel);
+    }
+    else if (has_input_json) {
+        LoadConfig load;
+        load.request_rates = request_rates;
+        load.burstiness    = args.burstiness;
+        load.trace_path    = args.arrival_trace;
+        load.seed          = static_cast<unsigned long long>(std::time(nullptr));
 
-    double elapsed = (double)(end_time - start_time) / 1000.0;
-    std::cout << std::endl;
-    LOG_SUCCESS("Generation completed in ", elapsed, " seconds");
+        ServiceLevelObjective slo{args.slo_ttft_ms, args.slo_tpot_ms};
+
+        result = run_json_benchmark(
+            model, tokenizer, args.input_json, args.max_batch_size, args.metrics_json, load, slo, parallel);
+    }
+    else {
+        result = run_single_prompt(model, tokenizer, args.prompt, args.temperature, args.topp, args.steps);
+    }
 
-    // Print KV cache memory comparison metrics
-    model.print_metrics(pos);
+    if (Profiler::instance().enabled()) {
+        Profiler::instance().disable();
+        Profiler::instance().print_summary();
+        if (Profiler::instance().counters_enabled()) {
+            Profiler::instance().print_counter_summary();
+        }
+        if (!args.profile_trace.value.empty()) {
+            if (Profiler::instance().write_chrome_trace(args.profile_trace)) {
+                LOG_INFO("Profiler trace written to ", args.profile_trace.value);
+            }
+            else {
+                LOG_ERROR("Failed to write profiler trace: ", args.profile_trace.value);
+            }
+        }
+    }
 
-    return 0;
+    return result;
 }
@@ -0,0 +1,116 @@
+#include <chrono>
+#include <string>
+
+#include "core/model_loader.hpp"
+#include "core/packed_format.hpp"
+#include "core/tokenizer.hpp"
+#include "utils/argparser.hpp"
+#include "utils/logger.hpp"
+#include "utils/path.hpp"
+
+// ============================================================================
+// Pack - Convert a model once into the packed format for instant startup
+//
+//   pack <model>             writes model.pack next to the model
+//   pack <model> -o out.pack
+//   pack out.pack --verify   checks every tensor checksum
+//
+// The input is anything the engine loads (llama2.c, safetensors, GGUF); the
+// output holds the weights exactly as the kernels read them plus the
+// tokenizer vocabulary, so `main` on the pack (or its directory) maps it and
+// starts without converting anything.
+// ============================================================================
+
+#define ARGS_LIST path, output, verify
+
+class PackArgs : public ArgConfig<PackArgs>
+{
+public:
+    Arg<std::string> path{"path", "Model directory or file to pack (the .pack file with --verify)"};
+    Arg<std::string> output{{"-o", "--output"}, "Output file (default: model.pack next to the model)", ""};
+    Arg<bool>        verify{"--verify", "Check every tensor checksum of a packed file instead of packing", false};
+
+    decltype(std::tie(ARGS_LIST)) args_tuple = std::tie(ARGS_LIST);
+};
+
+#undef ARGS_LIST
+
+static double elapsed_ms(std::chrono::high_resolution_clock::time_point since)
+{
+    return std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - since).count();
+}
+
+static int verify(const std::string &path)
+{
+    auto                     start = std::chrono::high_resolution_clock::now();
+    PackedLoader             loader(path);
+    std::vector<std::string> corrupt = loader.verify_tensors();
+    for (const auto &name : corrupt) {
+        LOG_ERROR("Checksum mismatch: ", name);
+    }
+    if (!corrupt.empty()) {
+        return 1;
+    }
+    LOG_SUCCESS("All tensor checksums match (", elapsed_ms(start), " ms)");
+    return 0;
+}
+
+int main(int argc, char **argv)
+{
+    PackArgs  args;
+    ArgParser parser("nano-vllm pack: write a model in the packed format");
+    if (!args.parse(parser, argc, argv)) {
+        return 1;
+    }
+
+    try {
+        if (args.verify) {
+            return verify(args.path);
+        }
+
+        auto [model_path, tokenizer_path] = resolve_model_paths(args.path);
+        if (fs::path(model_path).extension() == ".pack") {
+            LOG_ERROR("Already packed: ", model_path, " (pass the source model file to re-pack)");
+            return 1;
+        }
+
+        auto                         start  = std::chrono::high_resolution_clock::now();
+        std::unique_ptr<ModelLoader> loader = ModelLoader::open(model_path);
+        TransformerWeights           weights;
+        loader->load_weights(weights);
+
+        // Embed the vocabulary so the pack is self-contained
+        std::vector<std::string> vocab        = loader->vocab();
+        std::vector<float>       vocab_scores = loader->vocab_scores();
+        if (!tokenizer_path.empty() && fs::exists(tokenizer_path)) {
+            Tokenizer tokenizer(tokenizer_path, loader->config().vocab_size);
+            vocab        = tokenizer.pieces();
+            vocab_scores = tokenizer.scores();
+        }
+        if (vocab.empty()) {
+            LOG_WARNING("No tokenizer found; the pack will need a tokenizer.bin next to it");
+        }
+
+        std::string output = args.output;
+        if (output.empty()) {
+            fs::path dir = fs::is_directory(model_path) ? fs::path(model_path) : fs::path(model_path).parent_path();
+            output       = (dir / "model.pack").string();
+        }
+        uint64_t bytes = Pack::write(output, loader->config(), weights, vocab, vocab_scores);
+
+        LOG_SUCCESS("Packed ",
+                    loader->format(),
+                    " model into ",
+                    output,
+                    " (",
+                    bytes / (1024.0 * 1024.0),
+                    " MB, ",
+                    elapsed_ms(start),
+                    " ms)");
+    }
+    catch (const std::exception &e) {
+        LOG_ERROR("Pack failed: ", e.what());
+        return 1;
+    }
+    return 0;
+}